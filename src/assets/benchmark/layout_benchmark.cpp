@@ -0,0 +1,194 @@
+// Benchmark of the cache line layout of L1 and L2 (make layout_benchmark)
+// Compares LINE_ARENA and the packed keys of TAG_STORE with the previous layout: one vector<char> per line,
+// separate tag and valid arrays. Same lookups, fills and line copies as L2 on a miss, for large caches.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "../../modules/tag_store.hpp"
+#include "../../modules/line_arena.hpp"
+
+#define MIN_SECONDS 0.25        // every layout runs at least this long per cache
+#define LINE_SIZE 64            // bytes per cache line
+#define ACCESSES (1u << 20)     // addresses per pass
+
+// ============================================ Reference Layout ============================================
+
+/**
+ * @brief The previous layout: vector<vector<char>> cache_blocks, vector<uint32_t> tags and vector<char> valid
+ * @note Same sets, tags and LRU replacement as TAG_STORE
+ */
+struct ReferenceCache {
+    vector<vector<char>> cache_blocks;
+    vector<uint32_t> tags;
+    vector<char> valid;
+    vector<uint64_t> stamps;
+    uint64_t now = 0;
+    TAG_STORE geometry; // only for set_of() and tag_of()
+    unsigned ways;
+
+    ReferenceCache(unsigned lines, unsigned ways) : geometry(LINE_SIZE, lines, ways), ways(ways) {
+        cache_blocks.resize(lines, vector<char> (LINE_SIZE));
+        tags.resize(lines);
+        valid.resize(lines);
+        stamps.resize(lines);
+    }
+
+    int find(uint32_t address) const {
+        unsigned first = geometry.set_of(address) * ways;
+        uint32_t tag = geometry.tag_of(address);
+        for (unsigned line = first; line < first + ways; line++) {
+            if (valid[line] && tags[line] == tag) return (int) line;
+        }
+        return -1;
+    }
+
+    unsigned victim(uint32_t address) {
+        unsigned first = geometry.set_of(address) * ways;
+        if (ways == 1) return first;
+        for (unsigned line = first; line < first + ways; line++) {
+            if (!valid[line]) return line;
+        }
+        unsigned oldest = first;
+        for (unsigned line = first + 1; line < first + ways; line++) {
+            if (stamps[line] < stamps[oldest]) oldest = line;
+        }
+        return oldest;
+    }
+
+    void touch(unsigned line) {
+        if (ways > 1) stamps[line] = ++now;
+    }
+
+    void fill(unsigned line, uint32_t address) {
+        valid[line] = true;
+        tags[line] = geometry.tag_of(address);
+        touch(line);
+    }
+
+    char* line_data(unsigned line) {
+        return cache_blocks[line].data();
+    }
+};
+
+// ============================================ Arena Layout ============================================
+
+/**
+ * @brief The layout of L1 and L2: TAG_STORE (LRU) and a LINE_ARENA
+ */
+struct ArenaCache {
+    TAG_STORE tag_store;
+    LINE_ARENA cache_blocks;
+
+    ArenaCache(unsigned lines, unsigned ways) : tag_store(LINE_SIZE, lines, ways), cache_blocks(lines, LINE_SIZE) {}
+
+    int find(uint32_t address) const { return tag_store.find(address); }
+    unsigned victim(uint32_t address) { return tag_store.victim(address); }
+    void touch(unsigned line) { tag_store.touch(line); }
+    void fill(unsigned line, uint32_t address) { tag_store.fill(line, address); }
+    char* line_data(unsigned line) { return cache_blocks[line]; }
+};
+
+// ============================================ Benchmark ============================================
+
+static double now_seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Result of one layout on one cache
+ */
+struct Timing {
+    double build;       // seconds to build the cache
+    double access;      // seconds per access
+    size_t hits;        // hits of one pass, both layouts must agree
+    uint64_t checksum;  // sum of the bytes read, both layouts must agree
+};
+
+/**
+ * @brief A pass over the addresses: hits read a byte, misses load the line from `memory` (like L2 from memory)
+ */
+template <typename Cache>
+static void pass(Cache& cache, const vector<uint32_t>& addresses, const char* memory, size_t& hits, uint64_t& checksum) {
+    for (uint32_t address : addresses) {
+        int line = cache.find(address);
+        if (line >= 0) {
+            cache.touch(line);
+            hits++;
+        }
+        else {
+            line = cache.victim(address);
+            cache.fill(line, address);
+            memcpy(cache.line_data(line), memory + (address & ~(LINE_SIZE - 1u)) % (1u << 20), LINE_SIZE);
+        }
+        checksum += (unsigned char) cache.line_data(line)[address & (LINE_SIZE - 1)];
+    }
+}
+
+/**
+ * @brief Builds the cache once, then runs passes for at least MIN_SECONDS
+ */
+template <typename Cache>
+static Timing time_layout(unsigned lines, unsigned ways, const vector<uint32_t>& addresses, const char* memory) {
+    Timing timing = {};
+    double start = now_seconds();
+    Cache cache(lines, ways);
+    timing.build = now_seconds() - start;
+
+    // the first pass fills the cache, its hits and checksum are compared
+    pass(cache, addresses, memory, timing.hits, timing.checksum);
+
+    size_t hits = 0;
+    uint64_t checksum = 0;
+    int runs = 0;
+    start = now_seconds();
+    double elapsed;
+    do {
+        pass(cache, addresses, memory, hits, checksum);
+        runs++;
+        elapsed = now_seconds() - start;
+    } while (elapsed < MIN_SECONDS);
+
+    timing.access = elapsed / runs / addresses.size();
+    return timing;
+}
+
+int main() {
+    // bytes that the misses copy, 1 MiB that stays in the host cache, so that the copy is not what is measured
+    vector<char> memory(1u << 20);
+    for (size_t i = 0; i < memory.size(); i++) {
+        memory[i] = (char) (i * 131 + 7);
+    }
+
+    printf("%-9s %5s %13s %13s %15s %15s %8s\n", "Lines", "Ways", "build ms ref", "build ms arena",
+        "ns/access ref", "ns/access arena", "Speedup");
+
+    const unsigned lineCounts[] = {1024, 16384, 262144, 1048576};
+    const unsigned wayCounts[] = {1, 8};
+    for (unsigned lines : lineCounts) {
+        // addresses spread over twice the cache, so that about half of them hit
+        vector<uint32_t> addresses(ACCESSES);
+        uint32_t state = 0x9E3779B9;
+        for (uint32_t& address : addresses) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            address = state % (2u * lines * LINE_SIZE);
+        }
+
+        for (unsigned ways : wayCounts) {
+            Timing reference = time_layout<ReferenceCache>(lines, ways, addresses, memory.data());
+            Timing arena = time_layout<ArenaCache>(lines, ways, addresses, memory.data());
+            if (reference.hits != arena.hits || reference.checksum != arena.checksum) {
+                fprintf(stderr, "Error: the layouts disagree at %u lines, %u ways\n", lines, ways);
+                return EXIT_FAILURE;
+            }
+
+            printf("%-9u %5u %13.2f %14.2f %15.2f %15.2f %7.2fx\n", lines, ways, reference.build * 1e3, arena.build * 1e3,
+                reference.access * 1e9, arena.access * 1e9, reference.access / arena.access);
+        }
+    }
+    return EXIT_SUCCESS;
+}
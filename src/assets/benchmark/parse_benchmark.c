@@ -0,0 +1,180 @@
+// Parse-throughput benchmark of the CSV tokenizer (make benchmark)
+// Compares parse_csv() with the previous fgets()/sscanf() parser on the same files.
+
+// clock_gettime() is POSIX, not C17
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include <sys/stat.h>
+
+#include "../../main/parser/csv_parser.h"
+
+#define MIN_SECONDS 0.25 // every parser runs at least this long per file
+
+// ============================================ Reference Parser ============================================
+
+/**
+ * @brief removes spaces from a string (the previous parser)
+ */
+static void reference_remove_whitespaces(char* input) {
+    int n = strlen(input);
+    int j = 0;
+    for (int i = 0; i < n; i++) {
+        if (input[i] != ' ') {
+            input[j++] = input[i];
+        }
+    }
+    input[j] = '\0';
+}
+
+/**
+ * @brief The previous parse_csv(): fgets() per row, sscanf() per row and per number
+ * @note Only the results of valid files are compared, so the error messages are left out
+ */
+static int reference_parse_csv(const char* input_filename, struct Request* requests) {
+    FILE* file = fopen(input_filename, "r");
+    if (!file) {
+        return -1;
+    }
+
+    char line[100];
+    int i = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line[strcspn(line, "\n")] = 0;
+
+        char rw[10];
+        char addr_str[20];
+        char data_str[20];
+        memset(rw, 0, sizeof(rw));
+        memset(addr_str, 0, sizeof(addr_str));
+        memset(data_str, 0, sizeof(data_str));
+
+        int fields = sscanf(line, "%[^,],%[^,],%s", rw, addr_str, data_str);
+        reference_remove_whitespaces(rw);
+        reference_remove_whitespaces(addr_str);
+        reference_remove_whitespaces(data_str);
+
+        if (strchr(data_str, ',') != NULL || (fields < 2 && rw[0] != '\0')) {
+            fclose(file);
+            return -1;
+        }
+
+        bool write = strcmp(rw, "W") == 0;
+        if (!write && strcmp(rw, "R") != 0) {
+            if (rw[0] != '\0') {
+                fclose(file);
+                return -1;
+            }
+            continue;
+        }
+        if (fields != (write ? 3 : 2)) {
+            fclose(file);
+            return -1;
+        }
+
+        requests[i].we = write;
+        requests[i].data = 0;
+        sscanf(addr_str, (addr_str[1] == 'x' || addr_str[1] == 'X') ? "%x" : "%u", &requests[i].addr);
+        if (write) {
+            sscanf(data_str, (data_str[1] == 'x' || data_str[1] == 'X') ? "%x" : "%u", &requests[i].data);
+        }
+        i++;
+    }
+
+    fclose(file);
+    requests[i].we = -1;
+    return 0;
+}
+
+// ============================================ Benchmark ============================================
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Parses the file repeatedly for at least MIN_SECONDS
+ * @return seconds per parse, negative if the file is invalid
+ */
+static double time_parser(bool reference, const char* filename, struct Request* requests) {
+    int runs = 0;
+    double start = now_seconds();
+    double elapsed;
+    do {
+        int status = reference ? reference_parse_csv(filename, requests) : parse_csv(filename, requests, 0, false);
+        if (status == -1) {
+            return -1;
+        }
+        runs++;
+        elapsed = now_seconds() - start;
+    } while (elapsed < MIN_SECONDS);
+
+    return elapsed / runs;
+}
+
+/**
+ * @brief Number of requests up to the `.we = -1` marker
+ */
+static size_t count_requests(const struct Request* requests) {
+    size_t count = 0;
+    while (requests[count].we != -1) {
+        count++;
+    }
+    return count;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <file.csv>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("%-36s %9s %12s %14s %8s\n", "File", "Requests", "sscanf MB/s", "tokenizer MB/s", "Speedup");
+
+    double totalBytes = 0, totalReference = 0, totalTokenizer = 0;
+    for (int f = 1; f < argc; f++) {
+        struct stat st;
+        if (stat(argv[f], &st) == -1) {
+            fprintf(stderr, "Failed to open input file: %s\n", argv[f]);
+            return EXIT_FAILURE;
+        }
+
+        // every request takes at least 3 bytes ("R,0"), + 1 for the .we = -1 marker
+        size_t capacity = (size_t) st.st_size / 3 + 2;
+        struct Request* expected = malloc(capacity * sizeof(struct Request));
+        struct Request* requests = malloc(capacity * sizeof(struct Request));
+        if (expected == NULL || requests == NULL) {
+            fprintf(stderr, "Error when allocating Request Struct\n");
+            return EXIT_FAILURE;
+        }
+
+        double reference = time_parser(true, argv[f], expected);
+        double tokenizer = time_parser(false, argv[f], requests);
+        if (reference < 0 || tokenizer < 0) {
+            fprintf(stderr, "Error when parsing CSV: %s\n", argv[f]);
+            return EXIT_FAILURE;
+        }
+
+        // both parsers must give the same requests
+        size_t count = count_requests(expected);
+        if (count != count_requests(requests) || memcmp(expected, requests, count * sizeof(struct Request)) != 0) {
+            fprintf(stderr, "Error: the parsers disagree on %s\n", argv[f]);
+            return EXIT_FAILURE;
+        }
+
+        double megabytes = st.st_size / 1e6;
+        printf("%-36s %9zu %12.1f %14.1f %7.1fx\n", argv[f], count, megabytes / reference, megabytes / tokenizer, reference / tokenizer);
+
+        totalBytes += megabytes;
+        totalReference += reference;
+        totalTokenizer += tokenizer;
+        free(expected);
+        free(requests);
+    }
+
+    printf("%-36s %9s %12.1f %14.1f %7.1fx\n", "Total", "", totalBytes / totalReference, totalBytes / totalTokenizer,
+        totalReference / totalTokenizer);
+    return EXIT_SUCCESS;
+}
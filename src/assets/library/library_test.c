@@ -0,0 +1,78 @@
+// Runs of libcachesim on one handle, compared with ./cache by src/assets/scripts/library_test.sh (make library_test)
+// Usage: ./library_test [OPTIONS of ./cache] path/to/file/filename.csv
+
+#include "../../main/cachesim.h"
+#include "../../main/parser/terminal_parser.h"
+
+#define BATCH_SIZE 1000 // requests per cachesim_submit() of the first run
+
+/**
+ * @brief Prints the numbers of ./cache: cycles, hits, misses, gates, then pages and writebacks of L1 and L2
+ */
+static void print_run(const char* name, CacheStats s) {
+    printf("%s: %zu %zu %zu %zu %zu %zu %zu\n", name, s.cycles, s.hits, s.misses, s.primitiveGateCount,
+        s.memoryPages, s.writebacks_L1, s.writebacks_L2);
+}
+
+/**
+ * @brief Creates a handle or quits
+ */
+static Cachesim* create(const Config* config) {
+    Cachesim* sim = cachesim_create(config);
+    if (sim == NULL) {
+        fprintf(stderr, "Error when creating the simulator\n");
+        exit(EXIT_FAILURE);
+    }
+    return sim;
+}
+
+/**
+ * @brief The same requests, four runs:
+ * 1. In batches of BATCH_SIZE
+ * 2. After cachesim_reset(), all at once
+ * 3. A new handle with half of the cycles of the first run, stopped by the cycle limit
+ * 4. A new handle with the configuration of the first run
+ */
+int main(int argc, char* argv[]) {
+    Config* config = parse_user_input(argc, argv);
+    if (config->streamingParse) {
+        fprintf(stderr, "Invalid input: library_test needs every request up front\n");
+        exit(EXIT_FAILURE);
+    }
+    load_requests(config);
+    size_t numRequests = config->numRequests;
+
+    // 1. in batches, the state and the cycle limit go on from one batch to the next
+    Cachesim* sim = create(config);
+    for (size_t i = 0; i < numRequests; i += BATCH_SIZE) {
+        size_t count = (numRequests - i < BATCH_SIZE) ? numRequests - i : BATCH_SIZE;
+        if (cachesim_submit(sim, config->requests + i, count) == -1) break;
+    }
+    CacheStats first = cachesim_stats(sim);
+    print_run("Run 1", first);
+
+    // 2. the same handle again
+    cachesim_reset(sim);
+    cachesim_submit(sim, config->requests, numRequests);
+    print_run("Run 2", cachesim_stats(sim));
+    cachesim_destroy(sim);
+
+    // 3. another handle, half of the cycles
+    Config cut = *config;
+    cut.cycles = (first.cycles == SIZE_MAX) ? config->cycles / 2 : (int) (first.cycles / 2);
+    sim = create(&cut);
+    cachesim_submit(sim, config->requests, numRequests);
+    printf("Cut %d\n", cut.cycles);
+    print_run("Run 3", cachesim_stats(sim));
+    cachesim_destroy(sim);
+
+    // 4. and the first configuration
+    sim = create(config);
+    cachesim_submit(sim, config->requests, numRequests);
+    print_run("Run 4", cachesim_stats(sim));
+    cachesim_destroy(sim);
+
+    free_requests(config);
+    free(config);
+    return 0;
+}
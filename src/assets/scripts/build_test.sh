@@ -37,15 +37,15 @@ echo "IJK Optimized 2 with Conditional Storeback Buffer"
 echo "=================================================================================="
 
 echo "IJK Standard with Prefetching"
-./cache -c 50000000 --cacheline-size 16 --l1-lines 4 --l2-lines 16 --prefetch-buffer 4 -p true examples/ijk/ijk.csv
+./cache -c 2000000 --cacheline-size 16 --l1-lines 4 --l2-lines 16 --prefetch-buffer 4 -p true examples/ijk/ijk.csv
 echo "=================================================================================="
 
 echo "IJK Optimized 1 with Prefetching"
-./cache -c 50000000 --cacheline-size 16 --l1-lines 4 --l2-lines 16 --prefetch-buffer 4 -p true examples/ijk/ijk_opt1.csv
+./cache -c 2000000 --cacheline-size 16 --l1-lines 4 --l2-lines 16 --prefetch-buffer 4 -p true examples/ijk/ijk_opt1.csv
 echo "=================================================================================="
 
 echo "IJK Optimized 2 with Prefetching"
-./cache -c 50000000 --cacheline-size 16 --l1-lines 4 --l2-lines 16 --prefetch-buffer 4 -p true examples/ijk/ijk_opt2.csv
+./cache -c 2000000 --cacheline-size 16 --l1-lines 4 --l2-lines 16 --prefetch-buffer 4 -p true examples/ijk/ijk_opt2.csv
 echo "=================================================================================="
 
 make clean
\ No newline at end of file
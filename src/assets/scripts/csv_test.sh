@@ -0,0 +1,75 @@
+#!/bin/bash
+
+# Initialize test status
+test_status=0
+
+: '
+The CSV tokenizer must accept exactly the grammar of the previous sscanf() parser.
+Every valid spelling of the same requests must simulate exactly like the plain one,
+and every invalid row must fail with the same error message.
+'
+
+# The .csv files are written to a temporary directory
+csv_dir=$(mktemp -d)
+trap 'rm -rf "$csv_dir"' EXIT
+
+printf 'R,0x10\nW,0x20,5\nR,48\nW,64,0xff\nR,0x10\n' > "$csv_dir/plain.csv"
+
+# Function to simulate a .csv and compare the result with plain.csv
+run_test() {
+    echo "Testing: $1"
+    printf "$2" > "$csv_dir/variant.csv"
+    expected=$(./cache --engine=functional "$csv_dir/plain.csv" 2>/dev/null)
+    output=$(./cache --engine=functional "$csv_dir/variant.csv" 2>/dev/null)
+    if [[ "$output" == "$expected" && "$output" != "" ]]; then
+        echo "PASS: Same result as plain.csv."
+    else
+        echo "FAIL: Results differ."
+        echo "Expected: $expected"
+        echo "Received: $output"
+        test_status=1 # Mark test as failed
+    fi
+    echo "--------------------------------"
+}
+
+# Function to check for an expected error message
+run_error_test() {
+    echo "Testing: $1"
+    printf "$2" > "$csv_dir/invalid.csv"
+    output=$(./cache "$csv_dir/invalid.csv" 2>&1)
+    if [[ "$output" == *"$3"* ]]; then
+        echo "PASS: Expected error found."
+    else
+        echo "FAIL: Expected error not found."
+        echo "Expected: $3"
+        echo "Received: $output"
+        test_status=1 # Mark test as failed
+    fi
+    echo "--------------------------------"
+}
+
+# Test: Valid spellings of plain.csv
+run_test "Uppercase 0X" 'R,0X10\nW,0X20,5\nR,48\nW,64,0XFF\nR,0X10\n'
+run_test "Decimal" 'R,16\nW,32,5\nR,48\nW,64,255\nR,16\n'
+run_test "Spaces everywhere" ' R , 0x10\nW, 0x 20 , 5 \nR,48,  \n W ,64,0xff\nR,0x10,\n'
+run_test "Tabs around the data" 'R,0x10\nW,0x20,\t5\t\nR,48,\t\nW,64,0xff\nR,0x10\n'
+run_test "Windows line endings" 'R,0x10\r\nW,0x20,5\r\nR,48\r\nW,64,0xff\r\nR,0x10\r\n'
+run_test "Empty rows" '\nR,0x10\n\n   \nW,0x20,5\nR,48\n\n\nW,64,0xff\nR,0x10'
+run_test "Signs and wrap-around" 'R,+16\nW,0x20,-4294967291\nR,+48\nW,64,0xff\nR,0x10\n'
+run_test "Row split after 99 characters" "R,0x10,$(printf '%92s')W,0x20,5\\nR,48\\nW,64,0xff\\nR,0x10\\n"
+
+# Test: Invalid rows
+run_error_test "Fourth column" 'R,0x10\nW,0x20,5,6\n' "Invalid third collumn: 5,6"
+run_error_test "Missing address" 'R,0x10\nR\n' "Error in parsing the data - wrong format"
+run_error_test "Write without data" 'W,0x20\n' "Error in parsing the data - wrong format for write request"
+run_error_test "Read with data" 'R,0x10,5\n' "Error in parsing the data - wrong format for read request"
+run_error_test "Lowercase operation" 'r,0x10\n' "Error in parsing the data - unrecognized command"
+run_error_test "Tab in the operation" 'R\t,0x10\n' "Error in parsing the data - unrecognized command"
+
+# Report the final status
+if [ $test_status -eq 0 ]; then
+    echo "All tests passed."
+else
+    echo "Some tests failed."
+fi
+exit $test_status
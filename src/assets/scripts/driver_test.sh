@@ -0,0 +1,51 @@
+#!/bin/bash
+
+# Initialize test status
+test_status=0
+
+: '
+The event driver (default) and the CPU module (--driver=stream) must produce exactly
+the same cycles, hits and misses as the cycle by cycle driver (--driver=step) on every example trace.
+'
+
+# Function to run a configuration with every driver and compare the results
+run_test() {
+    expected=$(eval ./cache --driver=step $1 2>/dev/null | grep "Number of")
+    for driver in event stream; do
+        echo "Testing: ./cache --driver=$driver $1"
+        output=$(eval ./cache --driver=$driver $1 2>/dev/null | grep "Number of")
+        if [[ "$output" == "$expected" && "$output" != "" ]]; then
+            echo "PASS: Same result as --driver=step."
+        else
+            echo "FAIL: Results differ."
+            echo "Expected: $expected"
+            echo "Received: $output"
+            test_status=1 # Mark test as failed
+        fi
+        echo "--------------------------------"
+    done
+}
+
+for trace in examples/*/*.csv; do
+    # Test: Standard
+    run_test "-c 2000000 --cacheline-size 16 --l1-lines 4 --l2-lines 16 -p false $trace"
+
+    # Test: Storeback Buffer (Unconditional and Conditional)
+    run_test "-c 2000000 --cacheline-size 16 --l1-lines 4 --l2-lines 16 --storeback-buffer 4 -p false $trace"
+    run_test "-c 2000000 --cacheline-size 16 --l1-lines 4 --l2-lines 16 --storeback-buffer 4 --storeback-condition true -p false $trace"
+
+    # Test: Prefetching
+    run_test "-c 50000000 --cacheline-size 16 --l1-lines 4 --l2-lines 16 --prefetch-buffer 4 -p false $trace"
+
+    # Test: Write-back, with and without buffers
+    run_test "-c 2000000 --cacheline-size 16 --l1-lines 4 --l2-lines 16 --write-policy=back -p false $trace"
+    run_test "-c 50000000 --cacheline-size 16 --l1-lines 4 --l2-lines 16 --prefetch-buffer 2 --storeback-buffer 2 --write-policy=back -p false $trace"
+done
+
+# Test: Cycle limit reached in the middle of a request
+run_test "-c 1000 --storeback-buffer 4 -p false examples/ijk/ijk.csv"
+run_test "-c 1000 --prefetch-buffer 4 -p false examples/ijk/ijk.csv"
+run_test "-c 5000 --cacheline-size 16 --l1-lines 4 --l2-lines 8 --storeback-buffer 3 --write-policy=back -p false examples/ijk/ijk.csv"
+
+# Exit with the overall test status
+exit $test_status
@@ -32,5 +32,9 @@ run_test "./cache -c 2147483646 --cacheline-size 0 examples/ijk/ijk.csv" "L1 cac
 # Test 4: Cycles to simulate is less than 0
 run_test "./cache --cycles -1 examples/ijk/ijk.csv" "Cycles to simulate is less than 0"
 
+# Test 5: Functional engine does not model buffers or signals
+run_test "./cache --engine=functional --storeback-buffer 4 examples/ijk/ijk.csv" "The functional engine does not support buffers or trace files"
+run_test "./cache --engine=functional --prefetch-buffer 4 examples/ijk/ijk.csv" "The functional engine does not support buffers or trace files"
+
 # Exit with the overall test status
 exit $test_status
\ No newline at end of file
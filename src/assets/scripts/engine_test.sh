@@ -0,0 +1,106 @@
+#!/bin/bash
+
+# Initialize test status
+test_status=0
+
+: '
+The functional engine (--engine=functional) must produce exactly the same cycles, hits, misses
+and gates as the SystemC engine, for direct-mapped and set-associative caches with every replacement policy,
+and for write-through and write-back caches.
+
+The stack-distance engine (--engine=stack-distance) must count the same L1 hits and misses as the
+functional engine with write-back (write-allocate) LRU caches, and its miss-ratio curves must match
+the L1 misses of the functional engine for the cache sizes on the curves. Its layout only shows L1,
+it does not model L2, writebacks or RAM.
+'
+
+# Function to run a configuration with both engines and compare the results
+run_test() {
+    echo "Testing: ./cache --engine=functional $1"
+    expected=$(eval ./cache --engine=systemc $1 2>/dev/null | grep "Number of")
+    output=$(eval ./cache --engine=functional $1 2>/dev/null | grep "Number of")
+    if [[ "$output" == "$expected" && "$output" != "" ]]; then
+        echo "PASS: Same result as --engine=systemc."
+    else
+        echo "FAIL: Results differ."
+        echo "Expected: $expected"
+        echo "Received: $output"
+        test_status=1 # Mark test as failed
+    fi
+    echo "--------------------------------"
+}
+
+# Function to compare the L1 of the stack-distance engine with the functional engine
+run_stack_distance_test() {
+    echo "Testing: ./cache --engine=stack-distance $1"
+    expected=$(eval ./cache --engine=functional --write-policy=back $1 2>/dev/null | grep -E "Read Hits|Write Hits" | head -2)
+    layout=$(eval ./cache --engine=stack-distance $1 2>/dev/null)
+    output=$(echo "$layout" | grep -E "Read Hits|Write Hits" | head -2)
+    if echo "$layout" | grep -qE "L2 Cache|Writebacks|RAM Requests"; then
+        echo "FAIL: The layout shows L2, writebacks or RAM."
+        test_status=1 # Mark test as failed
+    elif [[ "$output" == "$expected" && "$output" != "" ]]; then
+        echo "PASS: Same L1 hits and misses as --engine=functional."
+    else
+        echo "FAIL: Results differ."
+        echo "Expected: $expected"
+        echo "Received: $output"
+        test_status=1 # Mark test as failed
+    fi
+    echo "--------------------------------"
+}
+
+# Function to compare one point of a miss-ratio curve (line size $2, $3 lines, $4 ways) with the functional engine
+run_curve_test() {
+    echo "Testing: miss-ratio curve of $1 at line size $2, $3 lines, $4 ways"
+    column=$([[ "$4" == "$3" ]] && echo 5 || echo 6)
+    output=$(./cache --engine=stack-distance --l1-lines $3 --l1-ways $4 --l2-lines 65536 -p false $1 2>/dev/null | grep "^MRC, $2, $3," | awk -F', ' "{print \$$column}")
+    expected=$(./cache --engine=functional --write-policy=back --cacheline-size $2 --l1-lines $3 --l1-ways $4 --l2-lines 65536 $1 2>/dev/null \
+        | grep -E "Read Hits|Write Hits" | head -2 | grep -oE "Misses: [0-9]+" | awk '{ sum += $2 } END { print sum }')
+    if [[ "$output" == "$expected" && "$output" != "" ]]; then
+        echo "PASS: $output misses."
+    else
+        echo "FAIL: Results differ."
+        echo "Expected: $expected"
+        echo "Received: $output"
+        test_status=1 # Mark test as failed
+    fi
+    echo "--------------------------------"
+}
+
+for trace in examples/*/*.csv; do
+    # Test: Direct-mapped
+    run_test "--cacheline-size 16 --l1-lines 4 --l2-lines 16 -p false $trace"
+
+    # Test: Set-associative, every replacement policy
+    run_test "--cacheline-size 16 --l1-lines 4 --l2-lines 16 --l1-ways 2 --l2-ways 4 --replacement=lru -p false $trace"
+    run_test "--cacheline-size 16 --l1-lines 8 --l2-lines 16 --l1-ways 4 --l2-ways 2 --replacement=plru -p false $trace"
+    run_test "--cacheline-size 32 --l1-lines 8 --l2-lines 16 --l1-ways 8 --l2-ways 4 --replacement=fifo -p false $trace"
+    run_test "--cacheline-size 16 --l1-lines 4 --l2-lines 16 --l1-ways 4 --l2-ways 8 --replacement=random -p false $trace"
+
+    # Test: Number of sets is not a power of two
+    run_test "--cacheline-size 16 --l1-lines 12 --l2-lines 48 --l1-ways 3 --l2-ways 6 -p false $trace"
+
+    # Test: Write-back, direct-mapped and set-associative
+    run_test "--cacheline-size 16 --l1-lines 4 --l2-lines 16 --write-policy=back -p false $trace"
+    run_test "--cacheline-size 16 --l1-lines 4 --l2-lines 8 --l1-ways 2 --l2-ways 2 --replacement=random --write-policy=back -p false $trace"
+done
+
+for trace in examples/*/*.csv; do
+    # Test: Stack-distance L1, direct-mapped, set-associative and a number of sets that is not a power of two
+    run_stack_distance_test "--cacheline-size 16 --l1-lines 4 --l2-lines 16 $trace"
+    run_stack_distance_test "--cacheline-size 32 --l1-lines 8 --l2-lines 16 --l1-ways 4 $trace"
+    run_stack_distance_test "--cacheline-size 16 --l1-lines 12 --l2-lines 48 --l1-ways 3 $trace"
+
+    # Test: Miss-ratio curves, fully-associative and set-associative
+    run_curve_test $trace 16 32 32
+    run_curve_test $trace 64 256 256
+    run_curve_test $trace 8 64 2
+done
+
+# Test: Cycle limit reached in the middle of a request
+run_test "-c 1000 --l1-ways 4 --l2-ways 4 -p false examples/ijk/ijk.csv"
+run_test "-c 3000 --cacheline-size 16 --l1-lines 4 --l2-lines 8 --write-policy=back -p false examples/ijk/ijk.csv"
+
+# Exit with the overall test status
+exit $test_status
@@ -67,6 +67,54 @@ run_test "./cache -tsrc/assets/vcd/def examples/ijk/ijk.csv" "./cache: invalid o
 run_test "./cache --m 100 examples/ijk/ijk.csv" ""
 run_test "./cache -m 100 examples/ijk/ijk.csv" "./cache: invalid option -- 'm'"
 
+# Test: Simulation engine
+run_test "./cache --engine=functional examples/ijk/ijk.csv" ""
+run_test "./cache --engine systemc -c 100 examples/ijk/ijk.csv" ""
+run_test "./cache --engine=untimed examples/ijk/ijk.csv" "Invalid input for engine"
+run_test "./cache --engine=stack-distance --l1-ways 4 examples/ijk/ijk.csv" ""
+run_test "./cache --engine=stack-distance --l1-ways 4 --replacement=fifo examples/ijk/ijk.csv" "Invalid input: The stack-distance engine only supports LRU replacement"
+run_test "./cache --engine=stack-distance --prefetch-buffer 4 examples/ijk/ijk.csv" "Invalid input: The stack-distance engine does not support buffers or trace files"
+run_test "./cache --engine=stack-distance --write-policy=through examples/ijk/ijk.csv" "Invalid input: The stack-distance engine only supports write-back caches"
+run_test "./cache --engine=stack-distance --write-policy=back examples/ijk/ijk.csv" ""
+
+# Test: SystemC driver
+run_test "./cache --driver=step -c 1000 examples/ijk/ijk.csv" ""
+run_test "./cache --driver=stream -c 1000 examples/ijk/ijk.csv" ""
+run_test "./cache --driver=poll examples/ijk/ijk.csv" "Invalid input for driver"
+
+# Test: Set-associative caches
+run_test "./cache --l1-ways 4 --l2-ways 8 --replacement=plru -c 1000 examples/ijk/ijk.csv" ""
+run_test "./cache --l1-ways 3 examples/ijk/ijk.csv" "Invalid input: The number of ways must divide the number of cache lines"
+run_test "./cache --l2-ways 0 examples/ijk/ijk.csv" "Invalid input: The number of ways must divide the number of cache lines"
+run_test "./cache --l1-lines 12 --l1-ways 3 --replacement=plru examples/ijk/ijk.csv" "Invalid input: PLRU replacement needs a power of two number of ways"
+run_test "./cache --replacement=mru examples/ijk/ijk.csv" "Invalid input for replacement"
+
+# Test: Write policy
+run_test "./cache --write-policy=back -c 1000 examples/ijk/ijk.csv" ""
+run_test "./cache --write-policy=back --engine=functional examples/ijk/ijk.csv" ""
+run_test "./cache --write-policy=through -c 1000 examples/ijk/ijk.csv" ""
+run_test "./cache --write-policy=around examples/ijk/ijk.csv" "Invalid input for write-policy"
+
+# Test: Timing only
+run_test "./cache --timing-only true -c 1000 examples/ijk/ijk.csv" ""
+run_test "./cache --timing-only false -c 1000 examples/ijk/ijk.csv" ""
+run_test "./cache --timing-only yes examples/ijk/ijk.csv" "Invalid input for timing-only"
+run_test "./cache --timing-only true --tf=src/assets/vcd/def examples/ijk/ijk.csv" "Invalid input: timing-only does not support trace files"
+run_test "./cache --storeback-combine true --storeback-buffer 2 -c 1000 examples/ijk/ijk.csv" ""
+run_test "./cache --storeback-combine 2 examples/ijk/ijk.csv" "Invalid input for storeback-combine"
+run_test "./cache --storeback-flush=line --storeback-buffer 2 -c 1000 examples/ijk/ijk.csv" ""
+run_test "./cache --storeback-flush=some examples/ijk/ijk.csv" "Invalid input for storeback-flush"
+run_test "./cache --storeback-forward true --storeback-buffer 2 -c 1000 examples/ijk/ijk.csv" ""
+run_test "./cache --storeback-forward 2 examples/ijk/ijk.csv" "Invalid input for storeback-forward"
+
+# Test: Prefetchers
+run_test "./cache --prefetcher=stride --prefetch-buffer 4 -c 1000 examples/ijk/ijk.csv" ""
+run_test "./cache --prefetcher=stream --prefetch-buffer 4 --prefetch-degree 2 --prefetch-distance 3 -c 1000 examples/ijk/ijk.csv" ""
+run_test "./cache --prefetcher=markov examples/ijk/ijk.csv" "Invalid input for prefetcher"
+run_test "./cache --prefetch-degree 0 --prefetch-buffer 4 examples/ijk/ijk.csv" "Invalid input for prefetch-degree"
+run_test "./cache --prefetch-degree 8 --prefetch-buffer 4 examples/ijk/ijk.csv" "Invalid input: The prefetch degree is greater than the prefetch buffer"
+run_test "./cache --prefetch-distance 0 --prefetch-buffer 4 examples/ijk/ijk.csv" "Invalid input for prefetch-distance"
+
 # Test: help
 run_test "./cache --help" ""
 run_test "./cache -h" ""
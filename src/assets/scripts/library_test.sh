@@ -0,0 +1,67 @@
+#!/bin/bash
+
+# Initialize test status
+test_status=0
+
+: '
+Every run of libcachesim (./library_test, see src/assets/library/library_test.c) must have the same cycles,
+hits, misses, gates, memory pages and writebacks as ./cache with the same options: in batches, after a reset,
+on a new handle that is stopped by the cycle limit, and on a new handle after that.
+'
+
+# Function to print the numbers of ./cache in the order of library_test
+cache_numbers() {
+    output=$(eval ./cache $1 2>/dev/null)
+    numbers=$(echo "$output" | grep "^Number of" | grep -oE "[0-9]+" | paste -sd ' ')
+    pages=$(echo "$output" | grep "Memory Pages Allocated" | sed -E 's/.*: ([0-9]+).*/\1/')
+    writebacks=$(echo "$output" | grep -oE "Writebacks: [0-9]+" | grep -oE "[0-9]+" | paste -sd ' ')
+    echo "$numbers ${pages:-0} ${writebacks:-0 0}"
+}
+
+# Function to run the library and compare every run with ./cache
+run_test() {
+    echo "Testing: ./library_test $1"
+    output=$(eval ./library_test $1 2>&1)
+    expected=$(cache_numbers "$1")
+    cut=$(echo "$output" | grep "^Cut " | grep -oE "[0-9]+")
+    expected_cut=$(cache_numbers "$1 -c $cut")
+
+    run_status=0
+    for run in 1 2 3 4; do
+        received=$(echo "$output" | grep "^Run $run: " | sed "s/^Run $run: //")
+        [[ $run -eq 3 ]] && want="$expected_cut" || want="$expected"
+        if [[ "$received" != "$want" || "$received" == "" ]]; then
+            echo "FAIL: Run $run differs from ./cache$([[ $run -eq 3 ]] && echo " -c $cut")"
+            echo "Expected: $want"
+            echo "Received: $received"
+            run_status=1
+        fi
+    done
+    if [ $run_status -eq 0 ]; then
+        echo "PASS: Every run matches ./cache."
+    else
+        test_status=1 # Mark test as failed
+    fi
+    echo "--------------------------------"
+}
+
+# Test: Functional engine
+run_test "--engine=functional examples/ijk/ijk.csv"
+run_test "--engine=functional --l1-ways 2 --l2-ways 4 --replacement=random --write-policy=back examples/kij/kij.csv"
+
+# Test: SystemC drivers
+run_test "examples/ijk/ijk.csv"
+run_test "--driver=step --l1-lines 8 --l2-lines 32 examples/ikj/ikj.csv"
+run_test "--driver=stream --cacheline-size 32 examples/jik/jik.csv"
+
+# Test: Buffers, set-associative and write-back caches
+run_test "--prefetch-buffer 4 --l1-lines 4 --l2-lines 16 examples/ijk/ijk_opt1.csv"
+run_test "--prefetch-buffer 4 --prefetcher=stride --prefetch-degree 2 --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/jki/jki.csv"
+run_test "--storeback-buffer 4 --storeback-condition true --l1-lines 4 --l2-lines 16 examples/ijk/ijk_opt1.csv"
+run_test "--driver=stream --storeback-buffer 2 examples/kji/kji.csv"
+run_test "--storeback-buffer 4 --storeback-flush=line --storeback-combine true --l1-lines 4 --l2-lines 16 examples/kij/kij.csv"
+run_test "--storeback-buffer 4 --storeback-forward true --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/jik/jik.csv"
+run_test "--l1-ways 2 --l2-ways 2 --replacement=plru --write-policy=back --l1-lines 8 --l2-lines 32 examples/jki/jki.csv"
+
+# Exit with the overall test status
+exit $test_status
@@ -0,0 +1,185 @@
+#!/bin/bash
+
+# Initialize test status
+test_status=0
+
+: '
+With a prefetch buffer, memory prefetches the lines that --prefetcher predicts after every read miss of L2.
+A prefetch can never be useful more often than it happened, and a read miss prefetches at most --prefetch-degree lines.
+
+On a trace that reads every 4th line, only the last line of a next-line prefetch is read,
+while stride must find the stride and save read misses of L2. On a trace that reads down, stream must follow it.
+Every driver and --timing-only must agree for every prefetcher.
+
+Next-line starts at the line right after the miss: on a trace that reads every word going up, every miss is followed
+by as many hits as the buffer holds lines. The read misses of L2 and the cycles are pinned, on every driver.
+
+The prefetches complete in the background, so a prefetch buffer must save cycles where its lines are read,
+and a read that comes before its line has arrived waits for it (a late prefetch) instead of reading it again.
+'
+
+# Reads of every 4th 16 byte line, in two interleaved regions (with their own entries of the table and sets of L2)
+strided=$(mktemp --suffix=.csv)
+# Reads of every word, going down
+sequential=$(mktemp --suffix=.csv)
+# Reads of every word, going up
+ascending=$(mktemp --suffix=.csv)
+trap 'rm -f "$strided" "$sequential" "$ascending"' EXIT
+for ((i = 0; i < 2000; i++)); do
+    printf "R,0x%x,\n" $((i * 64))
+    printf "R,0x%x,\n" $((0x108800 + i * 64))
+done > "$strided"
+for ((i = 4000; i > 0; i--)); do
+    printf "R,0x%x,\n" $((i * 4))
+done > "$sequential"
+for ((i = 0; i < 4000; i++)); do
+    printf "R,0x%x,\n" $((i * 4))
+done > "$ascending"
+
+# Function to print a number of the output
+number() {
+    echo "$1" | grep -oE "$2: [0-9]+" | head -1 | grep -oE "[0-9]+"
+}
+
+# Function to check the prefetch counters of a configuration
+run_test() {
+    echo "Testing: ./cache $1"
+    output=$(eval ./cache $1 2>/dev/null)
+    prefetches=$(number "$output" "Prefetches")
+    useful=$(number "$output" "Useful Prefetches")
+    misses_L2=$(echo "$output" | grep -oE "Read Misses: [0-9]+" | tail -1 | grep -oE "[0-9]+")
+    degree=$(echo "$output" | grep -oE "Degree: [0-9]+" | grep -oE "[0-9]+")
+
+    if [[ "$output" == "" || -z "$prefetches" || -z "$useful" ]]; then
+        echo "FAIL: No prefetch counters."
+        test_status=1 # Mark test as failed
+    elif [[ "$useful" -gt "$prefetches" ]]; then
+        echo "FAIL: $useful useful prefetches, but only $prefetches prefetches."
+        test_status=1 # Mark test as failed
+    elif [[ "$prefetches" -gt $((misses_L2 * degree)) ]]; then
+        echo "FAIL: $prefetches prefetches, more than $degree for each of the $misses_L2 read misses of L2."
+        test_status=1 # Mark test as failed
+    else
+        echo "PASS: $prefetches prefetches, $useful useful."
+    fi
+    echo "--------------------------------"
+}
+
+# Function to check the read misses of L2 and the cycles of a configuration
+run_pinned_test() {
+    for option in "" "--driver=step" "--timing-only true"; do
+        echo "Testing: ./cache $option $1"
+        output=$(eval ./cache $option $1 2>/dev/null)
+        misses=$(echo "$output" | grep -oE "Read Misses: [0-9]+" | tail -1 | grep -oE "[0-9]+")
+        cycles=$(number "$output" "Number of Cycles Simulated")
+
+        if [[ "$misses" != "$2" || "$cycles" != "$3" ]]; then
+            echo "FAIL: ${misses:-no} read misses of L2 and ${cycles:-no} cycles, expected $2 and $3."
+            test_status=1 # Mark test as failed
+        else
+            echo "PASS: $misses read misses of L2, $cycles cycles."
+        fi
+        echo "--------------------------------"
+    done
+}
+
+# Function to compare a prefetcher with next-line, it must have more useful prefetches and fewer cycles
+run_compare_test() {
+    echo "Testing: ./cache --prefetcher=$1 $2"
+    expected=$(eval ./cache --prefetcher=nextline $2 2>/dev/null)
+    output=$(eval ./cache --prefetcher=$1 $2 2>/dev/null)
+    useful_expected=$(number "$expected" "Useful Prefetches")
+    useful_output=$(number "$output" "Useful Prefetches")
+    cycles_expected=$(number "$expected" "Number of Cycles Simulated")
+    cycles_output=$(number "$output" "Number of Cycles Simulated")
+
+    if [[ "$output" == "" || -z "$useful_output" ]]; then
+        echo "FAIL: No prefetch counters."
+        test_status=1 # Mark test as failed
+    elif [[ "$useful_output" -le "$useful_expected" || "$cycles_output" -ge "$cycles_expected" ]]; then
+        echo "FAIL: $useful_output useful prefetches instead of $useful_expected, $cycles_output instead of $cycles_expected cycles."
+        test_status=1 # Mark test as failed
+    else
+        echo "PASS: $useful_output instead of $useful_expected useful prefetches, $cycles_output instead of $cycles_expected cycles."
+    fi
+    echo "--------------------------------"
+}
+
+# Function to run a configuration with and without the prefetch buffer, it must save cycles
+run_background_test() {
+    echo "Testing: ./cache --prefetch-buffer $1 $2"
+    expected=$(eval ./cache $2 2>/dev/null)
+    output=$(eval ./cache --prefetch-buffer $1 $2 2>/dev/null)
+    cycles_expected=$(number "$expected" "Number of Cycles Simulated")
+    cycles_output=$(number "$output" "Number of Cycles Simulated")
+    late=$(number "$output" "Late Prefetches")
+
+    if [[ "$output" == "" || -z "$late" ]]; then
+        echo "FAIL: No prefetch counters."
+        test_status=1 # Mark test as failed
+    elif [[ "$cycles_output" -ge "$cycles_expected" ]]; then
+        echo "FAIL: $cycles_output cycles, not fewer than the $cycles_expected without prefetching."
+        test_status=1 # Mark test as failed
+    elif [[ -n "$3" && "$late" -lt "$3" ]]; then
+        echo "FAIL: $late late prefetches, expected at least $3."
+        test_status=1 # Mark test as failed
+    else
+        echo "PASS: $cycles_output instead of $cycles_expected cycles, $late late prefetches."
+    fi
+    echo "--------------------------------"
+}
+
+# Function to compare a configuration on every driver and with --timing-only
+run_drivers_test() {
+    echo "Testing: every driver, ./cache $1"
+    expected=$(eval ./cache $1 2>/dev/null | grep -vE "Memory Pages Allocated|^Info:|^$")
+    driver_status=0
+    for option in "--driver=step" "--driver=event" "--driver=stream" "--timing-only true"; do
+        output=$(eval ./cache $option $1 2>/dev/null | grep -vE "Memory Pages Allocated|^Info:|^$")
+        if [[ "$output" != "$expected" || "$output" == "" ]]; then
+            echo "FAIL: $option differs."
+            diff <(echo "$expected") <(echo "$output")
+            driver_status=1
+        fi
+    done
+    if [ $driver_status -eq 0 ]; then
+        echo "PASS: Every driver agrees."
+    else
+        test_status=1 # Mark test as failed
+    fi
+    echo "--------------------------------"
+}
+
+# Test: The counters of every prefetcher
+run_test "--prefetch-buffer 4 --cacheline-size 16 --memory-latency 50 $strided"
+run_test "--prefetch-buffer 4 --prefetcher=stride --cacheline-size 16 --memory-latency 50 $strided"
+run_test "--prefetch-buffer 4 --prefetcher=stream --prefetch-degree 2 --cacheline-size 16 $sequential"
+run_test "--prefetch-buffer 8 --prefetcher=stride --prefetch-degree 3 --prefetch-distance 2 --l1-lines 4 --l2-lines 16 examples/jki/jki.csv"
+run_test "--write-policy=back --prefetch-buffer 4 --prefetcher=stream --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/kij/kij.csv"
+
+# Test: Next-line starts at the line right after the miss (1000 lines, a miss every 5 or 3 lines)
+run_pinned_test "--prefetch-buffer 4 --cacheline-size 16 --memory-latency 50 $ascending" 200 45800
+run_pinned_test "--prefetch-buffer 2 --cacheline-size 16 --memory-latency 50 $ascending" 334 55027
+run_pinned_test "--prefetch-buffer 4 --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/ijk/ijk.csv" 3918 1019832
+run_pinned_test "--write-policy=back --prefetch-buffer 2 --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/kij/kij.csv" 2297 528724
+
+# Test: Stride finds the stride and stream the direction that next-line misses
+run_compare_test stride "--prefetch-buffer 4 --cacheline-size 16 --memory-latency 50 $strided"
+run_compare_test stride "--prefetch-buffer 4 --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/jki/jki.csv"
+run_compare_test stride "--prefetch-buffer 4 --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/ijk/ijk.csv"
+run_compare_test stream "--prefetch-buffer 4 --cacheline-size 16 --memory-latency 50 $sequential"
+
+# Test: The prefetches do not hold up the reads
+run_background_test 4 "--prefetcher=stream --cacheline-size 16 --memory-latency 50 $sequential" 1
+run_background_test 4 "--cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/ijk/ijk.csv"
+run_background_test 4 "--prefetcher=stride --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/jki/jki.csv"
+run_background_test 2 "--prefetcher=stride --storeback-buffer 4 --write-policy=back --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/kji/kji.csv"
+
+# Test: Drivers and timing-only
+run_drivers_test "--prefetch-buffer 4 --cacheline-size 16 --memory-latency 50 $strided"
+run_drivers_test "--prefetch-buffer 4 --prefetcher=stride --cacheline-size 16 --memory-latency 50 $strided"
+run_drivers_test "--prefetch-buffer 4 --prefetcher=stream --prefetch-degree 2 --cacheline-size 16 $sequential"
+run_drivers_test "--prefetch-buffer 2 --prefetcher=stride --storeback-buffer 4 --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/jik/jik.csv"
+
+# Exit with the overall test status
+exit $test_status
@@ -0,0 +1,289 @@
+#!/bin/bash
+
+# Initialize test status
+test_status=0
+
+: '
+A read miss of L2 must see the writes that are still in the storeback buffer, including the one memory is writing:
+it waits until they are written and then reads its line from memory, it must not take the done of the last write
+for its own. The read must return the written word, also at an offset in its line (L2 reads the line from memory
+from its first byte), and the cycles of the storeback configurations are pinned.
+
+With --storeback-combine true, writes to a line that is still in the storeback buffer are merged into its entry.
+Only the RAM requests and the cycles may change: the hits and misses of L1 and L2 must be the same as without it,
+the RAM write requests must go down by the combined writes, and every driver and --timing-only must agree.
+
+With --storeback-flush=line, a read miss only waits for the entries of its line, it aborts the write of another line
+that memory is doing. The hits and misses must be the same as with --storeback-flush=all, with no more flush stalls
+(fewer when the line of the read is not the last one written), and every driver and --timing-only must agree.
+
+With --storeback-forward true, a read miss takes the bytes of its line from the storeback buffer instead of flushing it.
+The hits and misses must be the same as without it, and a line that is written and then read must come from the buffer.
+The read does not stall on the entries of its line, and a forwarded load is only counted when bytes came from the buffer.
+'
+
+# Sequential writes, 4 bytes apart, with a read every 4th request
+trace=$(mktemp --suffix=.csv)
+# A write into the storeback buffer, then a read of the same word
+data=$(mktemp --suffix=.csv)
+# The same, at an offset in the line
+offset=$(mktemp --suffix=.csv)
+vcd=$(mktemp -d)
+# Writes to two lines, then a read of the first one (its entry is not the last one in the buffer)
+lines=$(mktemp --suffix=.csv)
+# Every 16 byte line is written and then read
+written=$(mktemp --suffix=.csv)
+# A write, then a read of its line and a read of another line
+forward=$(mktemp --suffix=.csv)
+trap 'rm -rf "$trace" "$data" "$offset" "$vcd" "$lines" "$written" "$forward"' EXIT
+for ((i = 0; i < 4000; i++)); do
+    if ((i % 4 == 0)); then
+        printf "R,0x%x,\n" $((i * 4))
+    else
+        printf "W,0x%x,%d\n" $((i * 4)) $i
+    fi
+done > "$trace"
+printf "W,0x1000,0x11223344\nR,0x1000,\n" > "$data"
+printf "W,0x1004,0x11223344\nR,0x1004,\n" > "$offset"
+for ((i = 0; i < 500; i++)); do
+    printf "W,0x%x,%d\nW,0x%x,%d\nR,0x%x,\n" $((0x100000 + i * 64)) $i $((0x200000 + i * 64)) $i $((0x100000 + i * 64))
+done > "$lines"
+for ((i = 0; i < 1000; i++)); do
+    for ((j = 0; j < 4; j++)); do
+        printf "W,0x%x,%d\n" $((i * 16 + j * 4)) $((i + j))
+    done
+    printf "R,0x%x,\n" $((i * 16))
+done > "$written"
+printf "W,0x3000,3\nR,0x3000,\nR,0x4000,\n" > "$forward"
+
+# Function to print a number of the output
+number() {
+    echo "$1" | grep -oE "$2: [0-9]+" | head -1 | grep -oE "[0-9]+"
+}
+
+# Function to print the last word that L1 returned to the CPU (Data_Out of a --tf trace file), in hex
+read_word() {
+    awk '$1 == "$var" && $5 == "Data_Out_0" { code = $4 }
+        code != "" && $2 == code && $1 ~ /^b/ { value = substr($1, 2) }
+        END { n = 0; for (i = 1; i <= length(value); i++) n = n * 2 + substr(value, i, 1); printf "0x%x\n", n }' "$1"
+}
+
+# Function to run a configuration with and without combining and compare the outputs
+run_test() {
+    echo "Testing: ./cache --storeback-combine true $1"
+    expected=$(eval ./cache $1 2>/dev/null)
+    output=$(eval ./cache --storeback-combine true $1 2>/dev/null)
+    combined=$(number "$output" "Combined Writes")
+    writes=$(( $(number "$expected" "Number of Write Requests") - ${combined:-0} ))
+    caches_expected=$(echo "$expected" | grep -E "Hits|Misses|Writebacks")
+    caches_output=$(echo "$output" | grep -E "Hits|Misses|Writebacks")
+
+    if [[ "$output" == "" || "$caches_output" != "$caches_expected" ]]; then
+        echo "FAIL: The hits, misses or writebacks differ."
+        diff <(echo "$caches_expected") <(echo "$caches_output")
+        test_status=1 # Mark test as failed
+    elif [[ "$(number "$output" "Number of Write Requests")" != "$writes" ]]; then
+        echo "FAIL: $combined combined writes, but RAM write requests are not $writes."
+        test_status=1 # Mark test as failed
+    elif [[ -n "$2" && "$combined" -lt "$2" ]]; then
+        echo "FAIL: $combined combined writes, expected at least $2."
+        test_status=1 # Mark test as failed
+    else
+        echo "PASS: Same hits and misses, $combined combined writes."
+    fi
+    echo "--------------------------------"
+}
+
+# Function to check the cycles of a configuration
+run_cycles_test() {
+    echo "Testing: ./cache $1"
+    output=$(eval ./cache $1 2>/dev/null)
+    cycles=$(number "$output" "Number of Cycles Simulated")
+
+    if [[ "$cycles" != "$2" ]]; then
+        echo "FAIL: ${cycles:-no} cycles, expected $2."
+        test_status=1 # Mark test as failed
+    else
+        echo "PASS: $cycles cycles."
+    fi
+    echo "--------------------------------"
+}
+
+# Function to check the word that a read gets after a write into the storeback buffer
+# (the trace is W,0x1000,0x11223344 then R,0x1000, or the second argument)
+run_data_test() {
+    trace_file=${2:-$data}
+    read_line=$(tail -1 "$trace_file")
+    echo "Testing: ./cache $1 ($(head -1 "$trace_file") then ${read_line%,})"
+    rm -f "$vcd/out.vcd"
+    eval ./cache --tf="$vcd/out" $1 "$trace_file" > /dev/null 2>&1
+    word=$(read_word "$vcd/out.vcd" 2>/dev/null)
+
+    if [[ "$word" != "0x11223344" ]]; then
+        echo "FAIL: The read returned ${word:-nothing}."
+        test_status=1 # Mark test as failed
+    else
+        echo "PASS: The read returned $word."
+    fi
+    echo "--------------------------------"
+}
+
+# Function to run a configuration with a selective and a full flush and compare the outputs
+# (with a second argument, the selective flush must stall fewer cycles)
+run_flush_test() {
+    echo "Testing: ./cache --storeback-flush=line $1"
+    expected=$(eval ./cache --storeback-flush=all $1 2>/dev/null)
+    output=$(eval ./cache --storeback-flush=line $1 2>/dev/null)
+    caches_expected=$(echo "$expected" | grep -E "Hits|Misses|Writebacks")
+    caches_output=$(echo "$output" | grep -E "Hits|Misses|Writebacks")
+    stalls_expected=$(number "$expected" "Flush Stalls")
+    stalls_output=$(number "$output" "Flush Stalls")
+    cycles_expected=$(number "$expected" "Number of Cycles Simulated")
+    cycles_output=$(number "$output" "Number of Cycles Simulated")
+
+    if [[ "$output" == "" || "$caches_output" != "$caches_expected" ]]; then
+        echo "FAIL: The hits, misses or writebacks differ."
+        diff <(echo "$caches_expected") <(echo "$caches_output")
+        test_status=1 # Mark test as failed
+    elif [[ -z "$stalls_output" || "$stalls_output" -gt "$stalls_expected" ]]; then
+        echo "FAIL: ${stalls_output:-no} flush stalls, more than the $stalls_expected of a full flush."
+        test_status=1 # Mark test as failed
+    elif [[ -n "$2" && "$stalls_output" -ge "$stalls_expected" ]]; then
+        echo "FAIL: $stalls_output flush stalls, not fewer than the $stalls_expected of a full flush."
+        test_status=1 # Mark test as failed
+    else
+        echo "PASS: Same hits and misses, $stalls_output instead of $stalls_expected flush stalls, $cycles_output instead of $cycles_expected cycles."
+    fi
+    echo "--------------------------------"
+}
+
+# Function to run a configuration with and without forwarding and compare the outputs
+run_forward_test() {
+    echo "Testing: ./cache --storeback-forward true $1"
+    expected=$(eval ./cache $1 2>/dev/null)
+    output=$(eval ./cache --storeback-forward true $1 2>/dev/null)
+    caches_expected=$(echo "$expected" | grep -E "Hits|Misses|Writebacks")
+    caches_output=$(echo "$output" | grep -E "Hits|Misses|Writebacks")
+    cycles_expected=$(number "$expected" "Number of Cycles Simulated")
+    cycles_output=$(number "$output" "Number of Cycles Simulated")
+    loads=$(number "$output" "Buffer Loads")
+
+    if [[ "$output" == "" || "$caches_output" != "$caches_expected" ]]; then
+        echo "FAIL: The hits, misses or writebacks differ."
+        diff <(echo "$caches_expected") <(echo "$caches_output")
+        test_status=1 # Mark test as failed
+    elif [[ -n "$2" && ( "${loads:-0}" -lt "$2" || "$cycles_output" -ge "$cycles_expected" ) ]]; then
+        echo "FAIL: $loads buffer loads (expected at least $2), $cycles_output instead of $cycles_expected cycles."
+        test_status=1 # Mark test as failed
+    else
+        echo "PASS: Same hits and misses, $loads buffer loads, $cycles_output instead of $cycles_expected cycles."
+    fi
+    echo "--------------------------------"
+}
+
+# Function to check that a read of a line with entries in the storeback buffer does not stall on them with forwarding,
+# and that only the loads which took bytes from the buffer are counted (also with --timing-only)
+run_forward_count_test() {
+    for option in "" "--timing-only true"; do
+        echo "Testing: ./cache --storeback-forward true $option $1"
+        output=$(eval ./cache --storeback-forward true $option $1 2>/dev/null)
+        stalls=$(number "$output" "Flush Stalls")
+        forwarded=$(number "$output" "Forwarded Loads")
+
+        if [[ "$stalls" != "0" || "$forwarded" != "$2" ]]; then
+            echo "FAIL: ${stalls:-no} flush stalls and ${forwarded:-no} forwarded loads, expected 0 and $2."
+            test_status=1 # Mark test as failed
+        else
+            echo "PASS: No flush stalls, $forwarded forwarded loads."
+        fi
+        echo "--------------------------------"
+    done
+}
+
+# Function to compare a configuration on every driver and with --timing-only
+run_drivers_test() {
+    echo "Testing: every driver, ./cache $1"
+    expected=$(eval ./cache $1 2>/dev/null | grep -vE "Memory Pages Allocated|^Info:|^$")
+    driver_status=0
+    for option in "--driver=step" "--driver=event" "--driver=stream" "--timing-only true"; do
+        output=$(eval ./cache $option $1 2>/dev/null | grep -vE "Memory Pages Allocated|^Info:|^$")
+        if [[ "$output" != "$expected" || "$output" == "" ]]; then
+            echo "FAIL: $option differs."
+            diff <(echo "$expected") <(echo "$output")
+            driver_status=1
+        fi
+    done
+    if [ $driver_status -eq 0 ]; then
+        echo "PASS: Every driver agrees."
+    else
+        test_status=1 # Mark test as failed
+    fi
+    echo "--------------------------------"
+}
+
+# Test: A read after a write into the storeback buffer gets the written word
+run_data_test "--storeback-buffer 4"
+run_data_test "--storeback-buffer 1 --memory-latency 50"
+run_data_test "--storeback-buffer 4 --storeback-condition true"
+run_data_test "--storeback-buffer 4 --driver=step"
+run_data_test "--storeback-buffer 2 --write-policy=back"
+run_data_test "" "$offset"
+run_data_test "--storeback-buffer 4" "$offset"
+run_data_test "--storeback-buffer 2 --write-policy=back" "$offset"
+run_data_test "--prefetch-buffer 4" "$offset"
+run_data_test "--prefetch-buffer 4 --driver=step" "$offset"
+run_data_test "--storeback-combine true --storeback-buffer 4 --memory-latency 50"
+run_data_test "--storeback-flush=line --storeback-buffer 4"
+run_data_test "--storeback-forward true --storeback-flush=line --storeback-buffer 4 --memory-latency 50"
+run_data_test "--storeback-forward true --storeback-buffer 4 --memory-latency 50"
+run_data_test "--storeback-forward true --storeback-flush=line --storeback-buffer 4 --memory-latency 50" "$offset"
+
+# Test: Cycles with a storeback buffer (16 B lines, 4/16 lines)
+run_cycles_test "--storeback-buffer 4 --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/ijk/ijk.csv" 1052511
+run_cycles_test "--storeback-buffer 4 --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/jik/jik.csv" 1141647
+run_cycles_test "--storeback-buffer 4 --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/kji/kji.csv" 1441215
+run_cycles_test "--storeback-buffer 4 --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/ikj/ikj.csv" 695547
+run_cycles_test "--storeback-buffer 4 --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/transpose/a.csv" 33231
+run_cycles_test "--storeback-buffer 4 --storeback-condition true --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/transpose/a.csv" 33171
+run_cycles_test "--storeback-buffer 4 --write-policy=back --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/transpose/a.csv" 69450
+
+# Test: Sequential writes are combined
+run_test "--storeback-buffer 4 --memory-latency 20 $trace" 1
+run_test "--storeback-buffer 1 --memory-latency 100 --cacheline-size 32 $trace" 1
+run_test "--storeback-buffer 8 --storeback-condition true --memory-latency 50 $trace" 1
+
+# Test: Matrix traces, few or no writes to the same line in a row
+run_test "--storeback-buffer 4 --l1-lines 4 --l2-lines 16 examples/ijk/ijk_opt1.csv"
+run_test "--storeback-buffer 4 --storeback-condition true --l1-lines 4 --l2-lines 16 examples/kij/kij.csv"
+run_test "--driver=stream --storeback-buffer 2 examples/kji/kji.csv"
+
+# Test: Write-back caches, the writebacks of L2 are whole lines
+run_test "--write-policy=back --storeback-buffer 4 --l1-lines 4 --l2-lines 8 --memory-latency 40 $trace"
+
+# Test: Selective flush
+run_flush_test "--storeback-buffer 4 $lines" fewer
+run_flush_test "--storeback-buffer 4 --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/jik/jik.csv" fewer
+run_flush_test "--storeback-buffer 4 --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/kji/kji.csv" fewer
+run_flush_test "--storeback-buffer 4 --storeback-condition true --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/ijk/ijk_opt1.csv"
+run_flush_test "--storeback-buffer 8 --memory-latency 50 $trace"
+run_flush_test "--write-policy=back --storeback-buffer 2 --cacheline-size 16 --l1-lines 4 --l2-lines 8 examples/kij/kij.csv"
+
+# Test: Store-to-load forwarding
+run_forward_test "--storeback-buffer 4 --cacheline-size 16 --memory-latency 50 $written" 900
+run_forward_test "--storeback-buffer 4 --storeback-combine true --cacheline-size 16 --memory-latency 50 $written" 400
+run_forward_test "--storeback-buffer 4 --storeback-flush=line --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/jik/jik.csv"
+run_forward_test "--storeback-buffer 8 --storeback-condition true --memory-latency 50 $trace"
+run_forward_test "--write-policy=back --storeback-buffer 2 --cacheline-size 16 --l1-lines 4 --l2-lines 8 examples/kij/kij.csv"
+run_forward_count_test "--storeback-flush=line --storeback-buffer 4 --memory-latency 50 $forward" 1
+run_forward_count_test "--storeback-flush=line --storeback-combine true --storeback-buffer 4 --memory-latency 50 $forward" 1
+
+# Test: Drivers and timing-only
+run_drivers_test "--storeback-combine true --storeback-buffer 4 --memory-latency 20 $trace"
+run_drivers_test "--storeback-combine true --storeback-buffer 2 --storeback-condition true --l1-lines 4 --l2-lines 16 examples/ijk/ijk_opt1.csv"
+run_drivers_test "--storeback-flush=line --storeback-buffer 4 --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/jik/jik.csv"
+run_drivers_test "--storeback-flush=line --storeback-combine true --write-policy=back --storeback-buffer 2 --l1-lines 4 --l2-lines 8 $trace"
+run_drivers_test "--storeback-forward true --storeback-buffer 4 --cacheline-size 16 --memory-latency 50 $written"
+run_drivers_test "--storeback-forward true --storeback-flush=line --storeback-buffer 4 --cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/jik/jik.csv"
+
+# Exit with the overall test status
+exit $test_status
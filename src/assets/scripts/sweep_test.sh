@@ -0,0 +1,125 @@
+#!/bin/bash
+
+# Initialize test status
+test_status=0
+
+: '
+Every row of ./cache-sweep must have the same cycles, hits, misses and gates as ./cache with the
+options of the row, and configurations that ./cache rejects must show its error message.
+The table must not depend on the number of workers, and the retime, lockstep and L1 filter modes of
+the functional engine must give the same table as simulating every configuration on its own.
+'
+
+options=(cacheline-size l1-lines l2-lines l1-latency l2-latency memory-latency prefetch-buffer storeback-buffer storeback-condition)
+
+# Function to run a sweep and compare every row with ./cache
+run_test() {
+    echo "Testing: ./cache-sweep $1"
+    table=$(eval ./cache-sweep -j 3 $1 2>&1 | grep "^SWEEP, [^C]")
+    serial=$(eval ./cache-sweep -j 1 --lockstep false --l1-filter false --retime false $1 2>&1 | grep "^SWEEP, [^C]")
+    if [[ "$table" == "" || "$table" != "$serial" ]]; then
+        echo "FAIL: The tables of 3 workers and 1 worker without retime, lockstep and L1 filter differ."
+        echo "Expected: $serial"
+        echo "Received: $table"
+        test_status=1 # Mark test as failed
+        echo "--------------------------------"
+        return
+    fi
+
+    row_status=0
+    while IFS= read -r row; do
+        IFS=',' read -ra columns <<< "${row#SWEEP, }"
+        args=""
+        for i in "${!options[@]}"; do
+            args+=" --${options[$i]} ${columns[$i]# }"
+        done
+        if [[ "${columns[9]# }" == "-" ]]; then
+            expected=$(eval ./cache $args $2 2>&1 >/dev/null | head -1)
+            output="${row#*, -, -, -, -, }"
+        else
+            expected=$(eval ./cache $args $2 2>/dev/null | grep "^Number of" | grep -oE "[0-9]+" | paste -sd ' ')
+            output=$(echo "${columns[@]:9:4}" | tr -s ' ' | sed 's/^ //')
+        fi
+        if [[ "$output" != "$expected" || "$output" == "" ]]; then
+            echo "FAIL: Row differs from ./cache$args $2"
+            echo "Expected: $expected"
+            echo "Received: $output"
+            row_status=1
+        fi
+    done <<< "$table"
+    if [ $row_status -eq 0 ]; then
+        echo "PASS: Every row matches ./cache."
+    else
+        test_status=1 # Mark test as failed
+    fi
+    echo "--------------------------------"
+}
+
+# Function to check for an expected error message
+run_error_test() {
+    echo "Testing: ./cache-sweep $1"
+    output=$(eval ./cache-sweep $1 2>&1)
+    if [[ "$output" == *"$2"* ]]; then
+        echo "PASS: Expected error found."
+    else
+        echo "FAIL: Expected error not found."
+        echo "Expected: $2"
+        echo "Received: $output"
+        test_status=1 # Mark test as failed
+    fi
+    echo "--------------------------------"
+}
+
+# Test: Cache sizes and latencies, including rejected configurations
+run_test "--cacheline-size 16,32 --l1-lines 4:16:x2 --l2-lines 8,32 -c 2000000 examples/ijk/ijk.csv" "-c 2000000 examples/ijk/ijk.csv"
+run_test "--l1-latency 2:14:6 --l2-latency 12 --memory-latency 50,100 examples/ikj/ikj.csv" "examples/ikj/ikj.csv"
+
+# Test: Buffers and the options of ./cache that are not swept
+run_test "--cacheline-size 16 --l1-lines 4 --l2-lines 16 --prefetch-buffer 0,4 examples/ijk/ijk_opt1.csv" \
+    "--cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/ijk/ijk_opt1.csv"
+run_test "--cacheline-size 16 --l1-lines 4 --l2-lines 16 --storeback-buffer 0:4:4 --storeback-condition false,true examples/ijk/ijk_opt1.csv" \
+    "--cacheline-size 16 --l1-lines 4 --l2-lines 16 examples/ijk/ijk_opt1.csv"
+run_test "--engine=functional --l1-ways 2 --write-policy=back --l1-lines 4:64:x4 --num-requests 5000 examples/ijk/ijk.csv" \
+    "--engine=functional --l1-ways 2 --write-policy=back --num-requests 5000 examples/ijk/ijk.csv"
+
+# Test: Lockstep mode, including set counts that are not a power of two and the cycle limit
+run_test "--engine=functional --retime false --cacheline-size 16,24 --l1-lines 4:64:x2 --l2-lines 64,96 --l1-latency 1,4 examples/ijk/ijk.csv" \
+    "--engine=functional examples/ijk/ijk.csv"
+run_test "--engine=functional -c 700000 --cacheline-size 16 --l1-lines 4,12 --l2-lines 16:48:16 examples/ijk/ijk_opt2.csv" \
+    "--engine=functional -c 700000 examples/ijk/ijk_opt2.csv"
+
+# Test: L1 filter mode, set-associative caches, the cycle limit and a direct-mapped sweep without lockstep
+run_test "--engine=functional --retime false --l1-ways 2 --l2-ways 4 --replacement=plru --cacheline-size 16,32 --l1-lines 8,16 --l2-lines 32:128:x2 --memory-latency 50,100 examples/kij/kij.csv" \
+    "--engine=functional --l1-ways 2 --l2-ways 4 --replacement=plru examples/kij/kij.csv"
+run_test "--engine=functional --retime false --l1-ways 4 --l2-ways 4 -c 700000 --l1-lines 16 --l2-lines 32,64 --l2-latency 5:25:10 examples/jki/jki_opt1.csv" \
+    "--engine=functional --l1-ways 4 --l2-ways 4 -c 700000 examples/jki/jki_opt1.csv"
+run_test "--engine=functional --retime false --lockstep false --l1-lines 4,12 --l2-lines 16,24,3 --l1-latency 1,3 examples/ijk/ijk.csv" \
+    "--engine=functional examples/ijk/ijk.csv"
+
+# Test: Retime mode, write-through and write-back caches, including the cycle limit
+run_test "--engine=functional --l1-lines 4,8 --l2-lines 16 --l1-latency 1:7:3 --l2-latency 5,20 --memory-latency 40,90 examples/jik/jik.csv" \
+    "--engine=functional examples/jik/jik.csv"
+run_test "--engine=functional --write-policy=back --l1-ways 2 --l2-ways 2 --replacement=fifo -c 450000 --l1-lines 8 --l2-lines 32 --l1-latency 1,6 --l2-latency 10:30:10 --memory-latency 60,150 examples/kji/kji.csv" \
+    "--engine=functional --write-policy=back --l1-ways 2 --l2-ways 2 --replacement=fifo -c 450000 examples/kji/kji.csv"
+
+# Test: Binary trace
+trace_file=$(mktemp --suffix=.trace)
+trap 'rm -f "$trace_file"' EXIT
+./cache --convert="$trace_file" examples/ikj/ikj_opt1.csv > /dev/null
+run_test "--l1-lines 16,32 --driver=stream $trace_file" "--driver=stream $trace_file"
+
+# Test: Invalid sweeps
+run_error_test "--l1-lines 16:4 examples/ijk/ijk.csv" "Invalid range for --l1-lines"
+run_error_test "--l1-lines 4:16:x1 examples/ijk/ijk.csv" "Invalid range for --l1-lines"
+run_error_test "--l2-lines 1:5000 examples/ijk/ijk.csv" "--l2-lines has more than 4096 values"
+run_error_test "-j 0 examples/ijk/ijk.csv" "Invalid input for jobs"
+run_error_test "--lockstep yes examples/ijk/ijk.csv" "Invalid input for lockstep"
+run_error_test "--l1-filter 1 examples/ijk/ijk.csv" "Invalid input for l1-filter"
+run_error_test "--retime no examples/ijk/ijk.csv" "Invalid input for retime"
+run_error_test "--tf=trace examples/ijk/ijk.csv" "does not work with cache-sweep"
+run_error_test "--pipelined-parse true examples/ijk/ijk.csv" "does not work with cache-sweep"
+run_error_test "--l1-lines 16" "Filename is missing"
+run_error_test "--l1-ways 3 --l1-lines 4,3 examples/ijk/ijk.csv" "Invalid input"
+
+# Exit with the overall test status
+exit $test_status
@@ -0,0 +1,53 @@
+#!/bin/bash
+
+# Initialize test status
+test_status=0
+
+: '
+With --timing-only true, L1, L2 and memory store no data. Everything but the memory pages must be the same
+as without it (cycles, hits, misses, gates, the hits and misses of each cache, the writebacks and the RAM requests),
+and no memory page may be allocated.
+'
+
+# Function to run a configuration with and without --timing-only and compare the outputs
+run_test() {
+    echo "Testing: ./cache --timing-only true $1"
+    expected=$(eval ./cache $1 2>/dev/null | grep -v "Memory Pages Allocated")
+    output=$(eval ./cache --timing-only true $1 2>/dev/null)
+    pages=$(echo "$output" | grep "Memory Pages Allocated" | sed -E 's/.*: ([0-9]+).*/\1/')
+    output=$(echo "$output" | grep -v "Memory Pages Allocated")
+
+    if [[ "$output" != "$expected" || "$output" == "" ]]; then
+        echo "FAIL: Results differ."
+        diff <(echo "$expected") <(echo "$output")
+        test_status=1 # Mark test as failed
+    elif [[ "$pages" != "0" ]]; then
+        echo "FAIL: $pages memory pages allocated."
+        test_status=1 # Mark test as failed
+    else
+        echo "PASS: Same result, no memory allocated."
+    fi
+    echo "--------------------------------"
+}
+
+# Test: Every driver
+run_test "examples/ijk/ijk.csv"
+run_test "--driver=step --l1-lines 8 --l2-lines 32 examples/ikj/ikj.csv"
+run_test "--driver=stream --cacheline-size 32 examples/jik/jik.csv"
+
+# Test: Storeback and prefetch buffers (the buffers get no data)
+run_test "--prefetch-buffer 4 --l1-lines 4 --l2-lines 16 examples/ijk/ijk_opt1.csv"
+run_test "--storeback-buffer 4 --l1-lines 4 --l2-lines 16 examples/kij/kij.csv"
+run_test "--storeback-buffer 4 --storeback-condition true --l1-lines 4 --l2-lines 16 examples/ijk/ijk_opt1.csv"
+run_test "--driver=stream --storeback-buffer 2 examples/kji/kji.csv"
+
+# Test: Set-associative and write-back caches, with and without buffers
+run_test "--l1-ways 2 --l2-ways 2 --replacement=plru --write-policy=back --l1-lines 8 --l2-lines 32 examples/jki/jki.csv"
+run_test "--cacheline-size 16 --l1-lines 4 --l2-lines 16 --prefetch-buffer 2 --storeback-buffer 2 --write-policy=back examples/kij/kij.csv"
+
+# Test: Cycle limit reached in the middle of a request
+run_test "-c 1000 --storeback-buffer 4 examples/ijk/ijk.csv"
+run_test "-c 5000 --cacheline-size 16 --l1-lines 4 --l2-lines 8 --storeback-buffer 3 --write-policy=back examples/ijk/ijk.csv"
+
+# Exit with the overall test status
+exit $test_status
@@ -0,0 +1,112 @@
+#!/bin/bash
+
+# Initialize test status
+test_status=0
+
+: '
+Every example trace is converted to a binary trace (--convert), with raw and delta-encoded records.
+Simulating the binary trace must print exactly the same as simulating the .csv.
+The same holds for the .csv parsed in batches during the simulation (--streaming-parse true),
+also on a second thread (--pipelined-parse true).
+'
+
+# Binary traces are written to a temporary directory
+trace_dir=$(mktemp -d)
+trap 'rm -rf "$trace_dir"' EXIT
+
+# Function to simulate a .csv and its binary trace with the same options and compare the results
+run_test() {
+    echo "Testing: ./cache $1 $3 (as $2)"
+    expected=$(eval ./cache $1 $3 2>/dev/null)
+    output=$(eval ./cache $1 $2 2>/dev/null)
+    if [[ "$output" == "$expected" && "$output" != "" ]]; then
+        echo "PASS: Same result as the .csv."
+    else
+        echo "FAIL: Results differ."
+        echo "Expected: $expected"
+        echo "Received: $output"
+        test_status=1 # Mark test as failed
+    fi
+    echo "--------------------------------"
+}
+
+# Function to simulate a .csv with and without a streaming parser ($2) and compare the results
+run_streaming_test() {
+    echo "Testing: ./cache $2 $1"
+    expected=$(eval ./cache $1 2>/dev/null)
+    output=$(eval ./cache $2 $1 2>/dev/null)
+    if [[ "$output" == "$expected" && "$output" != "" ]]; then
+        echo "PASS: Same result as without streaming."
+    else
+        echo "FAIL: Results differ."
+        echo "Expected: $expected"
+        echo "Received: $output"
+        test_status=1 # Mark test as failed
+    fi
+    echo "--------------------------------"
+}
+
+# Function to check for an expected error message
+run_error_test() {
+    echo "Testing: $1"
+    output=$(eval $1 2>&1 1>/dev/null) # Ignore stdout and capture stderr
+    if [[ "$output" == *"$2"* ]]; then
+        echo "PASS: Expected error received."
+    else
+        echo "FAIL: Expected error not received."
+        echo "Received: $output"
+        test_status=1 # Mark test as failed
+    fi
+    echo "--------------------------------"
+}
+
+for trace in examples/*/*.csv; do
+    name=$(basename "$trace" .csv)
+    ./cache --convert="$trace_dir/$name.trace" "$trace" > /dev/null
+    ./cache --convert="$trace_dir/${name}_delta.trace" --trace-format=delta "$trace" > /dev/null
+
+    for binary in "$trace_dir/$name.trace" "$trace_dir/${name}_delta.trace"; do
+        # Test: Standard
+        run_test "--cacheline-size 16 --l1-lines 4 --l2-lines 16" "$binary" "$trace"
+
+        # Test: First requests only, other engines
+        run_test "--num-requests 100 --engine=functional --write-policy=back" "$binary" "$trace"
+        run_test "--driver=stream --l1-ways 4 --l2-ways 4" "$binary" "$trace"
+    done
+done
+
+# Test: Streaming parser, with every engine and driver, and a cycle limit in the middle of the trace
+for trace in examples/ijk/ijk.csv examples/transpose/a.csv; do
+    for mode in "--streaming-parse true" "--pipelined-parse true"; do
+        run_streaming_test "--cacheline-size 16 --l1-lines 4 --l2-lines 16 $trace" "$mode"
+        run_streaming_test "--driver=stream --prefetch-buffer 4 $trace" "$mode"
+        run_streaming_test "--storeback-buffer 4 $trace" "$mode"
+        run_streaming_test "--engine=functional --write-policy=back --num-requests 500 $trace" "$mode"
+        run_streaming_test "--engine=stack-distance --l1-ways 4 $trace" "$mode"
+        run_streaming_test "-c 5000 --driver=stream $trace" "$mode"
+    done
+done
+
+# Test: Invalid binary traces
+head -c 30 "$trace_dir/ijk.trace" > "$trace_dir/truncated.trace"
+printf 'R,0x0,\n' > "$trace_dir/not_binary.trace"
+run_error_test "./cache $trace_dir/truncated.trace" "Error in parsing the binary trace - invalid header"
+run_error_test "./cache $trace_dir/not_binary.trace" "Error in parsing the binary trace - header is missing"
+run_error_test "./cache $trace_dir/missing.trace" "Failed to open input file"
+run_error_test "./cache --num-requests 100000 $trace_dir/ijk.trace" "Error: number of requests parsed does not match numRequests"
+run_error_test "./cache --convert=$trace_dir/ijk.bin examples/ijk/ijk.csv" "Invalid input for convert. Filename should end with .trace"
+run_error_test "./cache --trace-format=zip examples/ijk/ijk.csv" "Invalid input for trace-format"
+
+# Test: Invalid streaming parser input
+printf 'R,0x0,\nX,0x4,\n' > "$trace_dir/invalid.csv"
+run_error_test "./cache --streaming-parse true $trace_dir/invalid.csv" "Error in parsing the data - unrecognized command"
+run_error_test "./cache --streaming-parse true --num-requests 100000 examples/ijk/ijk.csv" "Error: number of requests parsed does not match numRequests"
+run_error_test "./cache --streaming-parse true $trace_dir/ijk.trace" "Invalid input: streaming-parse only works when simulating a .csv"
+run_error_test "./cache --streaming-parse yes examples/ijk/ijk.csv" "Invalid input for streaming-parse"
+run_error_test "./cache --pipelined-parse true $trace_dir/invalid.csv" "Error in parsing the data - unrecognized command"
+run_error_test "./cache --pipelined-parse true --num-requests 100000 examples/ijk/ijk.csv" "Error: number of requests parsed does not match numRequests"
+run_error_test "./cache --pipelined-parse true --convert=$trace_dir/x.trace examples/ijk/ijk.csv" "Invalid input: pipelined-parse only works when simulating a .csv"
+run_error_test "./cache --pipelined-parse yes examples/ijk/ijk.csv" "Invalid input for pipelined-parse"
+
+# Exit with the overall test status
+exit $test_status
@@ -0,0 +1,226 @@
+#include <systemc>
+#include "simulator.hpp"
+#include "../modules/modules.hpp"
+#include "../modules/functional.hpp"
+#include "../modules/send_requests.hpp"
+
+extern "C" {
+    #include "cachesim.h"
+    #include "parser/config_check.h"
+}
+
+/**
+ * @brief The memory hierarchy of the SystemC handles (see cachesim.h)
+ *
+ * @details
+ * Built by the first SystemC handle, then reset and kept for the next one, SystemC cannot build modules
+ * once the simulation has started. `systemcConfig` is the configuration it was built with.
+ */
+static CPU_L1_L2* systemcCaches = nullptr;
+static Config systemcConfig;
+static bool systemcInUse = false;
+
+/**
+ * @brief A simulator of one configuration (see cachesim.h)
+ */
+struct Cachesim {
+    Config config;
+    FUNCTIONAL_L1_L2* functional;   // the functional engine, nullptr for SystemC
+    CPU_L1_L2* systemc;             // systemcCaches, nullptr for the functional engine
+
+    int cycles;                     // remaining cycle budget of the run
+    bool forceTerminate;            // the cycle limit has been exceeded
+    bool finished;                  // cachesim_stats() has finished the run
+    CacheStats cacheStats;          // stats of the run so far
+};
+
+/**
+ * @brief The checks of ./cache (see check_config()) and the options that libcachesim does not support
+ * @return false if the configuration is rejected (the reason is printed to stderr)
+ */
+static bool supported_config(const Config* c) {
+    if (!check_config(c)) return false;
+
+    // only what the simulation needs: no miss-ratio curves and no signals to record
+    if (c->engine == ENGINE_STACK_DISTANCE) {
+        fprintf(stderr, "Invalid input: libcachesim does not support the stack-distance engine\n");
+        return false;
+    }
+    if (c->tracefile != NULL) {
+        fprintf(stderr, "Invalid input: libcachesim does not support trace files\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief true if both configurations build the same SystemC memory hierarchy (the cycle limit is not part of it)
+ */
+static bool same_hierarchy(const Config* a, const Config* b) {
+    return a->l1CacheLines == b->l1CacheLines && a->l2CacheLines == b->l2CacheLines && a->cacheLineSize == b->cacheLineSize
+        && a->l1CacheLatency == b->l1CacheLatency && a->l2CacheLatency == b->l2CacheLatency && a->memoryLatency == b->memoryLatency
+        && a->l1Ways == b->l1Ways && a->l2Ways == b->l2Ways && a->replacement == b->replacement && a->writePolicy == b->writePolicy
+        && a->prefetchBuffer == b->prefetchBuffer && a->storebackBuffer == b->storebackBuffer
+        && a->storebackBufferCondition == b->storebackBufferCondition && a->driver == b->driver
+        && a->timingOnly == b->timingOnly && a->storebackCombine == b->storebackCombine
+        && a->storebackFlush == b->storebackFlush && a->storebackForward == b->storebackForward
+        && a->prefetcher == b->prefetcher && a->prefetchDegree == b->prefetchDegree
+        && a->prefetchDistance == b->prefetchDistance;
+}
+
+/**
+ * @brief Empty stats and the full cycle limit
+ */
+static void start_run(Cachesim* sim) {
+    sim->cycles = sim->config.cycles;
+    sim->forceTerminate = false;
+    sim->finished = false;
+    sim->cacheStats = {};
+}
+
+extern "C" {
+    Config cachesim_default_config(void) {
+        Config config = {};
+        config.cycles = INT32_MAX;
+        config.l1CacheLines = 64;
+        config.l2CacheLines = 256;
+        config.cacheLineSize = 64;
+        config.l1CacheLatency = 4;
+        config.l2CacheLatency = 12;
+        config.memoryLatency = 100;
+        config.l1Ways = 1;
+        config.l2Ways = 1;
+        config.replacement = REPLACEMENT_LRU;
+        config.writePolicy = WRITE_THROUGH;
+        config.prettyPrint = true;
+        config.engine = ENGINE_SYSTEMC;
+        config.driver = DRIVER_EVENT;
+        return config;
+    }
+
+    Cachesim* cachesim_create(const Config* config) {
+        if (config == NULL || !supported_config(config)) return NULL;
+
+        if (config->engine == ENGINE_SYSTEMC) {
+            if (systemcInUse) {
+                fprintf(stderr, "Error: only one SystemC simulator at a time, destroy the other one first\n");
+                return NULL;
+            }
+            if (systemcCaches != nullptr && !same_hierarchy(config, &systemcConfig)) {
+                fprintf(stderr, "Error: SystemC elaborates only once, every SystemC simulator needs the same caches and buffers\n");
+                return NULL;
+            }
+        }
+
+        Cachesim* sim = new Cachesim();
+        sim->config = *config;
+        sim->config.requests = NULL;
+        sim->config.csvStream = NULL;
+        sim->functional = nullptr;
+        sim->systemc = nullptr;
+
+        if (config->engine == ENGINE_FUNCTIONAL) {
+            sim->functional = new FUNCTIONAL_L1_L2(
+                config->l1CacheLines, config->l2CacheLines, config->cacheLineSize,
+                config->l1CacheLatency, config->l2CacheLatency, config->memoryLatency,
+                config->l1Ways, config->l2Ways, config->replacement,
+                config->writePolicy == WRITE_BACK
+            );
+        }
+        else {
+            if (systemcCaches == nullptr) {
+                systemcCaches = new CPU_L1_L2(
+                    config->l1CacheLines, config->l2CacheLines, config->cacheLineSize,
+                    config->l1CacheLatency, config->l2CacheLatency, config->memoryLatency,
+                    NULL,
+                    config->prefetchBuffer, config->storebackBuffer, config->storebackBufferCondition,
+                    config->driver != DRIVER_STEP, config->driver == DRIVER_STREAM,
+                    config->l1Ways, config->l2Ways, config->replacement,
+                    config->writePolicy == WRITE_BACK, config->timingOnly, config->storebackCombine,
+                    config->storebackFlush == STOREBACK_FLUSH_LINE, config->storebackForward,
+                    config->prefetcher, config->prefetchDegree, config->prefetchDistance
+                );
+                systemcConfig = sim->config;
+            }
+            sim->systemc = systemcCaches;
+            systemcInUse = true;
+        }
+
+        start_run(sim);
+        return sim;
+    }
+
+    int cachesim_submit(Cachesim* sim, const struct Request* requests, size_t numRequests) {
+        if (sim->forceTerminate || sim->finished) return -1;
+
+        // the requests are only read
+        struct Request* batch = (struct Request*) requests;
+        sim->forceTerminate = (sim->functional != nullptr)
+            ? !send_requests(*sim->functional, numRequests, batch, sim->cycles, &sim->cacheStats)
+            : !send_requests(*sim->systemc, numRequests, batch, sim->cycles, &sim->cacheStats);
+
+        return sim->forceTerminate ? -1 : 0;
+    }
+
+    CacheStats cachesim_stats(Cachesim* sim) {
+        if (sim->finished) return sim->cacheStats;
+        sim->finished = true;
+
+        // same as the end of run_simulation()
+        if (sim->functional != nullptr) {
+            finish_requests(*sim->functional, sim->forceTerminate, sim->cycles, &sim->cacheStats);
+            sim->cacheStats.primitiveGateCount = sim->functional->get_gate_count();
+            sim->cacheStats.writebacks_L1 = sim->functional->writebacks_L1;
+            sim->cacheStats.writebacks_L2 = sim->functional->writebacks_L2;
+        }
+        else {
+            finish_requests(*sim->systemc, sim->forceTerminate, sim->cycles, &sim->cacheStats);
+            sim->cacheStats.primitiveGateCount = sim->systemc->get_gate_count();
+            sim->cacheStats.memoryPages = sim->systemc->memory->memory_blocks.materialized_pages();
+            sim->cacheStats.writebacks_L1 = sim->systemc->l1->writebacks;
+            sim->cacheStats.writebacks_L2 = sim->systemc->l2->writebacks;
+            sim->cacheStats.combinedWrites = sim->systemc->combined_writes();
+            sim->cacheStats.flushStalls = sim->systemc->l2->flush_stalls;
+            sim->cacheStats.abortedWrites = sim->systemc->memory->aborted_writes;
+            sim->cacheStats.abortedCycles = sim->systemc->memory->aborted_cycles;
+            sim->cacheStats.forwardedLoads = sim->systemc->l2->forwarded_loads;
+            sim->cacheStats.bufferLoads = sim->systemc->l2->buffer_loads;
+            sim->cacheStats.prefetches = sim->systemc->l2->prefetches;
+            sim->cacheStats.latePrefetches = sim->systemc->l2->late_prefetches;
+            sim->cacheStats.cancelledPrefetches = (sim->systemc->prefetch != nullptr) ? sim->systemc->prefetch->cancelled : 0;
+            sim->cacheStats.usefulPrefetches = sim->systemc->l2->useful_prefetches;
+        }
+        return sim->cacheStats;
+    }
+
+    int cachesim_reset(Cachesim* sim) {
+        if (sim->functional != nullptr) {
+            sim->functional->reset();
+        }
+        else {
+            sim->systemc->reset();
+        }
+        start_run(sim);
+        return 0;
+    }
+
+    void cachesim_destroy(Cachesim* sim) {
+        if (sim == NULL) return;
+        if (sim->functional != nullptr) {
+            delete sim->functional;
+        }
+        else {
+            // kept for the next SystemC handle
+            sim->systemc->reset();
+            systemcInUse = false;
+        }
+        delete sim;
+    }
+}
+
+/**
+ * @brief Programs that link libcachesim have their own main(), SystemC still needs an sc_main to link
+ */
+__attribute__((weak)) int sc_main(int argc, char* argv[]) {
+    return 1;
+}
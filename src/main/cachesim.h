@@ -0,0 +1,72 @@
+#ifndef CACHESIM_H
+#define CACHESIM_H
+
+#include <stddef.h>
+
+#include "simulator.hpp"
+#include "parser/parse.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A simulator of one configuration that can run many times (libcachesim)
+ *
+ * @details
+ * The simulator does the same as ./cache, without a global config, parsing or printing:
+ * 1. cachesim_create() builds the memory hierarchy of a Config once
+ * 2. cachesim_submit() sends requests, in as many batches as needed, the state is kept from one batch to the next
+ * 3. cachesim_stats() finishes the run (waits for the memory) and returns the same CacheStats as ./cache
+ * 4. cachesim_reset() empties the caches and the memory for the next run, nothing is built again
+ *
+ * The functional engine builds a simulator per handle. SystemC elaborates only once per process, so the
+ * SystemC engine has a single memory hierarchy: one SystemC handle at a time, and every later one must
+ * have the same geometry (the cycle limit may differ).
+ *
+ * @note Usage: `make library`, then link with `-Lpath -lcachesim` (see src/assets/library/library_test.c)
+ */
+typedef struct Cachesim Cachesim;
+
+/**
+ * @brief The defaults of ./cache (same as `./cache filename.csv`)
+ */
+Config cachesim_default_config(void);
+
+/**
+ * @brief Builds the simulator of a configuration
+ *
+ * @param config The options of ./cache (the requests, the file names and the parser options are not used).
+ * @return NULL if the configuration is invalid or not supported (the reason is printed to stderr)
+ * @note The stack-distance engine and trace files are not supported
+ */
+Cachesim* cachesim_create(const Config* config);
+
+/**
+ * @brief Simulates requests (stops earlier at `.we == -1`), the cycle limit counts over all batches
+ * @return 0 if every request has been simulated, -1 if the run has ended (cycle limit or cachesim_stats())
+ */
+int cachesim_submit(Cachesim* sim, const struct Request* requests, size_t numRequests);
+
+/**
+ * @brief Finishes the run and returns its CacheStats (cycles = SIZE_MAX if the cycle limit has been exceeded)
+ * @note The run ends here: further requests need cachesim_reset() first
+ */
+CacheStats cachesim_stats(Cachesim* sim);
+
+/**
+ * @brief Starts a new run with empty caches, empty memory and the full cycle limit
+ * @return 0 on success
+ */
+int cachesim_reset(Cachesim* sim);
+
+/**
+ * @brief Frees the simulator (the SystemC memory hierarchy is kept for the next handle)
+ */
+void cachesim_destroy(Cachesim* sim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CACHESIM_H
@@ -2,12 +2,143 @@
 
 #include "printer.h"
 
+/**
+ * @brief Name of the replacement policy of a cache ("-" if it is direct-mapped)
+ */
+static const char* replacement_name(unsigned int ways, Replacement replacement) {
+    if (ways <= 1) return "-";
+    switch (replacement) {
+        case REPLACEMENT_PLRU: return "Tree PLRU";
+        case REPLACEMENT_FIFO: return "FIFO";
+        case REPLACEMENT_RANDOM: return "Random";
+        default: return "LRU";
+    }
+}
+
+/**
+ * @brief Name of the prefetcher of the prefetch buffer
+ */
+static const char* prefetcher_name(Prefetcher prefetcher) {
+    switch (prefetcher) {
+        case PREFETCHER_STRIDE: return "Stride";
+        case PREFETCHER_STREAM: return "Stream";
+        default: return "Next-Line";
+    }
+}
+
+/**
+ * @brief Name of the write policy of the caches
+ */
+static const char* write_policy_name(WritePolicy writePolicy) {
+    return (writePolicy == WRITE_BACK) ? "Write-Back" : "Write-Through";
+}
+
+/**
+ * @brief Prints the layout of the stack-distance engine: only L1 is simulated (write-allocate, untimed),
+ * so there is no L2, nothing is written back and nothing goes to RAM
+ */
+static void print_l1_layout(Config* config, CacheStats* cacheStats) {
+    char lines[32], ways[32], replacement[32], policy[32], read_hits[32], read_misses[32], write_hits[32], write_misses[32];
+    snprintf(lines, sizeof(lines), "Lines: %u", config->l1CacheLines);
+    snprintf(ways, sizeof(ways), "Ways: %u", config->l1Ways);
+    snprintf(replacement, sizeof(replacement), "Replacement: %s", replacement_name(config->l1Ways, config->replacement));
+    snprintf(policy, sizeof(policy), "Policy: %s", write_policy_name(config->writePolicy));
+    snprintf(read_hits, sizeof(read_hits), "Read Hits: %zu", cacheStats->read_hits_L1);
+    snprintf(read_misses, sizeof(read_misses), "Read Misses: %zu", cacheStats->read_misses_L1);
+    snprintf(write_hits, sizeof(write_hits), "Write Hits: %zu", cacheStats->write_hits_L1);
+    snprintf(write_misses, sizeof(write_misses), "Write Misses: %zu", cacheStats->write_misses_L1);
+
+    printf(
+        "Team 150 - Cache Simulator\n"
+        "An Overview of our simulation:\n\n"
+        "┌────────────────────────────────────────────────────────────────┐\n"
+        "|                            Processor                           |\n"
+        "| ┌────────────────────────────────────────────────────────────┐ |\n"
+        "| | Cache Line Size: %-41d | |\n"
+        "| └────────────────────────────────────────────────────────────┘ |\n"
+        "| ┌────────────────────────────────────────────────────────────┐ |\n"
+        "| |                          L1 Cache                          | |\n"
+        "| | %-26s | %-29s | |\n"
+        "| | %-26s | %-29s | |\n"
+        "| | %-26s | %-29s | |\n"
+        "| | %-26s | %-29s | |\n"
+        "| └────────────────────────────────────────────────────────────┘ |\n"
+        "| Number of Requests Processed: %-32zu |\n"
+        "└────────────────────────────────────────────────────────────────┘\n\n",
+        config->cacheLineSize,
+        lines, ways, replacement, policy, read_hits, read_misses, write_hits, write_misses,
+        config->numRequests
+    );
+}
+
 /**
  * @brief Prints the result and layout of the simulator (if `pretty_print` flag is `true`)
  * @author Lie Leon Alexius
  */
 void print_layout(Config* config, CacheStats* cacheStats) {
-    if (config->prettyPrint) {
+    if (config->prettyPrint && config->engine == ENGINE_STACK_DISTANCE) {
+        print_l1_layout(config, cacheStats);
+    }
+    else if (config->prettyPrint) {
+        // Write-through: every write goes to memory, only read misses of L2 read from it.
+        // Write-back: only dirty lines go to memory, write misses of L2 fetch their line (write-allocate).
+        size_t memory_reads = cacheStats->read_misses_L2;
+        size_t memory_writes = cacheStats->write_hits + cacheStats->write_misses;
+        if (config->writePolicy == WRITE_BACK) {
+            memory_reads += cacheStats->write_misses_L2;
+            memory_writes = cacheStats->writebacks_L2;
+        }
+
+        // A combining storeback buffer writes the merged writes to memory together with their line
+        memory_writes -= cacheStats->combinedWrites;
+        char combined[32] = "";
+        if (config->storebackCombine && config->storebackBuffer != 0) {
+            snprintf(combined, sizeof(combined), "Combined Writes: %zu", cacheStats->combinedWrites);
+        }
+
+        // What read misses waited for the storeback buffer to be flushed, and the writes that they aborted
+        // (only with a storeback buffer)
+        char flush[192] = "";
+        if (config->storebackBuffer != 0) {
+            char stalls[32], aborted[32], lost[32];
+            snprintf(stalls, sizeof(stalls), "Flush Stalls: %zu", cacheStats->flushStalls);
+            snprintf(aborted, sizeof(aborted), "Aborted Writes: %zu", cacheStats->abortedWrites);
+            snprintf(lost, sizeof(lost), "Aborted Cycles: %zu", cacheStats->abortedCycles);
+            snprintf(flush, sizeof(flush), "| | Flush: %-21s | %-27s | |\n| | %-28s | %-27s | |\n",
+                (config->storebackFlush == STOREBACK_FLUSH_LINE) ? "line" : "all", stalls, aborted, lost);
+        }
+
+        // Read misses that took bytes of their line from the storeback buffer (--storeback-forward)
+        char forward[128] = "";
+        if (config->storebackForward && config->storebackBuffer != 0) {
+            char forwarded[32], buffered[32];
+            snprintf(forwarded, sizeof(forwarded), "Forwarded Loads: %zu", cacheStats->forwardedLoads);
+            snprintf(buffered, sizeof(buffered), "Buffer Loads: %zu", cacheStats->bufferLoads);
+            snprintf(forward, sizeof(forward), "| | %-28s | %-27s | |\n", forwarded, buffered);
+        }
+
+        // Which lines were prefetched and how many of them a read of L2 hit (only with a prefetch buffer).
+        // Accuracy: useful prefetches per prefetch, coverage: read misses of L2 that a prefetch avoided.
+        // Late: read misses that waited for their line on its way, cancelled: prefetches of lines written on their way
+        char prefetch[384] = "";
+        if (config->prefetchBuffer != 0) {
+            char kind[32], lines[48], prefetches[32], useful[32], late[32], cancelled[40], accuracy[32], coverage[32];
+            size_t avoidable = cacheStats->usefulPrefetches + cacheStats->read_misses_L2;
+            snprintf(kind, sizeof(kind), "Prefetcher: %s", prefetcher_name(config->prefetcher));
+            snprintf(lines, sizeof(lines), "Degree: %u, Distance: %u", config->prefetchDegree, config->prefetchDistance);
+            snprintf(prefetches, sizeof(prefetches), "Prefetches: %zu", cacheStats->prefetches);
+            snprintf(useful, sizeof(useful), "Useful Prefetches: %zu", cacheStats->usefulPrefetches);
+            snprintf(late, sizeof(late), "Late Prefetches: %zu", cacheStats->latePrefetches);
+            snprintf(cancelled, sizeof(cancelled), "Cancelled Prefetches: %zu", cacheStats->cancelledPrefetches);
+            snprintf(accuracy, sizeof(accuracy), "Accuracy: %.1f%%",
+                (cacheStats->prefetches != 0) ? 100.0 * cacheStats->usefulPrefetches / cacheStats->prefetches : 0.0);
+            snprintf(coverage, sizeof(coverage), "Coverage: %.1f%%",
+                (avoidable != 0) ? 100.0 * cacheStats->usefulPrefetches / avoidable : 0.0);
+            snprintf(prefetch, sizeof(prefetch),
+                "| | %-28s | %-27s | |\n| | %-28s | %-27s | |\n| | %-28s | %-27s | |\n| | %-28s | %-27s | |\n",
+                kind, lines, prefetches, useful, late, cancelled, accuracy, coverage);
+        }
+
         printf(
             "Team 150 - Cache Simulator\n"
             "An Overview of our simulation:\n\n"
@@ -20,12 +151,16 @@ void print_layout(Config* config, CacheStats* cacheStats) {
             "| ┌────────────────────────────────────────────────────────────┐ |\n"
             "| |                          L1 Cache                          | |\n"
             "| | Lines: %-8d            | Latency: %-7d              | |\n"
+            "| | Ways: %-8u             | Replacement: %-16s | |\n"
+            "| | Policy: %-18s | Writebacks: %-17zu | |\n"
             "| | Read Hits: %-8zu        | Read Misses: %-7zu          | |\n"
             "| | Write Hits: %-8zu       | Write Misses: %-7zu         | |\n"
             "| └────────────────────────────────────────────────────────────┘ |\n"
             "| ┌────────────────────────────────────────────────────────────┐ |\n"
             "| |                          L2 Cache                          | |\n"
             "| | Lines: %-8d            | Latency: %-7d              | |\n"
+            "| | Ways: %-8u             | Replacement: %-16s | |\n"
+            "| | Policy: %-18s | Writebacks: %-17zu | |\n"
             "| | Read Hits: %-8zu        | Read Misses: %-7zu          | |\n"
             "| | Write Hits: %-8zu       | Write Misses: %-7zu         | |\n"
             "| └────────────────────────────────────────────────────────────┘ |\n"
@@ -35,8 +170,9 @@ void print_layout(Config* config, CacheStats* cacheStats) {
             "┌────────────────────────────────────────────────────────────────┐\n"
             "|                           Buffers                              |\n"
             "| ┌────────────────────────────────────────────────────────────┐ |\n"
-            "| | Prefetch Buffer: %-10d  |                             | |\n"
+            "| | Prefetch Buffer: %-10d  | %-27s | |\n"
             "| | Storeback Buffer: %-10d | Conditional: %-14d | |\n"
+            "%s%s%s"
             "| └────────────────────────────────────────────────────────────┘ |\n"
             "└────────────────────────────────┬───────────────────────────────┘\n"
             "                                 ↓                                \n"
@@ -46,21 +182,28 @@ void print_layout(Config* config, CacheStats* cacheStats) {
             "| Number of RAM Requests: %-38zu |\n"
             "| Number of Read Requests: %-37zu |\n"
             "| Number of Write Requests: %-36zu |\n"
+            "| Memory Pages Allocated (4 KiB): %-30zu |\n"
             "└────────────────────────────────────────────────────────────────┘\n\n",
             config->cycles, 
             config->cacheLineSize,
             config->l1CacheLines, config->l1CacheLatency, 
+            config->l1Ways, replacement_name(config->l1Ways, config->replacement),
+            write_policy_name(config->writePolicy), cacheStats->writebacks_L1,
             cacheStats->read_hits_L1, cacheStats->read_misses_L1,
             cacheStats->write_hits_L1, cacheStats->write_misses_L1,
             config->l2CacheLines, config->l2CacheLatency, 
+            config->l2Ways, replacement_name(config->l2Ways, config->replacement),
+            write_policy_name(config->writePolicy), cacheStats->writebacks_L2,
             cacheStats->read_hits_L2, cacheStats->read_misses_L2,
             cacheStats->write_hits_L2, cacheStats->write_misses_L2,
             config->numRequests,
-            config->prefetchBuffer, config->storebackBuffer, config->storebackBufferCondition,
+            config->prefetchBuffer, combined, config->storebackBuffer, config->storebackBufferCondition,
+            flush, forward, prefetch,
             config->memoryLatency, 
-            (cacheStats->read_misses_L2 + cacheStats->write_hits + cacheStats->write_misses),
-            cacheStats->read_misses_L2, 
-            (cacheStats->write_hits + cacheStats->write_misses)
+            (memory_reads + memory_writes),
+            memory_reads, 
+            memory_writes,
+            cacheStats->memoryPages
         );
     }
 
@@ -69,3 +212,53 @@ void print_layout(Config* config, CacheStats* cacheStats) {
     printf("Number of Cache Misses: %zu \n", cacheStats->misses);
     printf("Number of Gates: %zu  \n", cacheStats->primitiveGateCount);
 }
+
+/**
+ * @brief Prints the miss-ratio curves of the stack-distance engine, one line per line size and cache size
+ * @details The columns are comma separated, so that the curves can be plotted directly (e.g. `grep '^MRC,'`)
+ */
+void print_miss_ratio_curves(Config* config, const MissRatioPoint* points, size_t numPoints) {
+    printf("Miss-Ratio Curves (LRU, write-allocate, set-associative: %u ways):\n", config->l1Ways);
+    printf("MRC, Line Size, Cache Lines, Accesses, Misses (Fully-Associative), Misses (Set-Associative)\n");
+
+    for (size_t i = 0; i < numPoints; i++) {
+        printf("MRC, %u, %u, %zu, %zu, ", points[i].lineSize, points[i].cacheLines, points[i].accesses, points[i].misses);
+        if (points[i].missesSetAssociative == SIZE_MAX) {
+            printf("-\n");
+        }
+        else {
+            printf("%zu\n", points[i].missesSetAssociative);
+        }
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Prints the results of a sweep (cache-sweep), one line per configuration
+ * @details The columns are comma separated like the miss-ratio curves (e.g. `grep '^SWEEP,'`).
+ * Configurations that were not simulated have `-` as results and the error of ./cache in the last column.
+ */
+void print_sweep_table(Config* config, unsigned jobs, const SweepParameter* parameters, const SweepResult* results, size_t numResults) {
+    printf("Sweep of %zu configurations (%s, %zu requests, %u workers):\n", numResults, config->input_filename,
+        config->numRequests, jobs);
+    printf("SWEEP");
+    for (size_t p = 0; p < SWEEP_PARAMETERS; p++) {
+        printf(", %s", parameters[p].title);
+    }
+    printf(", Cycles, Hits, Misses, Gates, Error\n");
+
+    for (size_t i = 0; i < numResults; i++) {
+        printf("SWEEP");
+        for (size_t p = 0; p < SWEEP_PARAMETERS; p++) {
+            printf(", %s", results[i].values[p]);
+        }
+        if (results[i].simulated) {
+            printf(", %zu, %zu, %zu, %zu, -\n", results[i].result.cycles, results[i].result.hits, results[i].result.misses,
+                results[i].result.primitiveGateCount);
+        }
+        else {
+            printf(", -, -, -, -, %s\n", results[i].error);
+        }
+    }
+    printf("\n");
+}
@@ -5,7 +5,10 @@
 
 #include "../simulator.hpp"
 #include "../parser/parse.h"
+#include "../sweep.h"
 
 void print_layout(Config* config, CacheStats* cacheStats);
+void print_miss_ratio_curves(Config* config, const MissRatioPoint* points, size_t numPoints);
+void print_sweep_table(Config* config, unsigned jobs, const SweepParameter* parameters, const SweepResult* results, size_t numResults);
 
 #endif // PRINTER_H
@@ -0,0 +1,221 @@
+// mmap() and friends are POSIX, not C17
+#define _POSIX_C_SOURCE 200809L
+
+#include "binary_trace.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Appends an unsigned LEB128 varint (7 bits per byte, low bits first)
+ */
+static void write_varint(FILE* file, uint32_t value) {
+    while (value >= 0x80) {
+        fputc((int) ((value & 0x7F) | 0x80), file);
+        value >>= 7;
+    }
+    fputc((int) value, file);
+}
+
+/**
+ * @brief Reads a varint from [*pos, end)
+ * @return 0 if successful, -1 if the varint is cut off or too long
+ */
+static int read_varint(const unsigned char** pos, const unsigned char* end, uint32_t* value) {
+    uint32_t result = 0;
+    for (unsigned shift = 0; shift < 35; shift += 7) {
+        if (*pos >= end) return -1;
+        unsigned char byte = *(*pos)++;
+        result |= (uint32_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Writes the requests as a binary trace (see BinaryTraceHeader)
+ *
+ * @param output_filename The binary trace to create (overwritten if it exists).
+ * @param requests The requests to write.
+ * @param numRequests The number of requests (stops earlier at `.we == -1`).
+ * @param format The record format.
+ *
+ * @return int (0 if successful, -1 if failed)
+ */
+int write_binary_trace(const char* output_filename, const struct Request* requests, size_t numRequests, TraceFormat format) {
+    FILE* file = fopen(output_filename, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to open output file: %s\n", output_filename);
+        return -1;
+    }
+
+    size_t count = 0;
+    while (count < numRequests && requests[count].we != -1) {
+        count++;
+    }
+
+    BinaryTraceHeader header;
+    memcpy(header.magic, BINARY_TRACE_MAGIC, sizeof(header.magic));
+    header.version = BINARY_TRACE_VERSION;
+    header.count = count;
+    header.format = format;
+    header.recordSize = (format == TRACE_FORMAT_RAW) ? sizeof(struct Request) : 0;
+    fwrite(&header, sizeof(header), 1, file);
+
+    if (format == TRACE_FORMAT_RAW) {
+        fwrite(requests, sizeof(struct Request), count, file);
+    }
+    else {
+        uint32_t previous = 0;
+        for (size_t i = 0; i < count; i++) {
+            // zigzag: small steps in both directions become small numbers
+            int32_t delta = (int32_t) (requests[i].addr - previous);
+            uint32_t zigzag = ((uint32_t) delta << 1) ^ (uint32_t) (delta >> 31);
+            previous = requests[i].addr;
+
+            fputc(requests[i].we ? 1 : 0, file);
+            write_varint(file, zigzag);
+            if (requests[i].we) {
+                write_varint(file, requests[i].data);
+            }
+        }
+    }
+
+    // fclose() flushes, so it also reports a full disk
+    if (ferror(file) | fclose(file)) {
+        fprintf(stderr, "Failed to write output file: %s\n", output_filename);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Decodes the delta-encoded records into a new array (with the `.we = -1` marker)
+ * @return the requests, NULL if the records are corrupted or the allocation failed
+ */
+static struct Request* decode_delta_records(const unsigned char* pos, const unsigned char* end, size_t count) {
+    struct Request* requests = malloc((count + 1) * sizeof(struct Request));
+    if (requests == NULL) {
+        fprintf(stderr, "Error when allocating Request Struct in Config\n");
+        return NULL;
+    }
+
+    uint32_t previous = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t zigzag;
+        unsigned char op = (pos < end) ? *pos++ : 0xFF;
+        if (op > 1 || read_varint(&pos, end, &zigzag) == -1) {
+            fprintf(stderr, "Error in parsing the binary trace - corrupted record %zu\n", i);
+            free(requests);
+            return NULL;
+        }
+
+        requests[i].we = op;
+        requests[i].addr = previous + ((zigzag >> 1) ^ (0u - (zigzag & 1)));
+        requests[i].data = 0; // Default value for Read
+        previous = requests[i].addr;
+
+        if (requests[i].we && read_varint(&pos, end, &requests[i].data) == -1) {
+            fprintf(stderr, "Error in parsing the binary trace - corrupted record %zu\n", i);
+            free(requests);
+            return NULL;
+        }
+    }
+    requests[count].we = -1;
+
+    return requests;
+}
+
+/**
+ * @brief Loads the binary trace `config->input_filename` into `config->requests`
+ *
+ * @details
+ * The file is mapped with mmap(). Raw records are used in place: `config->requests` points into the
+ * mapping, nothing is copied and pages are only read when the simulator gets to them.
+ * Delta-encoded records are decoded into an allocated array, and the mapping is released.
+ *
+ * With `--num-requests`, the first numRequests requests are used (the trace must have enough of them).
+ * Release the requests with free_requests().
+ *
+ * @note The mapped requests have no `.we = -1` marker, the simulator stops at numRequests
+ * @return int (0 if successful, -1 if failed)
+ */
+int load_binary_trace(Config* config) {
+    int fd = open(config->input_filename, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "Failed to open input file\n");
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t) st.st_size < sizeof(BinaryTraceHeader)) {
+        fprintf(stderr, "Error in parsing the binary trace - header is missing\n");
+        close(fd);
+        return -1;
+    }
+
+    size_t size = (size_t) st.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping stays valid
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "Failed to map input file\n");
+        return -1;
+    }
+
+    BinaryTraceHeader header;
+    memcpy(&header, mapping, sizeof(header));
+    const unsigned char* records = (const unsigned char*) mapping + sizeof(header);
+    size_t recordBytes = size - sizeof(header);
+
+    bool valid = memcmp(header.magic, BINARY_TRACE_MAGIC, sizeof(header.magic)) == 0 && header.version == BINARY_TRACE_VERSION;
+    if (valid && header.format == TRACE_FORMAT_RAW) {
+        valid = header.recordSize == sizeof(struct Request) && recordBytes / sizeof(struct Request) == header.count
+            && recordBytes % sizeof(struct Request) == 0;
+    }
+    else if (valid) {
+        valid = header.format == TRACE_FORMAT_DELTA && header.count <= recordBytes;
+    }
+
+    if (!valid) {
+        fprintf(stderr, "Error in parsing the binary trace - invalid header\n");
+        munmap(mapping, size);
+        return -1;
+    }
+
+    // check if numRequests can be fulfilled
+    if (config->customNumRequest && config->numRequests > header.count) {
+        fprintf(stderr, "Error: number of requests parsed does not match numRequests\n");
+        munmap(mapping, size);
+        return -1;
+    }
+    if (!config->customNumRequest) {
+        config->numRequests = header.count;
+    }
+
+    if (header.format == TRACE_FORMAT_RAW) {
+        // zero-copy: the requests are the records, the simulator only reads them
+        posix_madvise(mapping, size, POSIX_MADV_SEQUENTIAL);
+        config->requests = (struct Request*) records;
+        config->requestsMapping = mapping;
+        config->requestsMappingSize = size;
+        return 0;
+    }
+
+    config->requests = decode_delta_records(records, records + recordBytes, config->numRequests);
+    munmap(mapping, size);
+    return (config->requests == NULL) ? -1 : 0;
+}
+
+/**
+ * @brief Releases the mapping of load_binary_trace()
+ */
+void unload_binary_trace(Config* config) {
+    munmap(config->requestsMapping, config->requestsMappingSize);
+    config->requestsMapping = NULL;
+    config->requestsMappingSize = 0;
+}
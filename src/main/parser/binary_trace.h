@@ -0,0 +1,33 @@
+#ifndef BINARY_TRACE_H
+#define BINARY_TRACE_H
+
+#include "parse.h"
+
+/**
+ * @brief Header of a binary trace (`.trace` file)
+ *
+ * @details
+ * The header is followed by `count` records:
+ *  1. TRACE_FORMAT_RAW: `struct Request` as it is in memory (native byte order), so that the
+ *     file can be mapped and used as the requests without copying (see load_binary_trace()).
+ *  2. TRACE_FORMAT_DELTA: per request one op byte (0 = R, 1 = W), the difference to the previous
+ *     address as a zigzag varint, and for writes the data as a varint. Usually 2-3 bytes per request.
+ *
+ * @note The header is 24 bytes, so the raw records stay aligned to 4 bytes in the mapping
+ */
+typedef struct {
+    char magic[4];          // "CTRC"
+    uint32_t version;       // BINARY_TRACE_VERSION
+    uint64_t count;         // number of requests
+    uint32_t format;        // TraceFormat of the records
+    uint32_t recordSize;    // sizeof(struct Request) of the writer (raw records only)
+} BinaryTraceHeader;
+
+#define BINARY_TRACE_MAGIC "CTRC"
+#define BINARY_TRACE_VERSION 1
+
+int write_binary_trace(const char* output_filename, const struct Request* requests, size_t numRequests, TraceFormat format);
+int load_binary_trace(Config* config);
+void unload_binary_trace(Config* config);
+
+#endif // BINARY_TRACE_H
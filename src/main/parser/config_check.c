@@ -0,0 +1,85 @@
+#include "config_check.h"
+
+/**
+ * @brief Invalid cases check of a configuration, shared by parse_user_input() and libcachesim
+ *
+ * @details
+ * 1. If L1 cache size is greater than L2 cache size
+ * 2. If L1 latency is greater than L2 latency or L2 latency is greater than memory latency
+ * 3. if any of the cacheLines is set to 0 or cacheLineSize is less than 1 byte
+ * 4. Cycles to simulate is less than 0
+ * 5. Functional or stack-distance engine combined with options that only exist in SystemC
+ * 6. Timing-only simulation combined with a trace file (the data signals would be all zero)
+ * 7. The ways of a cache are 0 or do not divide its cache lines into sets
+ * 8. Tree pseudo-LRU with a number of ways that is not a power of two
+ * 9. Stack-distance engine with a replacement policy other than LRU
+ * 10. A prefetch degree greater than the prefetch buffer
+ *
+ * @note `prefetchDegree` is the resolved degree, 0 is only allowed without a prefetch buffer
+ * @return false if the configuration is invalid, the reason is printed to stderr
+ */
+bool check_config(const Config* config) {
+    if (config->l1CacheLines > config->l2CacheLines) {
+        fprintf(stderr, "Invalid input: L1 cache lines count is greater than L2 cache lines count\n");
+        return false;
+    }
+
+    if (config->l1CacheLatency > config->l2CacheLatency || config->l2CacheLatency > config->memoryLatency) {
+        fprintf(stderr, "Invalid input: L1 latency is greater than L2 latency or L2 latency is greater than memory latency\n");
+        return false;
+    }
+
+    if (config->l1CacheLines == 0 || config->l2CacheLines == 0 || config->cacheLineSize == 0) {
+        fprintf(stderr, "Invalid input: L1 cache lines, L2 cache lines or cache line size is set to 0\n");
+        return false;
+    }
+
+    if (config->cycles < 0) {
+        fprintf(stderr, "Invalid input: Cycles to simulate is less than 0\n");
+        return false;
+    }
+
+    // The functional and stack-distance engines have no signals and no buffers
+    bool systemc_only = config->prefetchBuffer != 0 || config->storebackBuffer != 0 || config->tracefile != NULL;
+    if (config->engine == ENGINE_STACK_DISTANCE && systemc_only) {
+        fprintf(stderr, "Invalid input: The stack-distance engine does not support buffers or trace files\n");
+        return false;
+    }
+
+    if (config->engine == ENGINE_FUNCTIONAL && systemc_only) {
+        fprintf(stderr, "Invalid input: The functional engine does not support buffers or trace files\n");
+        return false;
+    }
+
+    // Without data there is nothing to record on the data buses
+    if (config->timingOnly && config->tracefile != NULL) {
+        fprintf(stderr, "Invalid input: timing-only does not support trace files\n");
+        return false;
+    }
+
+    if (config->l1Ways == 0 || config->l2Ways == 0
+        || config->l1CacheLines % config->l1Ways != 0 || config->l2CacheLines % config->l2Ways != 0) {
+        fprintf(stderr, "Invalid input: The number of ways must divide the number of cache lines\n");
+        return false;
+    }
+
+    if (config->replacement == REPLACEMENT_PLRU
+        && ((config->l1Ways & (config->l1Ways - 1)) != 0 || (config->l2Ways & (config->l2Ways - 1)) != 0)) {
+        fprintf(stderr, "Invalid input: PLRU replacement needs a power of two number of ways\n");
+        return false;
+    }
+
+    // Only LRU has the inclusion property (a smaller cache is always a subset of a larger one)
+    if (config->engine == ENGINE_STACK_DISTANCE && config->replacement != REPLACEMENT_LRU) {
+        fprintf(stderr, "Invalid input: The stack-distance engine only supports LRU replacement\n");
+        return false;
+    }
+
+    // The prefetched lines of a read miss have to fit into the prefetch buffer
+    if (config->prefetchDegree > config->prefetchBuffer) {
+        fprintf(stderr, "Invalid input: The prefetch degree is greater than the prefetch buffer\n");
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,8 @@
+#ifndef CONFIG_CHECK_H
+#define CONFIG_CHECK_H
+
+#include "parse.h"
+
+bool check_config(const Config* config);
+
+#endif // CONFIG_CHECK_H
@@ -1,21 +1,379 @@
 // Lie Leon Alexius
 
+// threads, sched_yield() and nanosleep() are POSIX, not C17
+#define _POSIX_C_SOURCE 200809L
+
 #include "csv_parser.h"
 
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+
+// SIMD delimiter search (see find_delimiter()), `make release SIMD=avx2` or `make release SIMD=none`
+#if !defined(CSV_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#elif !defined(CSV_NO_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+    Rows are read with one fread() per CSV_READ_BUFFER_SIZE bytes instead of one fgets() per row.
+    The buffer has CSV_READ_PADDING more bytes, so that a SIMD block starting before the end of
+    the data can always be loaded (the bytes after the end are ignored).
+*/
+#define CSV_READ_BUFFER_SIZE (1 << 18)
+#define CSV_READ_PADDING 32
+
 /**
- * @brief removes whitespaces from a string
- * @note `"Le o n"` would be `"Leon"` and `" "` would be `""`
- * @author Lie Leon Alexius
+ * @brief First `c` or '\0' in [pos, end), end if there is none
+ *
+ * @details
+ * Compares 32 (AVX2) or 16 (SSE2) bytes at once, the first match is the lowest bit of the mask.
+ * The last block may reach past end (see CSV_READ_PADDING), matches there are ignored.
+ * Without SSE2 (or with CSV_NO_SIMD) the bytes are compared one by one.
+ */
+static const char* find_delimiter(const char* pos, const char* end, char c) {
+#if !defined(CSV_NO_SIMD) && defined(__AVX2__)
+    const __m256i needle = _mm256_set1_epi8(c);
+    const __m256i zero = _mm256_setzero_si256();
+    for (; pos < end; pos += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*) pos);
+        __m256i match = _mm256_or_si256(_mm256_cmpeq_epi8(block, needle), _mm256_cmpeq_epi8(block, zero));
+        unsigned mask = (unsigned) _mm256_movemask_epi8(match);
+        if (mask != 0) {
+            pos += __builtin_ctz(mask);
+            break;
+        }
+    }
+#elif !defined(CSV_NO_SIMD) && defined(__SSE2__)
+    const __m128i needle = _mm_set1_epi8(c);
+    const __m128i zero = _mm_setzero_si128();
+    for (; pos < end; pos += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*) pos);
+        __m128i match = _mm_or_si128(_mm_cmpeq_epi8(block, needle), _mm_cmpeq_epi8(block, zero));
+        unsigned mask = (unsigned) _mm_movemask_epi8(match);
+        if (mask != 0) {
+            pos += __builtin_ctz(mask);
+            break;
+        }
+    }
+#else
+    while (pos < end && *pos != c && *pos != '\0') {
+        pos++;
+    }
+#endif
+    return (pos < end) ? pos : end;
+}
+
+/**
+ * @brief isspace() of the "C" locale (what sscanf() skips)
+ */
+static inline bool is_space(char c) {
+    return c == ' ' || (unsigned char) (c - '\t') < 5; // \t \n \v \f \r
+}
+
+/**
+ * @brief Value of a hexadecimal digit, 16 if c is not one
+ */
+static inline unsigned hex_value(char c) {
+    unsigned digit = (unsigned char) c - '0';
+    unsigned letter = ((unsigned char) c | 0x20) - 'a'; // 'A' -> 'a'
+    return (digit < 10) ? digit : (letter < 6) ? letter + 10 : 16;
+}
+
+/**
+ * @brief Parses an address or data field, with the results of the old sscanf("%x") / sscanf("%u")
+ *
+ * @details
+ * The field is hexadecimal if its second character is x or X (e.g. 0x123 or 0X123), decimal otherwise.
+ * Same as sscanf() on the field without spaces (they have been removed before):
+ *  1. Leading whitespace and a + or - sign are allowed, a negative number wraps around.
+ *  2. The 0x prefix alone is the number 0.
+ *  3. A number that does not fit into an unsigned long is ULONG_MAX (strtoul()).
+ *  4. If there is no number, the value is not changed.
+ *
+ * @param pos The field.
+ * @param end The end of the field.
+ * @param value The address or data to set.
  */
-void remove_whitespaces(char* input) {
-    int n = strlen(input);
-    int j = 0;
-    for (int i = 0; i < n; i++) {
-        if (input[i] != ' ') {
-            input[j++] = input[i];
+static void parse_number(const char* pos, const char* end, __uint32_t* value) {
+    // spaces are ignored everywhere in a field ("0x 1 0" is 0x10), usually there are only some around it
+    while (pos < end && *pos == ' ') {
+        pos++;
+    }
+    while (end > pos && end[-1] == ' ') {
+        end--;
+    }
+
+    char compact[CSV_MAX_ROW];
+    if (memchr(pos, ' ', end - pos) != NULL) {
+        size_t length = 0;
+        for (; pos < end; pos++) {
+            if (*pos != ' ') compact[length++] = *pos;
+        }
+        pos = compact;
+        end = compact + length;
+    }
+
+    bool hex = end - pos >= 2 && (pos[1] == 'x' || pos[1] == 'X');
+
+    while (pos < end && is_space(*pos)) {
+        pos++;
+    }
+    bool negative = pos < end && *pos == '-';
+    if (pos < end && (*pos == '+' || *pos == '-')) {
+        pos++;
+    }
+
+    unsigned long number = 0;
+    bool overflow = false;
+    bool found = false;
+    const char* digits;
+    unsigned digit;
+
+    if (hex) {
+        found = end - pos >= 2 && pos[0] == '0' && (pos[1] == 'x' || pos[1] == 'X');
+        if (found) pos += 2;
+
+        digits = pos;
+        for (; pos < end && (digit = hex_value(*pos)) < 16; pos++) {
+            overflow |= number > (ULONG_MAX >> 4);
+            number = (number << 4) | digit;
+        }
+    }
+    else {
+        digits = pos;
+        for (; pos < end && (digit = (unsigned char) *pos - '0') < 10; pos++) {
+            overflow |= __builtin_mul_overflow(number, 10, &number);
+            overflow |= __builtin_add_overflow(number, digit, &number);
+        }
+    }
+
+    if (!found && pos == digits) {
+        return;
+    }
+    *value = overflow ? (__uint32_t) ULONG_MAX : (__uint32_t) (negative ? 0 - number : number);
+}
+
+/**
+ * @brief Operation of the first field: 'R', 'W', '\0' if it is empty (or only spaces), '?' otherwise
+ */
+static char operation_of(const char* pos, const char* end) {
+    char op = '\0';
+    for (; pos < end; pos++) {
+        if (*pos == ' ') continue;
+        if (op != '\0') return '?';
+        op = *pos;
+    }
+    return (op == '\0' || op == 'R' || op == 'W') ? op : '?';
+}
+
+/**
+ * @brief Parses one row of a .csv file into a Request
+ *
+ * @details
+ * The fields are the ones of the old sscanf(line, "%[^,],%[^,],%s", rw, addr_str, data_str),
+ * but they are not copied: the commas are found with find_delimiter() and the fields are parsed in place.
+ *
+ * @param line The row, without the trailing newline.
+ * @param end The end of the row.
+ * @param request The Request to fill.
+ *
+ * @return int (1 if the row is a request, 0 if it is empty, -1 if it is invalid)
+ *
+ * @warning DO NOT REMOVE ANY OF THE COMMENTS!
+ */
+static int parse_row(const char* line, const char* end, struct Request* request) {
+    /*  Cases
+        1. "Hello,World,!" -> "Hello"; "World"; "!"
+        2. "He,llo,World,!" -> "He"; "llo"; "World,!" (PROBLEM)
+        3. "    " -> "    "; ""; "" (EDGE CASE)
+    */
+
+    // %[^,] matches any sequence of characters except for a comma (stop if see comma)
+    // Note: it matches at least one character, so a row starting with a comma has no fields and is ignored
+    const char* rw_end = find_delimiter(line, end, ',');
+    if (rw_end == line) {
+        return 0;
+    }
+
+    int fields = 1;
+    const char* addr = rw_end + 1;
+    const char* addr_end = addr;
+    const char* data = NULL;
+    const char* data_end = NULL;
+
+    // , is a delimiter marks that next field starts after a comma
+    if (rw_end < end && addr < end && *addr != ',') {
+        fields = 2;
+        addr_end = find_delimiter(addr, end, ',');
+
+        // %s skips whitespace, then matches up to the next whitespace (commas included)
+        if (addr_end < end) {
+            data = addr_end + 1;
+            while (data < end && is_space(*data)) {
+                data++;
+            }
+            data_end = data;
+            while (data_end < end && !is_space(*data_end)) {
+                data_end++;
+            }
+            if (data < end) {
+                fields = 3;
+            }
+        }
+    }
+
+    // Check if the third field has no other field
+    if (fields == 3 && memchr(data, ',', data_end - data) != NULL) {
+        fprintf(stderr, "Invalid third collumn: %.*s\n", (int) (data_end - data), data);
+        return -1;
+    }
+
+    // Whitespace(s) around the operation are ignored (" W " is "W")
+    char op = operation_of(line, rw_end);
+
+    // Min. valid field in a row = 2
+    // Note: This should be triggered only if the syntax of .csv is false
+    //       We ignore Empty lines (look at if-else if-else)
+    if (fields < 2 && op != '\0') {
+        fprintf(stderr, "Error in parsing the data - wrong format\n");
+        return -1;
+    }
+
+    // Case: Write
+    if (op == 'W') {
+        if (fields != 3) {
+            fprintf(stderr, "Error in parsing the data - wrong format for write request\n");
+            return -1;
+        }
+        request->we = 1;
+
+        // Parse address and data
+        parse_number(addr, addr_end, &request->addr);
+        parse_number(data, data_end, &request->data);
+
+        return 1;
+    }
+
+    // Case: Read
+    // Note: trailing whitespace in the data field for read requests is no third field (see %s)
+    else if (op == 'R') {
+        if (fields != 2) {
+            fprintf(stderr, "Error in parsing the data - wrong format for read request\n");
+            return -1;
+        }
+
+        request->we = 0;
+        request->data = 0; // Default value for Read
+
+        // Parse address
+        parse_number(addr, addr_end, &request->addr);
+
+        return 1;
+    }
+
+    // Case: Unknown Op
+    else {
+        // ignore empty line with whitespaces (See case-3)
+        if (op == '\0') {
+            return 0;
+        }
+        else {
+            fprintf(stderr, "Error in parsing the data - unrecognized command\n");
+            return -1;
+        }
+    }
+}
+
+/**
+ * @brief Opens a .csv file for csv_reader_next()
+ * @return int (0 if successful, -1 if failed)
+ */
+static int csv_reader_open(CsvReader* reader, const char* input_filename) {
+    reader->file = fopen(input_filename, "r");
+    if (!reader->file) {
+        // No need to close file here since fopen will return NULL
+        fprintf(stderr, "Failed to open input file\n");
+        return -1;
+    }
+
+    reader->buffer = malloc(CSV_READ_BUFFER_SIZE + CSV_READ_PADDING);
+    if (reader->buffer == NULL) {
+        fprintf(stderr, "Error when allocating the CSV read buffer\n");
+        fclose(reader->file);
+        return -1;
+    }
+    memset(reader->buffer + CSV_READ_BUFFER_SIZE, 0, CSV_READ_PADDING);
+
+    reader->pos = 0;
+    reader->end = 0;
+    reader->eof = false;
+    return 0;
+}
+
+/**
+ * @brief Moves the unparsed bytes to the front of the buffer and reads the file after them
+ */
+static void csv_reader_fill(CsvReader* reader) {
+    size_t rest = reader->end - reader->pos;
+    memmove(reader->buffer, reader->buffer + reader->pos, rest);
+
+    size_t wanted = CSV_READ_BUFFER_SIZE - rest;
+    size_t read = fread(reader->buffer + rest, 1, wanted, reader->file);
+
+    reader->pos = 0;
+    reader->end = rest + read;
+    reader->eof = read < wanted; // end of the file (or a read error, like fgets())
+}
+
+/**
+ * @brief Parses the next request, empty rows are skipped
+ *
+ * @details
+ * A row ends at the newline, or after CSV_MAX_ROW characters (like fgets() with a 100 byte buffer).
+ * If the row contains a null character, it ends there (like the string of fgets()).
+ *
+ * @return int (1 if a request has been parsed, 0 at the end of the file, -1 if a row is invalid)
+ */
+static int csv_reader_next(CsvReader* reader, struct Request* request) {
+    for (;;) {
+        // a row is only split if CSV_MAX_ROW characters have been read
+        if (reader->end - reader->pos < CSV_MAX_ROW && !reader->eof) {
+            csv_reader_fill(reader);
+        }
+
+        const char* row = reader->buffer + reader->pos;
+        const char* end = reader->buffer + reader->end;
+        if (row == end) {
+            return 0;
+        }
+
+        const char* limit = (end - row > CSV_MAX_ROW) ? row + CSV_MAX_ROW : end;
+        const char* row_end = find_delimiter(row, limit, '\n');
+        const char* next = row_end;
+        if (row_end < limit && *row_end == '\0') {
+            next = memchr(row_end, '\n', limit - row_end);
+            if (next == NULL) next = limit;
+        }
+
+        // skip the newline
+        reader->pos = (size_t) (next - reader->buffer) + (next < limit);
+
+        int status = parse_row(row, row_end, request);
+        if (status != 0) {
+            return status;
         }
     }
-    input[j] = '\0';
+}
+
+/**
+ * @brief Closes the file and frees the buffer of csv_reader_open()
+ */
+static void csv_reader_close(CsvReader* reader) {
+    fclose(reader->file);
+    free(reader->buffer);
 }
 
 /**
@@ -34,170 +392,279 @@ void remove_whitespaces(char* input) {
  * @param numRequests The number of requests to be simulated.
  * @param customReq Read to the end of csv if false
  *
- * @return int (0 if successful, -1 if failed)
+ * @return int (the number of requests parsed if successful, -1 if failed)
  *
  * @warning DO NOT REMOVE ANY OF THE COMMENTS!
  * @author Lie Leon Alexius
  */
 int parse_csv(const char* input_filename, struct Request* requests, int numRequests, bool customReq) {
     // Open the file
-    // Syntax: FILE* fptr; fptr = fopen(filename, mode);
-    FILE* file = fopen(input_filename, "r");
-    if (!file) {
-        // No need to close file here since fopen will return NULL
-        fprintf(stderr, "Failed to open input file\n");
+    CsvReader reader;
+    if (csv_reader_open(&reader, input_filename) == -1) {
         return -1;
     }
 
-    // Initialize buffer
-    /*
-        __uint32_t max = 4_294_967_295 = 0xFFFFFFFF (10 char)
-        Max 1 Line = 1 + 1 + 1 + 10 + 1 + 1 + 10 = 25 char
-    */
-    char line[100]; // assume a line up to 100 char (user is high on whitespaces)
-    char rw[10]; // R or W
-    char addr_str[20]; // Hexadecimal or Decimal
-    char data_str[20]; // Hexadecimal or Decimal
-
     int i = 0; // request(s) counter
 
-    // Read the requests from the file
-    // Syntax: fgets(buffer, buffer_size, fptr);
-    /*
-        """
-        my name is John Doe\n
-        my name is Jane Doe\n
-        \n
-        \n
-        """
-        fgets() -> "my name is John Doe\n"
-        fgets() -> "my name is Jane Doe\n"
-        fgets() -> "\n"
-        fgets() -> "\n"
-    */
-    while (fgets(line, sizeof(line), file) != NULL) {
-        // Remove the first occurrence of (\n) replace it with the null character (\0)
-        line[strcspn(line, "\n")] = 0;
-
-        // Reset buffers
-        memset(rw, 0, sizeof(rw));
-        memset(addr_str, 0, sizeof(addr_str));
-        memset(data_str, 0, sizeof(data_str));
-
-        // Parse the line
-        // %[^,] matches any sequence of characters except for a comma (stop if see comma)
-        // , is a delimiter marks that next field starts after a comma
-        int fields = sscanf(line, "%[^,],%[^,],%s", rw, addr_str, data_str);
-
-        /*  Cases
-            1. "Hello,World,!" -> "Hello"; "World"; "!"
-            2. "He,llo,World,!" -> "He"; "llo"; "World,!" (PROBLEM)
-            3. "    " -> "    "; ""; "" (EDGE CASE)
-        */
-
-        // Remove whitespace(s)
-        remove_whitespaces(rw);
-        remove_whitespaces(addr_str);
-        remove_whitespaces(data_str);
-
-        // Check if the third field has no other field
-        // strchr() returns a pointer to the first occurrence of the character c in the string s
-        if (strchr(data_str, ',') != NULL) {
-            fprintf(stderr, "Invalid third collumn: %s\n", data_str);
-            return -1;
-        }
-        
-        // Case: trailing whitespace in the data field for read requests
-        // Note: remove_whitespaces() should have made 1st char into '\0'
-        if (fields == 3 && rw[0] == 'R' && data_str[0] == '\0') {
-            fields = 2;
-        }
+    // Read the requests from the file, empty rows are skipped
+    int status;
+    while ((status = csv_reader_next(&reader, &requests[i])) == 1) {
+        i++;
 
-        // Min. valid field in a row = 2
-        // Note: This should be triggered only if the syntax of .csv is false
-        //       We ignore Empty lines (look at if-else if-else)
-        if (fields < 2 && (rw[0] != '\0' || addr_str[0] != '\0' || data_str[0] != '\0')) {
-            fprintf(stderr, "Error in parsing the data - wrong format\n");
-            return -1;
+        // Case: Enough valid Requests has been read
+        if (customReq && i >= numRequests) {
+            break;
         }
+    }
 
-        // Case: Write
-        if (strcmp(rw, "W") == 0) {
-            if (fields != 3) {
-                fprintf(stderr, "Error in parsing the data - wrong format for write request\n");
-                return -1;
-            }
-            requests[i].we = 1;
-            
-            // Parse address
-            if (addr_str[1] == 'x' || addr_str[1] == 'X') {
-                sscanf(addr_str, "%x", &requests[i].addr);
-            } 
-            else {
-                sscanf(addr_str, "%u", &requests[i].addr);
-            }
+    // Close the file
+    csv_reader_close(&reader);
 
-            // Parse data
-            if (data_str[1] == 'x' || data_str[1] == 'X') {
-                sscanf(data_str, "%x", &requests[i].data);
-            } 
-            else {
-                sscanf(data_str, "%u", &requests[i].data);
-            }
+    if (status == -1) {
+        return -1;
+    }
 
-            i++;
-        }
+    // check if numRequests has been fulfilled
+    if (customReq && i != numRequests) {
+        fprintf(stderr, "Error: number of requests parsed does not match numRequests\n");
+        return -1;
+    }
 
-        // Case: Read
-        else if (strcmp(rw, "R") == 0) {
-            if (fields != 2) {
-                fprintf(stderr, "Error in parsing the data - wrong format for read request\n");
-                return -1;
-            }
+    // safety: initialize request[i].we as invalid value to know when to stop
+    requests[i].we = -1;
 
-            requests[i].we = 0;
-            requests[i].data = 0; // Default value for Read
+    return i;
+}
 
-            // Parse address
-            if (addr_str[1] == 'x' || addr_str[1] == 'X') {
-                sscanf(addr_str, "%x", &requests[i].addr);
-            } 
-            else {
-                sscanf(addr_str, "%u", &requests[i].addr);
-            }
+/**
+ * @brief Single-producer/single-consumer ring of batches between the parser thread and the simulation
+ *
+ * @details
+ * The parser thread fills requests[head % CSV_STREAM_RING_SIZE] and then increments head.
+ * The simulation works on requests[tail % CSV_STREAM_RING_SIZE] and increments tail when it asks for
+ * the next batch. Each counter is only written by one thread, so there is no lock: the release store of
+ * head publishes a batch, the release store of tail hands its slot back to the parser thread.
+ *
+ * head and tail are on separate cache lines, so that the two threads do not invalidate each other's line.
+ */
+struct CsvPipeline {
+    _Alignas(64) atomic_size_t head;                  // batches published by the parser thread
+    _Alignas(64) atomic_size_t tail;                  // batches released by the simulation
+    _Alignas(64) atomic_bool stop;                    // csv_stream_close() before the end of the file
 
-            i++;
-        }
+    struct Request* requests[CSV_STREAM_RING_SIZE];   // batchSize + 1 requests each
+    long counts[CSV_STREAM_RING_SIZE];                // see csv_stream_next()
+    bool holding;                                     // the simulation works on requests[tail]
+    pthread_t thread;
+};
 
-        // Case: Unknown Op
-        else {
-            // ignore empty line with whitespaces (See case-3 in sscanf())
-            if(rw[0] == '\0') {
-                continue;
-            }
-            else {
-                fprintf(stderr, "Error in parsing the data - unrecognized command\n");
-                return -1;
-            }
-        }
+/**
+ * @brief Parses the next batch of requests into `batch`, followed by the .we = -1 marker
+ * @return the number of requests in the batch (0 at the end of the file or the limit), -1 if a row is invalid
+ */
+static long parse_batch(CsvStream* stream, struct Request* batch) {
+    size_t count = 0;
 
-        // Case: Enough valid Requests has been read
-        if (customReq && i >= numRequests) {
+    while (count < stream->batchSize && stream->parsed < stream->limit) {
+        int status = csv_reader_next(&stream->reader, &batch[count]);
+        if (status == -1) {
+            return -1;
+        }
+        if (status == 0) {
             break;
         }
+        count++;
+        stream->parsed++;
     }
 
-    // Close the file
-    fclose(file);
+    batch[count].we = -1;
+    return (long) count;
+}
 
-    // check if numRequests has been fulfilled
-    if (customReq && i != numRequests) {
-        fprintf(stderr, "Error: number of requests parsed does not match numRequests\n");
+/**
+ * @brief Waits for the other end of the ring
+ * @details Yields first, as the other thread is usually about to finish a batch, then sleeps, so that
+ * a full ring (the simulation is slower than the parser) does not keep a core busy
+ */
+static void pipeline_wait(unsigned* attempts) {
+    if ((*attempts)++ < 64) {
+        sched_yield();
+    }
+    else {
+        struct timespec pause = {0, 50000}; // 50 us
+        nanosleep(&pause, NULL);
+    }
+}
+
+/**
+ * @brief The parser thread: fills the ring until the end of the file, the limit or an invalid row
+ */
+static void* pipeline_run(void* arg) {
+    CsvStream* stream = (CsvStream*) arg;
+    struct CsvPipeline* pipeline = stream->pipeline;
+
+    for (size_t head = 0;; head++) {
+        // wait for a free slot
+        unsigned attempts = 0;
+        while (head - atomic_load_explicit(&pipeline->tail, memory_order_acquire) == CSV_STREAM_RING_SIZE) {
+            if (atomic_load_explicit(&pipeline->stop, memory_order_relaxed)) return NULL;
+            pipeline_wait(&attempts);
+        }
+
+        size_t slot = head % CSV_STREAM_RING_SIZE;
+        long count = parse_batch(stream, pipeline->requests[slot]);
+        pipeline->counts[slot] = count;
+        atomic_store_explicit(&pipeline->head, head + 1, memory_order_release);
+
+        // the last batch is empty (or an error), the simulation reads it as often as it asks
+        if (count <= 0) return NULL;
+    }
+}
+
+/**
+ * @brief Frees the ring (the parser thread must not run)
+ */
+static void pipeline_free(struct CsvPipeline* pipeline) {
+    for (unsigned slot = 0; slot < CSV_STREAM_RING_SIZE; slot++) {
+        free(pipeline->requests[slot]);
+    }
+    free(pipeline);
+}
+
+/**
+ * @brief Allocates the ring and starts the parser thread
+ * @return int (0 if successful, -1 if failed)
+ */
+static int pipeline_start(CsvStream* stream) {
+    struct CsvPipeline* pipeline = aligned_alloc(_Alignof(struct CsvPipeline), sizeof(struct CsvPipeline));
+    if (pipeline == NULL) {
+        fprintf(stderr, "Error when allocating CsvPipeline\n");
         return -1;
     }
 
-    // safety: initialize request[i].we as invalid value to know when to stop
-    requests[i].we = -1;
+    atomic_init(&pipeline->head, 0);
+    atomic_init(&pipeline->tail, 0);
+    atomic_init(&pipeline->stop, false);
+    pipeline->holding = false;
 
+    bool allocated = true;
+    for (unsigned slot = 0; slot < CSV_STREAM_RING_SIZE; slot++) {
+        pipeline->requests[slot] = malloc((stream->batchSize + 1) * sizeof(struct Request));
+        allocated &= pipeline->requests[slot] != NULL;
+    }
+    if (!allocated) {
+        fprintf(stderr, "Error when allocating Request Struct in CsvPipeline\n");
+        pipeline_free(pipeline);
+        return -1;
+    }
+
+    stream->pipeline = pipeline;
+    if (pthread_create(&pipeline->thread, NULL, pipeline_run, stream) != 0) {
+        fprintf(stderr, "Failed to start the parser thread\n");
+        stream->pipeline = NULL;
+        pipeline_free(pipeline);
+        return -1;
+    }
     return 0;
 }
+
+/**
+ * @brief Opens a .csv file for the streaming mode (`--streaming-parse true`)
+ *
+ * @details
+ * The requests are parsed in batches of batchSize by csv_stream_next(), while the simulation runs.
+ * The memory stays the same for every trace length, and the file is only read once.
+ *
+ * Pipelined (`--pipelined-parse true`), a parser thread fills a ring of CSV_STREAM_RING_SIZE batches
+ * ahead of the simulation (see struct CsvPipeline), so that reading and tokenizing overlap with it.
+ *
+ * @param input_filename The name of the .csv file to parse.
+ * @param batchSize The number of requests per batch.
+ * @param limit Stop after this many requests (SIZE_MAX for the whole file).
+ * @param pipelined Parse the batches on a second thread.
+ *
+ * @return the stream, NULL if failed
+ */
+CsvStream* csv_stream_open(const char* input_filename, size_t batchSize, size_t limit, bool pipelined) {
+    CsvStream* stream = malloc(sizeof(CsvStream));
+    if (stream == NULL) {
+        fprintf(stderr, "Error when allocating CsvStream\n");
+        return NULL;
+    }
+
+    if (csv_reader_open(&stream->reader, input_filename) == -1) {
+        free(stream);
+        return NULL;
+    }
+
+    stream->batchSize = batchSize;
+    stream->parsed = 0;
+    stream->limit = limit;
+    stream->pipeline = NULL;
+
+    // (batchSize + 1) for the .we = -1 marker, the pipeline has its own batches
+    stream->batch = pipelined ? NULL : malloc((batchSize + 1) * sizeof(struct Request));
+    int status = pipelined ? pipeline_start(stream) : (stream->batch == NULL) ? -1 : 0;
+    if (status == -1) {
+        if (!pipelined) fprintf(stderr, "Error when allocating Request Struct in CsvStream\n");
+        csv_reader_close(&stream->reader);
+        free(stream);
+        return NULL;
+    }
+
+    return stream;
+}
+
+/**
+ * @brief Makes the next batch of requests the current one (`stream->batch`)
+ *
+ * @details
+ * Without the pipeline, the batch is parsed now and overwrites the previous one.
+ * With the pipeline, the previous batch is handed back to the parser thread, and the next one is
+ * taken from the ring (waiting for the parser thread if it is not ready yet).
+ *
+ * @note `stream->parsed` is only final once 0 has been returned
+ * @return the number of requests in the batch (0 at the end of the file or the limit), -1 if a row is invalid
+ */
+long csv_stream_next(CsvStream* stream) {
+    struct CsvPipeline* pipeline = stream->pipeline;
+    if (pipeline == NULL) {
+        return parse_batch(stream, stream->batch);
+    }
+
+    size_t tail = atomic_load_explicit(&pipeline->tail, memory_order_relaxed);
+    if (pipeline->holding) {
+        atomic_store_explicit(&pipeline->tail, ++tail, memory_order_release);
+        pipeline->holding = false;
+    }
+
+    unsigned attempts = 0;
+    while (atomic_load_explicit(&pipeline->head, memory_order_acquire) == tail) {
+        pipeline_wait(&attempts);
+    }
+
+    // the last batch (0 or -1) stays in the ring
+    size_t slot = tail % CSV_STREAM_RING_SIZE;
+    long count = pipeline->counts[slot];
+    if (count > 0) {
+        stream->batch = pipeline->requests[slot];
+        pipeline->holding = true;
+    }
+    return count;
+}
+
+/**
+ * @brief Closes the file and frees the stream (stops the parser thread first)
+ */
+void csv_stream_close(CsvStream* stream) {
+    if (stream->pipeline != NULL) {
+        atomic_store_explicit(&stream->pipeline->stop, true, memory_order_relaxed);
+        pthread_join(stream->pipeline->thread, NULL);
+        pipeline_free(stream->pipeline);
+    }
+    else {
+        free(stream->batch);
+    }
+    csv_reader_close(&stream->reader);
+    free(stream);
+}
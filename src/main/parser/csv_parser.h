@@ -5,6 +5,12 @@
 
 #include "parse.h"
 
+/*
+    The old parser read the rows with fgets(line, 100, file), so a row longer than 99 characters
+    has been split into several rows. The reader splits them the same way (see csv_reader_next()).
+*/
+#define CSV_MAX_ROW 99
+
 int parse_csv(const char* input_filename, struct Request* requests, int numRequests, bool customReq);
 
 #endif // CSV_PARSER_H
@@ -3,6 +3,7 @@
 #include "parse.h"
 #include "csv_parser.h"
 #include "terminal_parser.h"
+#include "binary_trace.h"
 
 /**
  * @brief Count total lines in CSV
@@ -14,7 +15,7 @@
  * 
  * @note this returns `Number_Of_Request` remember to add `1` for `.we = -1`
  * 
- * @warning Non-empty row will be counted as a line (a request)
+ * @warning Non-empty row will be counted as a line (a request), a line longer than CSV_MAX_ROW as several
  * 
  * @author Lie Leon Alexius
  */
@@ -26,36 +27,46 @@ int calculateLines(const char* input_filename) {
     }
 
     int count = 0; // count should be incremented only if a line contains at least one character
-    char ch;
-    bool isLineNotEmpty = false;
-    while ((ch = fgetc(file)) != EOF) {
-        if (ch != '\n') {
-            isLineNotEmpty = true; // Current line has content
-        } 
-        else {
-            if (isLineNotEmpty) {
-                count++; // Increment count for non-empty line
-                isLineNotEmpty = false; // Reset for the next line
+    size_t length = 0; // characters of the current line so far
+    char block[1 << 16];
+    size_t read;
+    while ((read = fread(block, 1, sizeof(block), file)) > 0) {
+        const char* pos = block;
+        const char* end = block + read;
+        while (pos < end) {
+            const char* newline = memchr(pos, '\n', end - pos);
+            if (newline == NULL) {
+                length += end - pos;
+                break;
             }
+            length += newline - pos;
+
+            // a line longer than CSV_MAX_ROW is parsed as several rows
+            count += (length + CSV_MAX_ROW - 1) / CSV_MAX_ROW;
+            length = 0;
+            pos = newline + 1;
         }
     }
 
+    // the last line does not need a newline
+    count += (length + CSV_MAX_ROW - 1) / CSV_MAX_ROW;
+
     fclose(file);
     return count;
 }
 
 /**
- * @brief Parser starts here
- * @author Lie Leon Alexius
+ * @brief true if the file is a binary trace (`.trace`), false if it is a .csv
  */
-Config* start_parse(int argc, char* argv[]) {
-
-    // Parse User Input
-    Config* config = parse_user_input(argc, argv);
-
-    // ========================================================================================
+bool is_binary_trace(const char* filename) {
+    size_t len = strlen(filename);
+    return len > 6 && strcmp(filename + len - 6, ".trace") == 0;
+}
 
-    // Parse .csv
+/**
+ * @brief Counts and parses the .csv requests into `config->requests`
+ */
+static void parse_csv_requests(Config* config) {
     // Get numRequest of the file - Read Warning calculateLines()
     if (!(config->customNumRequest)) {
         int totalRequest = calculateLines(config->input_filename);
@@ -80,7 +91,8 @@ Config* start_parse(int argc, char* argv[]) {
     }
 
     // run parse_csv
-    if (parse_csv(config->input_filename, config->requests, config->numRequests, config->customNumRequest) == -1) {
+    int parsed = parse_csv(config->input_filename, config->requests, config->numRequests, config->customNumRequest);
+    if (parsed == -1) {
         free(config->requests);
         config->requests = NULL;
         free(config);
@@ -89,6 +101,83 @@ Config* start_parse(int argc, char* argv[]) {
         exit(EXIT_FAILURE);
     }
 
+    // calculateLines() also counts rows without a request (e.g. only whitespaces)
+    config->numRequests = parsed;
+}
+
+/**
+ * @brief Releases the requests, whether they have been parsed or mapped (see load_binary_trace())
+ */
+void free_requests(Config* config) {
+    if (config->requestsMapping != NULL) {
+        unload_binary_trace(config);
+    }
+    else {
+        free(config->requests);
+    }
+    config->requests = NULL;
+}
+
+/**
+ * @brief Loads the requests of `config->input_filename` into `config->requests` (or opens the stream)
+ * @note Exits the program if the requests cannot be loaded
+ */
+void load_requests(Config* config) {
+    // Binary trace: mapped, no parsing needed
+    if (is_binary_trace(config->input_filename)) {
+        if (load_binary_trace(config) == -1) {
+            free(config);
+            config = NULL;
+            fprintf(stderr, "Error when loading binary trace\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    // Streaming: the requests are parsed in batches during the simulation (on a second thread if pipelined)
+    else if (config->streamingParse) {
+        size_t limit = config->customNumRequest ? config->numRequests : SIZE_MAX;
+        config->csvStream = csv_stream_open(config->input_filename, CSV_STREAM_BATCH_SIZE, limit, config->pipelinedParse);
+        if (config->csvStream == NULL) {
+            free(config);
+            config = NULL;
+            fprintf(stderr, "Error when parsing CSV\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    else {
+        parse_csv_requests(config);
+    }
+}
+
+/**
+ * @brief Parser starts here
+ * @author Lie Leon Alexius
+ */
+Config* start_parse(int argc, char* argv[]) {
+
+    // Parse User Input
+    Config* config = parse_user_input(argc, argv);
+
+    // ========================================================================================
+
+    // Load or open the requests
+    load_requests(config);
+
+    // Convert instead of simulating
+    if (config->convert_filename != NULL) {
+        int status = write_binary_trace(config->convert_filename, config->requests, config->numRequests, config->traceFormat);
+        free_requests(config);
+        if (status == -1) {
+            free(config);
+            config = NULL;
+            fprintf(stderr, "Error when writing binary trace\n");
+            exit(EXIT_FAILURE);
+        }
+        printf("Converted %zu requests to %s\n", config->numRequests, config->convert_filename);
+        free(config);
+        config = NULL;
+        exit(EXIT_SUCCESS);
+    }
+
     // ========================================================================================
 
     // return finished Configuration
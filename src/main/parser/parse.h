@@ -14,6 +14,66 @@
 // Request and Result struct
 #include "../simulator.hpp"
 
+// Simulation engines
+typedef enum {
+    ENGINE_SYSTEMC = 0,     // cycle-accurate SystemC model (default)
+    ENGINE_FUNCTIONAL,      // untimed C++ model, cycles are calculated from the latencies
+    ENGINE_STACK_DISTANCE   // single pass LRU stack distances, miss-ratio curves of every cache size
+} Engine;
+
+// How the SystemC engine advances the simulation
+typedef enum {
+    DRIVER_EVENT = 0,       // run until the next done event (default)
+    DRIVER_STEP,            // run one clock cycle at a time
+    DRIVER_STREAM           // a CPU module issues all requests in a single sc_start()
+} Driver;
+
+// Write policy of L1 and L2
+typedef enum {
+    WRITE_THROUGH = 0,      // write-through, no-write-allocate (default)
+    WRITE_BACK              // write-back, write-allocate, dirty lines are written back when replaced
+} WritePolicy;
+
+// What a read miss of L2 waits for when the line may be in the storeback buffer
+typedef enum {
+    STOREBACK_FLUSH_ALL = 0,    // the whole buffer is written to memory (default)
+    STOREBACK_FLUSH_LINE        // only the entries of the line (selective flush)
+} StorebackFlush;
+
+// Record format of a binary trace (see binary_trace.h)
+typedef enum {
+    TRACE_FORMAT_RAW = 0,   // struct Request records, mapped without copying (default)
+    TRACE_FORMAT_DELTA      // delta-encoded addresses and varints, decoded when loaded
+} TraceFormat;
+
+// Requests per batch of the streaming mode
+#define CSV_STREAM_BATCH_SIZE 4096
+
+// Buffered reader of a .csv file (see csv_reader_next() in csv_parser.c)
+typedef struct {
+    FILE* file;
+    char* buffer; // the file is read in large blocks, the rows are tokenized in place
+    size_t pos; // next unparsed byte in buffer
+    size_t end; // end of the bytes read into buffer
+    bool eof; // the whole file has been read into buffer
+} CsvReader;
+
+// Batches in flight between the parser thread and the simulation in the pipelined mode
+#define CSV_STREAM_RING_SIZE 4
+
+// Parser thread and ring of the pipelined mode (defined in csv_parser.c)
+struct CsvPipeline;
+
+// Chunked .csv reader of the streaming mode (see csv_stream_open())
+typedef struct {
+    CsvReader reader;
+    struct Request* batch; // requests of the current batch, followed by the .we = -1 marker
+    size_t batchSize; // capacity of batch
+    size_t parsed; // requests parsed so far
+    size_t limit; // stop after this many requests
+    struct CsvPipeline* pipeline; // NULL unless the batches are parsed on a second thread
+} CsvStream;
+
 // Config struct
 typedef struct {
     int cycles;
@@ -23,20 +83,46 @@ typedef struct {
     unsigned int l1CacheLatency;
     unsigned int l2CacheLatency;
     unsigned int memoryLatency;
+    unsigned int l1Ways; // lines per set of the L1 cache (1 = direct-mapped)
+    unsigned int l2Ways; // lines per set of the L2 cache (1 = direct-mapped)
+    Replacement replacement; // replacement policy of the set-associative caches
+    WritePolicy writePolicy; // default is WRITE_THROUGH
     size_t numRequests;
     const char* tracefile;
     const char* input_filename;
     struct Request* requests;
     bool customNumRequest;
+    const char* convert_filename; // write the requests as a binary trace instead of simulating (NULL = simulate)
+    TraceFormat traceFormat; // record format of the converted binary trace
+    void* requestsMapping; // mapped binary trace the requests point into (NULL if the requests are allocated)
+    size_t requestsMappingSize; // size of requestsMapping in bytes
+    bool streamingParse; // parse the .csv in batches while simulating instead of up front
+    bool pipelinedParse; // parse the batches on a second thread (implies streamingParse)
+    CsvStream* csvStream; // the open .csv in the streaming mode (NULL otherwise)
+    bool timingOnly; // L1, L2 and memory keep no data, only tags and valid bits (SystemC engine)
 
     // Optimization flags
     unsigned int prefetchBuffer;  // How many cacheLines does prefetchBuffer have
     unsigned int storebackBuffer; // How many cacheLines does storebackBuffer have
     bool storebackBufferCondition; // (during Read) false = always flush, true = flush only if tag exists or interrupt
+    bool storebackCombine; // the writes to a line are merged into one storeback entry (one memory write per line)
+    StorebackFlush storebackFlush; // default is STOREBACK_FLUSH_ALL
+    bool storebackForward; // read misses take the bytes of their line from the storeback buffer instead of flushing it
+    Prefetcher prefetcher; // default is PREFETCHER_NEXTLINE
+    unsigned int prefetchDegree; // lines prefetched per read miss (0 = prefetchBuffer)
+    unsigned int prefetchDistance; // lines from the read miss to the first prefetched line (0 = 1, the next line)
 
     bool prettyPrint; // default is true, prints the details of the simulator
+    Engine engine; // default is ENGINE_SYSTEMC
+    Driver driver; // default is DRIVER_EVENT
 } Config;
 
 Config* start_parse(int argc, char* argv[]);
+void load_requests(Config* config);
+void free_requests(Config* config);
+bool is_binary_trace(const char* filename);
+CsvStream* csv_stream_open(const char* input_filename, size_t batchSize, size_t limit, bool pipelined);
+long csv_stream_next(CsvStream* stream);
+void csv_stream_close(CsvStream* stream);
 
 #endif // PARSE_H
@@ -1,6 +1,7 @@
 // Lie Leon Alexius
 
 #include "terminal_parser.h"
+#include "config_check.h"
 
 /**
  * @brief Method for -h or --help
@@ -18,12 +19,30 @@ void print_help() {
     printf("      --l1-latency <num>            The latency of the L1 cache in cycles (default: 4)\n");
     printf("      --l2-latency <num>            The latency of the L2 cache in cycles (default: 12)\n");
     printf("      --memory-latency <num>        The latency of the main memory in cycles (default: 100)\n");
+    printf("      --l1-ways <num>               The number of cache lines per set of the L1 cache (default: 1)\n");
+    printf("      --l2-ways <num>               The number of cache lines per set of the L2 cache (default: 1)\n");
+    printf("      --replacement=<policy>        Replacement policy of the sets: lru, plru, fifo, random (default: lru)\n");
+    printf("      --write-policy=<through|back> Write-through or write-back, write-allocate caches (default: through)\n");
     printf("      --tf=<filepath>               Output file for a trace file with all signals (default: None)\n");
     printf("      --num-requests <num>          Number of request to read from .csv file (default: all requests)\n");
     printf("      --prefetch-buffer <num>       The number of cache lines in the prefetch buffer (default: 0)\n");
+    printf("      --prefetcher=<kind>           Lines to prefetch: nextline, stride, stream (default: nextline)\n");
+    printf("      --prefetch-degree <num>       Lines prefetched per read miss, at most the prefetch buffer (default: prefetch-buffer)\n");
+    printf("      --prefetch-distance <num>     Lines from the read miss to the first prefetched line (default: 1)\n");
     printf("      --storeback-buffer <num>      The number of cache lines in the storeback buffer (default: 0)\n");
     printf("      --storeback-condition <bool>  The condition for storeback buffer (default: false)\n");
+    printf("      --storeback-combine <bool>    Merge the writes to a line into one storeback entry (default: false)\n");
+    printf("      --storeback-flush=<all|line>  A read miss waits for the whole storeback buffer or its line (default: all)\n");
+    printf("      --storeback-forward <bool>    Read misses take the bytes of their line from the storeback buffer (default: false)\n");
     printf("      --pretty-print <bool>         Pretty print the output (default: true)\n");
+    printf("      --engine=<systemc|functional> Simulation engine, functional skips SystemC (default: systemc)\n");
+    printf("      --engine=stack-distance       Miss-ratio curves of every cache size in one pass (LRU, write-back only)\n");
+    printf("      --driver=<event|step|stream>  How SystemC advances, event skips idle cycles (default: event)\n");
+    printf("      --convert=<filepath>          Write the requests as a binary .trace file and exit (default: None)\n");
+    printf("      --trace-format=<raw|delta>    Records of the binary trace, raw is mapped without copying (default: raw)\n");
+    printf("      --streaming-parse <bool>      Parse the .csv in batches during the simulation (default: false)\n");
+    printf("      --pipelined-parse <bool>      Streaming, with the batches parsed on a second thread (default: false)\n");
+    printf("      --timing-only <bool>          Store no cache or memory data, only cycles, hits and misses (default: false)\n");
     printf("  -h, --help                        Display this help and exit\n");
 }
 
@@ -47,6 +66,24 @@ void print_help() {
  *  12. storebackBuffer = 0 (default storeback buffer)
  *  13. prettyPrint = true (default pretty print flag)
  *  14. storebackBufferCondition = false (default storeback buffer condition)
+ *  15. engine = ENGINE_SYSTEMC (default simulation engine)
+ *  16. driver = DRIVER_EVENT (default SystemC driver)
+ *  17. l1Ways = 1 (default L1 cache lines per set, direct-mapped)
+ *  18. l2Ways = 1 (default L2 cache lines per set, direct-mapped)
+ *  19. replacement = REPLACEMENT_LRU (default replacement policy)
+ *  20. writePolicy = WRITE_THROUGH (default write policy of L1 and L2)
+ *  21. customWritePolicy = false (flag for a write policy given on the command line)
+ *  22. convert_filename = NULL (default is to simulate, not to convert)
+ *  23. traceFormat = TRACE_FORMAT_RAW (default record format of a converted binary trace)
+ *  24. streamingParse = false (default is to parse the whole .csv before the simulation)
+ *  25. pipelinedParse = false (default is to parse the batches on the simulation thread)
+ *  26. timingOnly = false (default is to store the data of the cache lines and the memory)
+ *  27. storebackCombine = false (default is one storeback entry per write)
+ *  28. storebackFlush = STOREBACK_FLUSH_ALL (default is to flush the whole storeback buffer)
+ *  29. storebackForward = false (default is to flush the storeback buffer before a read of a line in it)
+ *  30. prefetcher = PREFETCHER_NEXTLINE (default is to prefetch the lines after a read miss)
+ *  31. prefetchDegree = prefetchBuffer (default is to fill the prefetch buffer on every read miss)
+ *  32. prefetchDistance = 1 (default is to start at the line after the read miss)
  * 
  * @author Lie Leon Alexius
  */
@@ -71,11 +108,29 @@ Config* parse_user_input(int argc, char* argv[]) {
     const char* input_filename = NULL;
     bool customNumRequest = false;
     bool prettyPrint = true;
+    Engine engine = ENGINE_SYSTEMC;
+    Driver driver = DRIVER_EVENT;
+    unsigned int l1Ways = 1;
+    unsigned int l2Ways = 1;
+    Replacement replacement = REPLACEMENT_LRU;
+    WritePolicy writePolicy = WRITE_THROUGH;
+    bool customWritePolicy = false;
+    const char* convert_filename = NULL;
+    TraceFormat traceFormat = TRACE_FORMAT_RAW;
+    bool streamingParse = false;
+    bool pipelinedParse = false;
+    bool timingOnly = false;
 
     // Optimization flags
     unsigned int prefetchBuffer = 0;
     unsigned int storebackBuffer = 0;
     bool storebackBufferCondition = false;
+    bool storebackCombine = false;
+    StorebackFlush storebackFlush = STOREBACK_FLUSH_ALL;
+    bool storebackForward = false;
+    Prefetcher prefetcher = PREFETCHER_NEXTLINE;
+    unsigned int prefetchDegree = 0; // 0 = prefetchBuffer
+    unsigned int prefetchDistance = 1;
 
     // ========================================================================================
 
@@ -93,9 +148,26 @@ Config* parse_user_input(int argc, char* argv[]) {
         {"tf", required_argument, 0, 0},
         {"num-requests", required_argument, 0, 0},
         {"prefetch-buffer", required_argument, 0, 0}, // Optimization: Prefetch Buffer
+        {"prefetcher", required_argument, 0, 0}, // Optimization: Stride and Stream Prefetchers
+        {"prefetch-degree", required_argument, 0, 0}, // Optimization: Lines per Prefetch
+        {"prefetch-distance", required_argument, 0, 0}, // Optimization: Prefetch Distance
         {"storeback-buffer", required_argument, 0, 0}, // Optimization: Storeback Buffer
         {"storeback-condition", required_argument, 0, 0}, // Optimization: Conditional Storeback Buffer
+        {"storeback-combine", required_argument, 0, 0}, // Optimization: Write-Combining Storeback Buffer
+        {"storeback-flush", required_argument, 0, 0}, // Optimization: Selective Flush of the Storeback Buffer
+        {"storeback-forward", required_argument, 0, 0}, // Optimization: Store-to-Load Forwarding
         {"pretty-print", required_argument, 0, 'p'}, // New: Pretty Print Option
+        {"engine", required_argument, 0, 0}, // Simulation engine
+        {"driver", required_argument, 0, 0}, // SystemC driver
+        {"l1-ways", required_argument, 0, 0}, // Set-associative L1
+        {"l2-ways", required_argument, 0, 0}, // Set-associative L2
+        {"replacement", required_argument, 0, 0}, // Replacement policy
+        {"write-policy", required_argument, 0, 0}, // Write-through or write-back
+        {"convert", required_argument, 0, 0}, // Convert to a binary trace
+        {"trace-format", required_argument, 0, 0}, // Records of the binary trace
+        {"streaming-parse", required_argument, 0, 0}, // Parse the .csv in batches
+        {"pipelined-parse", required_argument, 0, 0}, // Parse the batches on a second thread
+        {"timing-only", required_argument, 0, 0}, // No cache or memory data
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
@@ -245,6 +317,44 @@ Config* parse_user_input(int argc, char* argv[]) {
                         exit(EXIT_FAILURE);
                     }
                 } 
+                // Optimization: Stride and Stream Prefetchers
+                else if (strcmp("prefetcher", long_options[long_index].name) == 0) {
+                    if (strcmp("nextline", optarg) == 0) {
+                        prefetcher = PREFETCHER_NEXTLINE;
+                    } 
+                    else if (strcmp("stride", optarg) == 0) {
+                        prefetcher = PREFETCHER_STRIDE;
+                    } 
+                    else if (strcmp("stream", optarg) == 0) {
+                        prefetcher = PREFETCHER_STREAM;
+                    } 
+                    else {
+                        fprintf(stderr, "Invalid input for prefetcher\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                // Optimization: Lines per Prefetch
+                else if (strcmp("prefetch-degree", long_options[long_index].name) == 0) {
+                    errno = 0;
+                    prefetchDegree = strtoul(optarg, &endptr, 10);
+
+                    // Check for errors during conversion then print it
+                    if (errno != 0 || *endptr != '\0' || prefetchDegree == 0) {
+                        fprintf(stderr, "Invalid input for prefetch-degree\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                // Optimization: Prefetch Distance
+                else if (strcmp("prefetch-distance", long_options[long_index].name) == 0) {
+                    errno = 0;
+                    prefetchDistance = strtoul(optarg, &endptr, 10);
+
+                    // Check for errors during conversion then print it
+                    if (errno != 0 || *endptr != '\0' || prefetchDistance == 0) {
+                        fprintf(stderr, "Invalid input for prefetch-distance\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
                 // Optimization: Storeback Buffer
                 else if (strcmp("storeback-buffer", long_options[long_index].name) == 0) {
                     errno = 0;
@@ -271,6 +381,184 @@ Config* parse_user_input(int argc, char* argv[]) {
                         exit(EXIT_FAILURE);
                     }
                 }
+                // Optimization: Write-Combining Storeback Buffer
+                else if (strcmp("storeback-combine", long_options[long_index].name) == 0) {
+                    if (strcmp("true", optarg) == 0) {
+                        storebackCombine = 1;
+                    } 
+                    else if (strcmp("false", optarg) == 0) {
+                        storebackCombine = 0;
+                    } 
+                    else {
+                        fprintf(stderr, "Invalid input for storeback-combine\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                // Optimization: Selective Flush of the Storeback Buffer
+                else if (strcmp("storeback-flush", long_options[long_index].name) == 0) {
+                    if (strcmp("all", optarg) == 0) {
+                        storebackFlush = STOREBACK_FLUSH_ALL;
+                    } 
+                    else if (strcmp("line", optarg) == 0) {
+                        storebackFlush = STOREBACK_FLUSH_LINE;
+                    } 
+                    else {
+                        fprintf(stderr, "Invalid input for storeback-flush\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                // Optimization: Store-to-Load Forwarding
+                else if (strcmp("storeback-forward", long_options[long_index].name) == 0) {
+                    if (strcmp("true", optarg) == 0) {
+                        storebackForward = 1;
+                    } 
+                    else if (strcmp("false", optarg) == 0) {
+                        storebackForward = 0;
+                    } 
+                    else {
+                        fprintf(stderr, "Invalid input for storeback-forward\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                // Simulation engine
+                else if (strcmp("engine", long_options[long_index].name) == 0) {
+                    if (strcmp("systemc", optarg) == 0) {
+                        engine = ENGINE_SYSTEMC;
+                    } 
+                    else if (strcmp("functional", optarg) == 0) {
+                        engine = ENGINE_FUNCTIONAL;
+                    } 
+                    else if (strcmp("stack-distance", optarg) == 0) {
+                        engine = ENGINE_STACK_DISTANCE;
+                    } 
+                    else {
+                        fprintf(stderr, "Invalid input for engine\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                // SystemC driver
+                else if (strcmp("driver", long_options[long_index].name) == 0) {
+                    if (strcmp("event", optarg) == 0) {
+                        driver = DRIVER_EVENT;
+                    } 
+                    else if (strcmp("step", optarg) == 0) {
+                        driver = DRIVER_STEP;
+                    } 
+                    else if (strcmp("stream", optarg) == 0) {
+                        driver = DRIVER_STREAM;
+                    } 
+                    else {
+                        fprintf(stderr, "Invalid input for driver\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                // Set-associative caches
+                else if (strcmp("l1-ways", long_options[long_index].name) == 0) {
+                    errno = 0;
+                    l1Ways = strtoul(optarg, &endptr, 10);
+
+                    // Check for errors during conversion then print it
+                    if (errno != 0 || *endptr != '\0') {
+                        fprintf(stderr, "Invalid input for l1-ways\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                else if (strcmp("l2-ways", long_options[long_index].name) == 0) {
+                    errno = 0;
+                    l2Ways = strtoul(optarg, &endptr, 10);
+
+                    // Check for errors during conversion then print it
+                    if (errno != 0 || *endptr != '\0') {
+                        fprintf(stderr, "Invalid input for l2-ways\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                else if (strcmp("replacement", long_options[long_index].name) == 0) {
+                    if (strcmp("lru", optarg) == 0) {
+                        replacement = REPLACEMENT_LRU;
+                    } 
+                    else if (strcmp("plru", optarg) == 0) {
+                        replacement = REPLACEMENT_PLRU;
+                    } 
+                    else if (strcmp("fifo", optarg) == 0) {
+                        replacement = REPLACEMENT_FIFO;
+                    } 
+                    else if (strcmp("random", optarg) == 0) {
+                        replacement = REPLACEMENT_RANDOM;
+                    } 
+                    else {
+                        fprintf(stderr, "Invalid input for replacement\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                else if (strcmp("write-policy", long_options[long_index].name) == 0) {
+                    if (strcmp("through", optarg) == 0) {
+                        writePolicy = WRITE_THROUGH;
+                    } 
+                    else if (strcmp("back", optarg) == 0) {
+                        writePolicy = WRITE_BACK;
+                    } 
+                    else {
+                        fprintf(stderr, "Invalid input for write-policy\n");
+                        exit(EXIT_FAILURE);
+                    }
+                    customWritePolicy = true;
+                }
+                else if (strcmp("convert", long_options[long_index].name) == 0) {
+                    if (!is_binary_trace(optarg)) {
+                        fprintf(stderr, "Invalid input for convert. Filename should end with .trace\n");
+                        exit(EXIT_FAILURE);
+                    }
+                    convert_filename = optarg;
+                }
+                else if (strcmp("trace-format", long_options[long_index].name) == 0) {
+                    if (strcmp("raw", optarg) == 0) {
+                        traceFormat = TRACE_FORMAT_RAW;
+                    } 
+                    else if (strcmp("delta", optarg) == 0) {
+                        traceFormat = TRACE_FORMAT_DELTA;
+                    } 
+                    else {
+                        fprintf(stderr, "Invalid input for trace-format\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                else if (strcmp("streaming-parse", long_options[long_index].name) == 0) {
+                    if (strcmp("true", optarg) == 0) {
+                        streamingParse = 1;
+                    } 
+                    else if (strcmp("false", optarg) == 0) {
+                        streamingParse = 0;
+                    } 
+                    else {
+                        fprintf(stderr, "Invalid input for streaming-parse\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                else if (strcmp("pipelined-parse", long_options[long_index].name) == 0) {
+                    if (strcmp("true", optarg) == 0) {
+                        pipelinedParse = 1;
+                    } 
+                    else if (strcmp("false", optarg) == 0) {
+                        pipelinedParse = 0;
+                    } 
+                    else {
+                        fprintf(stderr, "Invalid input for pipelined-parse\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                else if (strcmp("timing-only", long_options[long_index].name) == 0) {
+                    if (strcmp("true", optarg) == 0) {
+                        timingOnly = 1;
+                    } 
+                    else if (strcmp("false", optarg) == 0) {
+                        timingOnly = 0;
+                    } 
+                    else {
+                        fprintf(stderr, "Invalid input for timing-only\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
                 break;
             case '?':
                 // getopt_long already prints an error message to stderr
@@ -304,44 +592,16 @@ Config* parse_user_input(int argc, char* argv[]) {
         exit(EXIT_FAILURE);
     }
     
-    // Check if the filename ends with .csv
+    // Check if the filename ends with .csv (or .trace for a binary trace)
     size_t len = strlen(input_filename);
-    if (len <= 4 || strcmp(input_filename + len - 4, ".csv") != 0) {
-        fprintf(stderr, "Invalid filename. Filename should end with .csv\n");
+    if ((len <= 4 || strcmp(input_filename + len - 4, ".csv") != 0) && !is_binary_trace(input_filename)) {
+        fprintf(stderr, "Invalid filename. Filename should end with .csv (or .trace)\n");
         print_help();
         exit(EXIT_FAILURE);
     }
 
     // ========================================================================================
 
-    // Invalid cases check - throw error then quit
-    // 1. If L1 cache size is greater than L2 cache size
-    // 2. If L1 latency is greater than L2 latency or L2 latency is greater than memory latency
-    // 3. if any of the cacheLines is set to 0 or cacheLineSize is less than 1 byte
-    // 4. Cycles to simulate is less than 0
-
-    if (l1CacheLines > l2CacheLines) {
-        fprintf(stderr, "Invalid input: L1 cache lines count is greater than L2 cache lines count\n");
-        exit(EXIT_FAILURE);
-    }
-
-    if (l1CacheLatency > l2CacheLatency || l2CacheLatency > memoryLatency) {
-        fprintf(stderr, "Invalid input: L1 latency is greater than L2 latency or L2 latency is greater than memory latency\n");
-        exit(EXIT_FAILURE);
-    }
-
-    if (l1CacheLines == 0 || l2CacheLines == 0 || cacheLineSize == 0) {
-        fprintf(stderr, "Invalid input: L1 cache lines, L2 cache lines or cache line size is set to 0\n");
-        exit(EXIT_FAILURE);
-    }
-
-    if (cycles < 0) {
-        fprintf(stderr, "Invalid input: Cycles to simulate is less than 0\n");
-        exit(EXIT_FAILURE);
-    }
-
-    // ========================================================================================
-
     Config* config = (Config*) malloc(sizeof(Config));
 
     // Check if memory allocation is successful
@@ -358,15 +618,61 @@ Config* parse_user_input(int argc, char* argv[]) {
     config->l1CacheLatency = l1CacheLatency;
     config->l2CacheLatency = l2CacheLatency;
     config->memoryLatency = memoryLatency;
+    config->l1Ways = l1Ways; // Set-associative L1
+    config->l2Ways = l2Ways; // Set-associative L2
+    config->replacement = replacement; // Replacement policy
+    config->writePolicy = writePolicy; // Write-through or write-back
     config->numRequests = numRequests;
     config->tracefile = tracefile;
     config->input_filename = input_filename;
     config->requests = NULL;
     config->customNumRequest = customNumRequest;
+    config->convert_filename = convert_filename; // Convert to a binary trace
+    config->traceFormat = traceFormat; // Records of the binary trace
+    config->requestsMapping = NULL;
+    config->requestsMappingSize = 0;
+    config->streamingParse = streamingParse || pipelinedParse; // Parse the .csv in batches
+    config->pipelinedParse = pipelinedParse; // Parse the batches on a second thread
+    config->csvStream = NULL;
+    config->timingOnly = timingOnly; // No cache or memory data
     config->prefetchBuffer = prefetchBuffer; // Optimization: Prefetch Buffer
     config->storebackBuffer = storebackBuffer; // Optimization: Storeback Buffer
     config->storebackBufferCondition = storebackBufferCondition; // Optimization: Conditional Storeback Buffer
+    config->storebackCombine = storebackCombine; // Optimization: Write-Combining Storeback Buffer
+    config->storebackFlush = storebackFlush; // Optimization: Selective Flush of the Storeback Buffer
+    config->storebackForward = storebackForward; // Optimization: Store-to-Load Forwarding
+    config->prefetcher = prefetcher; // Optimization: Stride and Stream Prefetchers
+    config->prefetchDegree = (prefetchDegree != 0) ? prefetchDegree : prefetchBuffer; // Optimization: Lines per Prefetch
+    config->prefetchDistance = prefetchDistance; // Optimization: Prefetch Distance
     config->prettyPrint = prettyPrint;
+    config->engine = engine;
+    config->driver = driver;
+
+    // ========================================================================================
+
+    // Invalid cases check - throw error then quit
+    // 1. The configuration itself, the same checks as in libcachesim (see check_config())
+    // 2. Stack-distance engine with a write policy other than write-back
+    // 3. Streaming or pipelined parse of a binary trace or of a .csv that is only converted
+
+    if (!check_config(config)) {
+        exit(EXIT_FAILURE);
+    }
+
+    // Every line that misses is allocated and nothing is written to memory, only write-back caches do that
+    if (engine == ENGINE_STACK_DISTANCE && customWritePolicy && writePolicy != WRITE_BACK) {
+        fprintf(stderr, "Invalid input: The stack-distance engine only supports write-back caches\n");
+        exit(EXIT_FAILURE);
+    }
+    if (engine == ENGINE_STACK_DISTANCE) {
+        config->writePolicy = WRITE_BACK;
+    }
+
+    // Streaming only makes sense for a .csv that is simulated (binary traces are mapped, conversions need every request)
+    if ((streamingParse || pipelinedParse) && (is_binary_trace(input_filename) || convert_filename != NULL)) {
+        fprintf(stderr, "Invalid input: %s only works when simulating a .csv\n", pipelinedParse ? "pipelined-parse" : "streaming-parse");
+        exit(EXIT_FAILURE);
+    }
 
     return config;
 }
@@ -3,6 +3,12 @@
 #include <systemc>
 #include "simulator.hpp"
 #include "../modules/modules.hpp"
+#include "../modules/functional.hpp"
+#include "../modules/stack_distance.hpp"
+#include "../modules/lockstep.hpp"
+#include "../modules/l1_miss_stream.hpp"
+#include "../modules/outcome_trace.hpp"
+#include "../modules/send_requests.hpp"
 
 // prevent the C++ compiler from mangling the function name
 extern "C" {
@@ -20,29 +26,6 @@ extern "C" {
         config = c;
     }
     
-    /**
-     * @brief updates the CacheStats
-     * @note ignores `primitiveGateCount`
-     * @author Lie Leon Alexius
-     */
-    void statsUpdater(CacheStats* cacheStats, CacheStats tempStats) {
-        cacheStats->cycles += tempStats.cycles;
-        cacheStats->misses += tempStats.misses;
-        cacheStats->hits += tempStats.hits;
-        cacheStats->read_hits += tempStats.read_hits;
-        cacheStats->read_misses += tempStats.read_misses;
-        cacheStats->write_hits += tempStats.write_hits;
-        cacheStats->write_misses += tempStats.write_misses;
-        cacheStats->read_hits_L1 += tempStats.read_hits_L1;
-        cacheStats->read_misses_L1 += tempStats.read_misses_L1;
-        cacheStats->write_hits_L1 += tempStats.write_hits_L1;
-        cacheStats->write_misses_L1 += tempStats.write_misses_L1;
-        cacheStats->read_hits_L2 += tempStats.read_hits_L2;
-        cacheStats->read_misses_L2 += tempStats.read_misses_L2;
-        cacheStats->write_hits_L2 += tempStats.write_hits_L2;
-        cacheStats->write_misses_L2 += tempStats.write_misses_L2;
-    }
-
     /**
      * @brief This function checks the inputs for the simulation
      * @note 
@@ -100,6 +83,76 @@ extern "C" {
         }
     }
 
+}
+
+/**
+ * @brief Parses the next batch of the streaming mode, quits if a row is invalid
+ * @return the number of requests in `stream->batch` (0 at the end)
+ */
+size_t next_batch(CsvStream* stream) {
+    long count = csv_stream_next(stream);
+    if (count == -1) {
+        fprintf(stderr, "Error when parsing CSV\n");
+        exit(EXIT_FAILURE);
+    }
+    return (size_t) count;
+}
+
+/**
+ * @brief Runs every request and waits for the memory, with the cycle limit shared by all engines
+ * 
+ * @details
+ * In the streaming mode (`config->csvStream`), the requests are parsed and sent batch by batch,
+ * the engine keeps its state from one batch to the next.
+ * 
+ * @param caches The engine that simulates the memory hierarchy (needs `finish_memory()` as well).
+ * @param cycles The number of cycles for the simulation.
+ * @param numRequests The number of requests.
+ * @param requests A pointer to the array of Request structures.
+ * @param cacheStats The CacheStats to be updated.
+ */
+template <typename Caches>
+void process_requests(Caches& caches, int cycles, size_t numRequests, struct Request* requests, CacheStats* cacheStats) {
+    // Cycle Limit Counter
+    int original_cycles = cycles;
+
+    // Flag: true if the simulator stopped due to exceeding the cycle limit
+    bool simulatorForceTerminate = false;
+
+    if (config != NULL && config->csvStream != NULL) {
+        size_t count;
+        while (!simulatorForceTerminate && (count = next_batch(config->csvStream)) > 0) {
+            simulatorForceTerminate = !send_requests(caches, count, config->csvStream->batch, original_cycles, cacheStats);
+        }
+    }
+    else {
+        simulatorForceTerminate = !send_requests(caches, numRequests, requests, original_cycles, cacheStats);
+    }
+
+    finish_requests(caches, simulatorForceTerminate, original_cycles, cacheStats);
+}
+
+/**
+ * @brief Ends the streaming mode: the rest of the .csv is still parsed, so that the number of requests
+ * and the errors are the same as without streaming
+ */
+void finish_stream() {
+    while (next_batch(config->csvStream) > 0) {}
+
+    size_t parsed = config->csvStream->parsed;
+    csv_stream_close(config->csvStream);
+    config->csvStream = NULL;
+
+    // check if numRequests has been fulfilled
+    if (config->customNumRequest && parsed != config->numRequests) {
+        fprintf(stderr, "Error: number of requests parsed does not match numRequests\n");
+        fprintf(stderr, "Error when parsing CSV\n");
+        exit(EXIT_FAILURE);
+    }
+    config->numRequests = parsed;
+}
+
+extern "C" {
     /**
      * @brief Runs the cache simulation
      * 
@@ -136,25 +189,6 @@ extern "C" {
             );
         }
         
-        // Get the config if any (Optimization flags)
-        unsigned int prefetchBuffer = 0; 
-        unsigned int storebackBuffer = 0; 
-        bool storebackBufferCondition= false;
-
-        if (config != NULL) {
-            prefetchBuffer = config->prefetchBuffer;
-            storebackBuffer = config->storebackBuffer;
-            storebackBufferCondition = config->storebackBufferCondition;
-        }
-
-        // Initialize the cache simulator       
-        CPU_L1_L2 caches(
-            l1CacheLines, l2CacheLines, cacheLineSize, 
-            l1CacheLatency, l2CacheLatency, memoryLatency, 
-            tracefile, 
-            prefetchBuffer, storebackBuffer, storebackBufferCondition
-        );
-
         // Initialize the cacheStats
         CacheStats* cacheStats = (CacheStats*) malloc(sizeof(CacheStats));
         cacheStats->cycles = 0;
@@ -174,57 +208,141 @@ extern "C" {
         cacheStats->write_hits_L2 = 0;
         cacheStats->write_misses_L2 = 0;
         cacheStats->currentMemoryCycles = 0;
+        cacheStats->memoryPages = 0;
+        cacheStats->writebacks_L1 = 0;
+        cacheStats->writebacks_L2 = 0;
+        cacheStats->combinedWrites = 0;
+        cacheStats->flushStalls = 0;
+        cacheStats->abortedWrites = 0;
+        cacheStats->abortedCycles = 0;
+        cacheStats->forwardedLoads = 0;
+        cacheStats->bufferLoads = 0;
+        cacheStats->prefetches = 0;
+        cacheStats->latePrefetches = 0;
+        cacheStats->cancelledPrefetches = 0;
+        cacheStats->usefulPrefetches = 0;
 
         // ========================================================================================
 
-        // Cycle Limit Counter
-        int original_cycles = cycles;
-
-        // Flag: true if the simulator stopped due to exceeding the cycle limit
-        bool simulatorForceTerminate = false;
+        if (config != NULL && config->engine == ENGINE_FUNCTIONAL) {
+            // Untimed engine, no SystemC involved
+            FUNCTIONAL_L1_L2 caches(
+                l1CacheLines, l2CacheLines, cacheLineSize, 
+                l1CacheLatency, l2CacheLatency, memoryLatency,
+                config->l1Ways, config->l2Ways, config->replacement,
+                config->writePolicy == WRITE_BACK
+            );
 
-        // Process the request
-        for (size_t i = 0; i < numRequests; i++) {
-            struct Request req = requests[i];
+            process_requests(caches, cycles, numRequests, requests, cacheStats);
 
-            // If req.we == -1, end simulation
-            if (req.we == -1) {
-                break;
-            }
-            
-            // Send request to cache
-            CacheStats tempResult = caches.send_request(req, original_cycles);
-
-            // break if cycles already exceeded the limit
-            if (original_cycles < 0) {
-                simulatorForceTerminate = true;
-                break;
-            }
+            // Get gateCount
+            cacheStats->primitiveGateCount = caches.get_gate_count();
 
-            // update the cacheStats
-            statsUpdater(cacheStats, tempResult);
+            // Get the dirty lines that have been written back
+            cacheStats->writebacks_L1 = caches.writebacks_L1;
+            cacheStats->writebacks_L2 = caches.writebacks_L2;
         }
-
-        // Finish up the simulation (wait for memory write) if the simulator is not forced to terminate
-        if (!simulatorForceTerminate) {
-            unsigned int memory_cycles = caches.finish_memory(original_cycles);
-            if (original_cycles < 0) {
-                cacheStats->cycles = SIZE_MAX; 
+        else if (config != NULL && config->engine == ENGINE_STACK_DISTANCE) {
+            // One pass for every cache size, only L1 is simulated and nothing is timed
+            STACK_DISTANCE_ENGINE caches(l1CacheLines, cacheLineSize, config->l1Ways);
+            if (config->csvStream != NULL) {
+                size_t count;
+                while ((count = next_batch(config->csvStream)) > 0) {
+                    caches.run(count, config->csvStream->batch, cacheStats);
+                }
             }
             else {
-                cacheStats->cycles += memory_cycles;
+                caches.run(numRequests, requests, cacheStats);
             }
+
+            // Same hardware as the functional engine with write-back caches
+            cacheStats->primitiveGateCount = gate_count(
+                l1CacheLines, l2CacheLines, cacheLineSize, 0, 0,
+                config->l1Ways, config->l2Ways, config->replacement, true
+            );
+
+            vector<MissRatioPoint> points = caches.points();
+            print_miss_ratio_curves(config, points.data(), points.size());
         }
         else {
-            // if forced to stop, cycles need to be SIZE_MAX
-            cacheStats->cycles = SIZE_MAX;
-        }
+            // Get the config if any (Optimization flags)
+            unsigned int prefetchBuffer = 0; 
+            unsigned int storebackBuffer = 0; 
+            bool storebackBufferCondition= false;
+            bool eventDriven = true;
+            bool streaming = false;
+            unsigned int l1Ways = 1;
+            unsigned int l2Ways = 1;
+            Replacement replacement = REPLACEMENT_LRU;
+            bool writeBack = false;
+            bool timingOnly = false;
+            bool storebackCombine = false;
+            bool selectiveFlush = false;
+            bool storebackForward = false;
+            Prefetcher prefetcher = PREFETCHER_NEXTLINE;
+            unsigned int prefetchDegree = 0;
+            unsigned int prefetchDistance = 1;
+
+            if (config != NULL) {
+                prefetchBuffer = config->prefetchBuffer;
+                storebackBuffer = config->storebackBuffer;
+                storebackBufferCondition = config->storebackBufferCondition;
+                eventDriven = (config->driver != DRIVER_STEP);
+                streaming = (config->driver == DRIVER_STREAM);
+                l1Ways = config->l1Ways;
+                l2Ways = config->l2Ways;
+                replacement = config->replacement;
+                writeBack = (config->writePolicy == WRITE_BACK);
+                timingOnly = config->timingOnly;
+                storebackCombine = config->storebackCombine;
+                selectiveFlush = (config->storebackFlush == STOREBACK_FLUSH_LINE);
+                storebackForward = config->storebackForward;
+                prefetcher = config->prefetcher;
+                prefetchDegree = config->prefetchDegree;
+                prefetchDistance = config->prefetchDistance;
+            }
+
+            // Initialize the cache simulator       
+            CPU_L1_L2 caches(
+                l1CacheLines, l2CacheLines, cacheLineSize, 
+                l1CacheLatency, l2CacheLatency, memoryLatency, 
+                tracefile, 
+                prefetchBuffer, storebackBuffer, storebackBufferCondition,
+                eventDriven, streaming,
+                l1Ways, l2Ways, replacement, writeBack, timingOnly, storebackCombine, selectiveFlush, storebackForward,
+                prefetcher, prefetchDegree, prefetchDistance
+            );
+
+            process_requests(caches, cycles, numRequests, requests, cacheStats);
+
+            // Get gateCount
+            cacheStats->primitiveGateCount = caches.get_gate_count();
+
+            // Get the amount of main memory that has been allocated
+            cacheStats->memoryPages = caches.memory->memory_blocks.materialized_pages();
+
+            // Get the dirty lines that have been written back
+            cacheStats->writebacks_L1 = caches.l1->writebacks;
+            cacheStats->writebacks_L2 = caches.l2->writebacks;
+            cacheStats->combinedWrites = caches.combined_writes();
+            cacheStats->flushStalls = caches.l2->flush_stalls;
+            cacheStats->abortedWrites = caches.memory->aborted_writes;
+            cacheStats->abortedCycles = caches.memory->aborted_cycles;
+            cacheStats->forwardedLoads = caches.l2->forwarded_loads;
+            cacheStats->bufferLoads = caches.l2->buffer_loads;
+            cacheStats->prefetches = caches.l2->prefetches;
+            cacheStats->latePrefetches = caches.l2->late_prefetches;
+            cacheStats->cancelledPrefetches = (caches.prefetch != nullptr) ? caches.prefetch->cancelled : 0;
+            cacheStats->usefulPrefetches = caches.l2->useful_prefetches;
 
-        // Get gateCount
-        cacheStats->primitiveGateCount = caches.get_gate_count();
+            // stop the simulation and close the trace file
+            (tracefile != NULL) ? caches.close_trace_file() : caches.stop_simulation();
+        }
 
-        // stop the simulation and close the trace file
-        (tracefile != NULL) ? caches.close_trace_file() : caches.stop_simulation();
+        // Streaming mode: parse the rest of the .csv and close it
+        if (config != NULL && config->csvStream != NULL) {
+            finish_stream();
+        }
 
         // ========================================================================================
 
@@ -254,15 +372,35 @@ extern "C" {
             config->l1CacheLatency = l1CacheLatency;
             config->l2CacheLatency = l2CacheLatency;
             config->memoryLatency = memoryLatency;
+            config->l1Ways = 1;
+            config->l2Ways = 1;
+            config->replacement = REPLACEMENT_LRU;
+            config->writePolicy = WRITE_THROUGH;
             config->numRequests = numRequests;
             config->tracefile = NULL;
             config->input_filename = NULL;
             config->requests = NULL;
             config->customNumRequest = true;
+            config->convert_filename = NULL;
+            config->traceFormat = TRACE_FORMAT_RAW;
+            config->requestsMapping = NULL;
+            config->requestsMappingSize = 0;
+            config->streamingParse = false;
+            config->pipelinedParse = false;
+            config->csvStream = NULL;
+            config->timingOnly = false;
             config->prefetchBuffer = 0;
             config->storebackBuffer = 0;
             config->storebackBufferCondition = false;
+            config->storebackCombine = false;
+            config->storebackFlush = STOREBACK_FLUSH_ALL;
+            config->storebackForward = false;
+            config->prefetcher = PREFETCHER_NEXTLINE;
+            config->prefetchDegree = 0;
+            config->prefetchDistance = 1;
             config->prettyPrint = true;
+            config->engine = ENGINE_SYSTEMC;
+            config->driver = DRIVER_EVENT;
 
             // print the layout
             print_layout(config, cacheStats);
@@ -272,9 +410,8 @@ extern "C" {
             // print the layout
             print_layout(config, cacheStats);
 
-            // Extra cleanup
-            free(config->requests);
-            config->requests = NULL;
+            // Extra cleanup (the requests may be a mapped binary trace)
+            free_requests(config);
         }
 
         // Cleanup Standard
@@ -286,6 +423,138 @@ extern "C" {
         instant:        
         return result; // return the result
     }
+
+    /**
+     * @brief Simulates several configurations of the functional engine in a single pass over the requests
+     *
+     * @details
+     * The configurations must be direct-mapped and write-through (see LOCKSTEP_L1_L2), the results are the
+     * same as run_simulation() with `--engine=functional` for each of them. Nothing is printed.
+     *
+     * @param configs The configurations (only the cache lines, line size, latencies and cycles are used).
+     * @param numConfigs The number of configurations.
+     * @param numRequests The number of requests.
+     * @param requests A pointer to the array of Request structures.
+     * @param cacheStats The CacheStats of every configuration (numConfigs entries).
+     */
+    void run_lockstep_simulation(const Config* configs, size_t numConfigs, size_t numRequests, struct Request* requests,
+        CacheStats* cacheStats)
+    {
+        vector<unsigned> l1CacheLines(numConfigs), l2CacheLines(numConfigs), cacheLineSize(numConfigs);
+        vector<unsigned> l1CacheLatency(numConfigs), l2CacheLatency(numConfigs), memoryLatency(numConfigs);
+        for (size_t k = 0; k < numConfigs; k++) {
+            l1CacheLines[k] = configs[k].l1CacheLines;
+            l2CacheLines[k] = configs[k].l2CacheLines;
+            cacheLineSize[k] = configs[k].cacheLineSize;
+            l1CacheLatency[k] = configs[k].l1CacheLatency;
+            l2CacheLatency[k] = configs[k].l2CacheLatency;
+            memoryLatency[k] = configs[k].memoryLatency;
+        }
+
+        // the cycle limit is the same for every configuration of a sweep
+        int cycles = (numConfigs > 0) ? configs[0].cycles : 0;
+        LOCKSTEP_L1_L2 caches(
+            numConfigs, l1CacheLines.data(), l2CacheLines.data(), cacheLineSize.data(),
+            l1CacheLatency.data(), l2CacheLatency.data(), memoryLatency.data(), cycles
+        );
+        caches.run(numRequests, requests);
+
+        for (size_t k = 0; k < numConfigs; k++) {
+            cacheStats[k] = caches.cache_stats(k);
+            cacheStats[k].primitiveGateCount = gate_count(
+                l1CacheLines[k], l2CacheLines[k], cacheLineSize[k], 0, 0,
+                1, 1, configs[k].replacement, false
+            );
+        }
+    }
+
+    /**
+     * @brief Simulates several configurations of the functional engine that share the same L1
+     *
+     * @details
+     * The requests that reach L2 are recorded once (L1_MISS_STREAM), then only L2 is simulated for every
+     * configuration (L2_REPLAY). The configurations must be write-through and have the same cache line size,
+     * L1 lines, ways and replacement. The results are the same as run_simulation() with `--engine=functional`
+     * for each of them. Nothing is printed.
+     *
+     * @param configs The configurations.
+     * @param numConfigs The number of configurations.
+     * @param numRequests The number of requests.
+     * @param requests A pointer to the array of Request structures.
+     * @param cacheStats The CacheStats of every configuration (numConfigs entries).
+     */
+    void run_l1_filtered_simulation(const Config* configs, size_t numConfigs, size_t numRequests, struct Request* requests,
+        CacheStats* cacheStats)
+    {
+        if (numConfigs == 0) return;
+
+        L1_MISS_STREAM stream(
+            configs[0].l1CacheLines, configs[0].cacheLineSize, configs[0].l1Ways, configs[0].replacement,
+            numRequests, requests
+        );
+
+        for (size_t k = 0; k < numConfigs; k++) {
+            L2_REPLAY l2(
+                configs[k].l2CacheLines, configs[k].cacheLineSize,
+                configs[k].l1CacheLatency, configs[k].l2CacheLatency, configs[k].memoryLatency,
+                configs[k].l2Ways, configs[k].replacement
+            );
+
+            cacheStats[k] = {};
+            l2.run(stream, configs[k].cycles, &cacheStats[k]);
+            cacheStats[k].primitiveGateCount = gate_count(
+                configs[k].l1CacheLines, configs[k].l2CacheLines, configs[k].cacheLineSize, 0, 0,
+                configs[k].l1Ways, configs[k].l2Ways, configs[k].replacement, false
+            );
+        }
+    }
+
+    /**
+     * @brief Simulates several configurations of the functional engine that only differ in their latencies
+     *
+     * @details
+     * The outcome of every request is recorded once (OUTCOME_TRACE) and re-timed for the latencies of every
+     * configuration. The configurations must have the same cache line size, lines, ways, replacement and
+     * write policy. The results are the same as run_simulation() with `--engine=functional` for each of them.
+     * Nothing is printed.
+     *
+     * @param configs The configurations.
+     * @param numConfigs The number of configurations.
+     * @param numRequests The number of requests.
+     * @param requests A pointer to the array of Request structures.
+     * @param cacheStats The CacheStats of every configuration (numConfigs entries).
+     */
+    void run_retimed_simulation(const Config* configs, size_t numConfigs, size_t numRequests, struct Request* requests,
+        CacheStats* cacheStats)
+    {
+        if (numConfigs == 0) return;
+
+        const Config* geometry = &configs[0];
+        bool writeBack = geometry->writePolicy == WRITE_BACK;
+        OUTCOME_TRACE trace(
+            geometry->l1CacheLines, geometry->l2CacheLines, geometry->cacheLineSize,
+            geometry->l1Ways, geometry->l2Ways, geometry->replacement, writeBack,
+            numRequests, requests
+        );
+
+        vector<unsigned> l1CacheLatency(numConfigs), l2CacheLatency(numConfigs), memoryLatency(numConfigs);
+        for (size_t k = 0; k < numConfigs; k++) {
+            l1CacheLatency[k] = configs[k].l1CacheLatency;
+            l2CacheLatency[k] = configs[k].l2CacheLatency;
+            memoryLatency[k] = configs[k].memoryLatency;
+        }
+
+        // the cycle limit is the same for every configuration of a sweep
+        trace.retime(numConfigs, l1CacheLatency.data(), l2CacheLatency.data(), memoryLatency.data(), geometry->cycles, cacheStats);
+
+        size_t gates = gate_count(
+            geometry->l1CacheLines, geometry->l2CacheLines, geometry->cacheLineSize, 0, 0,
+            geometry->l1Ways, geometry->l2Ways, geometry->replacement, writeBack
+        );
+        for (size_t k = 0; k < numConfigs; k++) {
+            cacheStats[k].primitiveGateCount = gates;
+        }
+    }
 }
 
 /**
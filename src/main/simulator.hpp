@@ -18,6 +18,27 @@ struct Request {
     int we; // write enabled 1 or write disabled 0
 };
 
+/**
+ * @brief Replacement policy of the set-associative caches
+ * @note Only used if a cache has more than one way
+ */
+typedef enum {
+    REPLACEMENT_LRU = 0,    // least recently used (default)
+    REPLACEMENT_PLRU,       // tree pseudo-LRU
+    REPLACEMENT_FIFO,       // first in, first out
+    REPLACEMENT_RANDOM      // pseudo-random
+} Replacement;
+
+/**
+ * @brief Which lines memory prefetches after a read miss of L2 (see PREFETCHER)
+ * @note Only used with a prefetch buffer
+ */
+typedef enum {
+    PREFETCHER_NEXTLINE = 0,    // the lines after the missed line (default)
+    PREFETCHER_STRIDE,          // reference prediction table of strides, per region of the address
+    PREFETCHER_STREAM           // runs of lines going up or down, per region of the address
+} Prefetcher;
+
 /**
  * @brief Result contains `cycles`, `misses`, `hits`, `primitiveGateCount`
  * @warning Don't add anything to this struct
@@ -54,6 +75,31 @@ typedef struct {
     size_t write_hits_L2; // 0 or 1 - write hit in L2
     size_t write_misses_L2; // 0 or 1 - write miss in L2
     size_t currentMemoryCycles; // cycles needed to finish currently queued memory writes
+    size_t memoryPages; // 4 KiB pages of the main memory that were materialized (written to)
+    size_t writebacks_L1; // dirty lines written back from L1 to L2 (write-back only)
+    size_t writebacks_L2; // dirty lines written back from L2 to memory (write-back only)
+    size_t combinedWrites; // writes merged into a pending line of the storeback buffer (--storeback-combine)
+    size_t flushStalls; // cycles that read misses of L2 waited for the storeback buffer to be flushed
+    size_t abortedWrites; // storeback writes that memory aborted for a read and had to start again
+    size_t abortedCycles; // latency cycles of the aborted writes that were lost
+    size_t forwardedLoads; // read misses of L2 read from memory with bytes from the storeback buffer (--storeback-forward)
+    size_t bufferLoads; // read misses of L2 taken from the storeback buffer alone, without a memory read
+    size_t prefetches; // lines prefetched from memory into L2 (with a prefetch buffer)
+    size_t latePrefetches; // read misses of L2 that waited for their line to arrive from a prefetch
+    size_t cancelledPrefetches; // prefetches dropped on their way, because their line was written
+    size_t usefulPrefetches; // prefetched lines that a read of L2 hit before they were replaced
 } CacheStats;
 
+/**
+ * @brief One point of the miss-ratio curves of the stack-distance engine
+ * @note The misses of every cache size come from a single pass over the requests (LRU, write-allocate)
+ */
+typedef struct {
+    unsigned lineSize; // cache line size in bytes
+    unsigned cacheLines; // number of cache lines
+    size_t accesses; // requests that went through the cache
+    size_t misses; // misses of a fully-associative LRU cache
+    size_t missesSetAssociative; // misses of an LRU cache with `--l1-ways` lines per set (SIZE_MAX if not possible)
+} MissRatioPoint;
+
 #endif
@@ -0,0 +1,674 @@
+// Parameter sweeps over the simulator (make release builds ./cache-sweep)
+
+// fork(), mmap() with MAP_ANONYMOUS and sysconf() are POSIX/BSD, not C17
+#define _DEFAULT_SOURCE
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "parser/parse.h"
+#include "parser/terminal_parser.h"
+#include "grapher/printer.h"
+#include "simulator.hpp"
+#include "sweep.h"
+
+/**
+ * @brief The set_config method in C++ to set the config in C++ from C
+ */
+extern void set_config(Config* c);
+
+/**
+ * @brief The run_simulation method in C++
+ */
+extern Result run_simulation(
+    int cycles,
+    unsigned l1CacheLines, unsigned l2CacheLines, unsigned cacheLineSize,
+    unsigned l1CacheLatency, unsigned l2CacheLatency, unsigned memoryLatency,
+    size_t numRequests, struct Request* requests,
+    const char* tracefile
+);
+
+/**
+ * @brief The run_lockstep_simulation method in C++
+ */
+extern void run_lockstep_simulation(const Config* configs, size_t numConfigs, size_t numRequests, struct Request* requests,
+    CacheStats* cacheStats);
+
+/**
+ * @brief The run_l1_filtered_simulation method in C++
+ */
+extern void run_l1_filtered_simulation(const Config* configs, size_t numConfigs, size_t numRequests, struct Request* requests,
+    CacheStats* cacheStats);
+
+/**
+ * @brief The run_retimed_simulation method in C++
+ */
+extern void run_retimed_simulation(const Config* configs, size_t numConfigs, size_t numRequests, struct Request* requests,
+    CacheStats* cacheStats);
+
+/**
+ * @brief The options that can be swept and their defaults in ./cache (same order as the table)
+ */
+static const struct {
+    const char* option;
+    const char* title;
+    const char* defaultValue;
+} SWEEP_OPTIONS[SWEEP_PARAMETERS] = {
+    {"cacheline-size", "Cache Line Size", "64"},
+    {"l1-lines", "L1 Lines", "64"},
+    {"l2-lines", "L2 Lines", "256"},
+    {"l1-latency", "L1 Latency", "4"},
+    {"l2-latency", "L2 Latency", "12"},
+    {"memory-latency", "Memory Latency", "100"},
+    {"prefetch-buffer", "Prefetch Buffer", "0"},
+    {"storeback-buffer", "Storeback Buffer", "0"},
+    {"storeback-condition", "Storeback Condition", "false"},
+};
+
+/**
+ * @brief State shared by the parent, the workers and the simulations
+ */
+typedef struct {
+    atomic_size_t next; // next chunk of configurations to simulate
+    SweepResult results[]; // one per configuration
+} SweepShared;
+
+/**
+ * @brief Everything a worker needs to simulate a configuration
+ */
+typedef struct {
+    int argc; // options of ./cache that are not swept, without the filename
+    char** argv;
+    const char* input_filename;
+    struct Request* requests; // shared read-only requests
+    size_t numRequests;
+    size_t requestsSize; // size of the requests mapping in bytes
+    SweepShared* shared;
+    size_t numConfigs;
+    bool lockstep; // simulate the configurations of a worker together (functional engine only)
+    bool l1Filter; // simulate L1 once and replay its misses for every L2 (functional engine only)
+    bool retime; // record the outcomes once and re-time them for every latency (functional engine only)
+    size_t block; // consecutive configurations with the same caches (retime) or L1 (L1 filter), a chunk stays in one
+    size_t chunk; // configurations a worker takes at once in the retime, lockstep and L1 filter modes
+} Sweep;
+
+/**
+ * @brief Method for -h or --help
+ */
+static void print_sweep_help() {
+    printf("Usage: ./cache-sweep [OPTIONS] path/to/file/filename.csv\n");
+    printf("Simulates every combination of the swept options, each one in its own process.\n");
+    printf("Swept options take a list of values and ranges, e.g. --l1-lines 16,32:256:x2 --l1-latency 1:4\n");
+    printf("  <first>:<last>                    Every value from first to last\n");
+    printf("  <first>:<last>:<step>             Every step-th value from first to last\n");
+    printf("  <first>:<last>:x<factor>          first, first * factor, ... up to last\n");
+    printf("Swept options:\n");
+    for (size_t p = 0; p < SWEEP_PARAMETERS; p++) {
+        printf("      --%-30s(default: %s)\n", SWEEP_OPTIONS[p].option, SWEEP_OPTIONS[p].defaultValue);
+    }
+    printf("Options:\n");
+    printf("  -j, --jobs <num>                  The number of workers (default: number of online CPUs)\n");
+    printf("      --lockstep <bool>             With --engine=functional, direct-mapped and write-through caches,\n");
+    printf("                                    simulate up to %d configurations in one pass (default: true)\n", SWEEP_CHUNK_CONFIGS);
+    printf("      --l1-filter <bool>            With --engine=functional and write-through caches (without lockstep),\n");
+    printf("                                    simulate L1 once per line size and L1 lines and replay only the\n");
+    printf("                                    requests that reach L2 for the other options (default: true)\n");
+    printf("      --retime <bool>               With --engine=functional, simulate the caches once per line size,\n");
+    printf("                                    L1 lines and L2 lines and re-time the outcomes of the requests for\n");
+    printf("                                    every latency (default: true)\n");
+    printf("  -h, --help                        Display this help and exit\n");
+    printf("The other options of ./cache are the same for every configuration, except --tf, --convert,\n");
+    printf("--streaming-parse and --pipelined-parse. The first configuration is checked before the sweep starts.\n");
+    printf("The SystemC engine runs with --timing-only true unless the option is given.\n");
+}
+
+/**
+ * @brief Parses an unsigned number that fills the whole string
+ * @return 0 if successful, -1 if not a number
+ */
+static int parse_unsigned(const char* str, unsigned long* value) {
+    char* end;
+    errno = 0;
+    *value = strtoul(str, &end, 10);
+    return (end == str || *end != '\0' || errno != 0 || str[0] == '-' || *value > UINT_MAX) ? -1 : 0;
+}
+
+/**
+ * @brief Appends a value to a swept option
+ * @return 0 if successful, -1 if there are too many values
+ */
+static int add_value(SweepParameter* parameter, const char* value) {
+    if (parameter->count == SWEEP_MAX_VALUES) {
+        fprintf(stderr, "Invalid input: --%s has more than %d values\n", parameter->option, SWEEP_MAX_VALUES);
+        return -1;
+    }
+    parameter->values[parameter->count++] = value;
+    return 0;
+}
+
+/**
+ * @brief Expands `first:last[:step]` or `first:last:x<factor>` into the values of a swept option
+ * @return 0 if successful, -1 if the range is invalid
+ */
+static int add_range(SweepParameter* parameter, char* range) {
+    char* first = range;
+    char* last = strchr(first, ':');
+    *last++ = '\0';
+    char* step = strchr(last, ':');
+    if (step != NULL) {
+        *step++ = '\0';
+    }
+
+    bool multiply = step != NULL && step[0] == 'x';
+    unsigned long from, to, by = 1;
+    if (parse_unsigned(first, &from) == -1 || parse_unsigned(last, &to) == -1 || from > to
+        || (step != NULL && parse_unsigned(step + multiply, &by) == -1) || by < (multiply ? 2 : 1)
+        || (multiply && from == 0)) {
+        fprintf(stderr, "Invalid input: Invalid range for --%s\n", parameter->option);
+        return -1;
+    }
+
+    for (unsigned long value = from; value <= to; value = multiply ? value * by : value + by) {
+        char* str = malloc(12);
+        if (str == NULL) {
+            fprintf(stderr, "Error when allocating the sweep\n");
+            return -1;
+        }
+        snprintf(str, 12, "%lu", value);
+        if (add_value(parameter, str) == -1) {
+            return -1;
+        }
+        // value + by or value * by would overflow (the values fit in unsigned int)
+        if (to - value < (multiply ? value * by - value : by)) {
+            break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Parses the comma-separated values and ranges of a swept option
+ * @return 0 if successful, -1 if invalid
+ */
+static int parse_values(SweepParameter* parameter, const char* value) {
+    // the values point into the copy, strtok() cuts it into pieces
+    char* list = strdup(value);
+    if (list == NULL) {
+        fprintf(stderr, "Error when allocating the sweep\n");
+        return -1;
+    }
+
+    parameter->count = 0;
+    for (char* item = strtok(list, ","); item != NULL; item = strtok(NULL, ",")) {
+        int status = (strchr(item, ':') != NULL) ? add_range(parameter, item) : add_value(parameter, item);
+        if (status == -1) {
+            return -1;
+        }
+    }
+    if (parameter->count == 0) {
+        fprintf(stderr, "Invalid input: --%s has no values\n", parameter->option);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief true if the argument is `--option` or `--option=value`
+ */
+static bool is_option(const char* arg, const char* option) {
+    size_t len = strlen(option);
+    return strncmp(arg, "--", 2) == 0 && strncmp(arg + 2, option, len) == 0 && (arg[len + 2] == '\0' || arg[len + 2] == '=');
+}
+
+/**
+ * @brief Returns the swept option of the argument, NULL if the option is not swept
+ */
+static SweepParameter* find_parameter(SweepParameter* parameters, const char* arg) {
+    for (size_t p = 0; p < SWEEP_PARAMETERS; p++) {
+        if (is_option(arg, parameters[p].option)) {
+            return &parameters[p];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Splits the arguments into the swept options, the number of workers and the options of ./cache
+ *
+ * @details
+ * The options that are not swept are collected in `sweep->argv` (after argv[0]) and passed on unchanged.
+ * Every option of ./cache takes a value, either as `--option=value` or as the next argument.
+ *
+ * @note Exits the program if the arguments are invalid
+ */
+static void parse_sweep_input(int argc, char* argv[], Sweep* sweep, SweepParameter* parameters, unsigned* jobs) {
+    sweep->argv = malloc((argc + 1) * sizeof(char*));
+    if (sweep->argv == NULL) {
+        fprintf(stderr, "Error when allocating the sweep\n");
+        exit(EXIT_FAILURE);
+    }
+    sweep->argv[0] = argv[0];
+    sweep->argc = 1;
+    sweep->input_filename = NULL;
+    sweep->lockstep = true;
+    sweep->l1Filter = true;
+    sweep->retime = true;
+
+    for (int i = 1; i < argc; i++) {
+        char* arg = argv[i];
+        if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+            print_sweep_help();
+            exit(EXIT_SUCCESS);
+        }
+
+        // positional argument: the filename
+        if (arg[0] != '-') {
+            if (sweep->input_filename != NULL) {
+                fprintf(stderr, "Invalid input: %s is not allowed here!\n", arg);
+                exit(EXIT_FAILURE);
+            }
+            sweep->input_filename = arg;
+            continue;
+        }
+
+        // the value is either after '=' (long options), attached (short options) or the next argument
+        char* value = NULL;
+        bool attached = (arg[1] == '-') ? strchr(arg, '=') != NULL : arg[2] != '\0';
+        if (attached) {
+            value = (arg[1] == '-') ? strchr(arg, '=') + 1 : arg + 2;
+        }
+        else if (i + 1 < argc) {
+            value = argv[++i];
+        }
+        else {
+            fprintf(stderr, "Invalid input: %s needs a value\n", arg);
+            exit(EXIT_FAILURE);
+        }
+
+        SweepParameter* parameter = find_parameter(parameters, arg);
+        if (parameter != NULL) {
+            if (parse_values(parameter, value) == -1) {
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (strncmp(arg, "-j", 2) == 0 || is_option(arg, "jobs")) {
+            unsigned long number;
+            if (parse_unsigned(value, &number) == -1 || number == 0) {
+                fprintf(stderr, "Invalid input for jobs\n");
+                exit(EXIT_FAILURE);
+            }
+            *jobs = (unsigned) number;
+        }
+        else if (is_option(arg, "lockstep") || is_option(arg, "l1-filter") || is_option(arg, "retime")) {
+            const char* name = is_option(arg, "lockstep") ? "lockstep" : is_option(arg, "l1-filter") ? "l1-filter" : "retime";
+            bool* flag = is_option(arg, "lockstep") ? &sweep->lockstep
+                : is_option(arg, "l1-filter") ? &sweep->l1Filter : &sweep->retime;
+            if (strcmp("true", value) == 0) {
+                *flag = true;
+            }
+            else if (strcmp("false", value) == 0) {
+                *flag = false;
+            }
+            else {
+                fprintf(stderr, "Invalid input for %s\n", name);
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (is_option(arg, "tf") || is_option(arg, "convert") || is_option(arg, "streaming-parse")
+            || is_option(arg, "pipelined-parse")) {
+            fprintf(stderr, "Invalid input: %s does not work with cache-sweep\n", arg);
+            exit(EXIT_FAILURE);
+        }
+        else {
+            sweep->argv[sweep->argc++] = arg;
+            if (!attached) {
+                sweep->argv[sweep->argc++] = value;
+            }
+        }
+    }
+
+    if (sweep->input_filename == NULL) {
+        fprintf(stderr, "Invalid input: Filename is missing\n");
+        print_sweep_help();
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief Parses the options of ./cache for a configuration (same as `./cache [OPTIONS] filename`)
+ * @note Exits the process if ./cache rejects the configuration
+ */
+static Config* parse_configuration(Sweep* sweep, const char* const* values) {
+    // argv[0], --timing-only, the options that are not swept, one per swept option, the filename and NULL
+    char* argv[sweep->argc + SWEEP_PARAMETERS + 3];
+    char options[SWEEP_PARAMETERS][64];
+    int argc = 0;
+    argv[argc++] = sweep->argv[0];
+
+    // the table only has cycles, hits, misses and gates, a --timing-only of the user comes later and wins
+    argv[argc++] = "--timing-only=true";
+    for (int i = 1; i < sweep->argc; i++) {
+        argv[argc++] = sweep->argv[i];
+    }
+    for (size_t p = 0; p < SWEEP_PARAMETERS; p++) {
+        snprintf(options[p], sizeof(options[p]), "--%s=%s", SWEEP_OPTIONS[p].option, values[p]);
+        argv[argc++] = options[p];
+    }
+    argv[argc++] = (char*) sweep->input_filename;
+    argv[argc] = NULL;
+
+    // getopt_long() starts over
+    optind = 1;
+    return parse_user_input(argc, argv);
+}
+
+/**
+ * @brief Loads the requests once and moves them into a read-only mapping that every process shares
+ * @note Exits the program if the requests cannot be loaded
+ */
+static void share_requests(Config* config, Sweep* sweep) {
+    load_requests(config);
+
+    sweep->numRequests = config->numRequests;
+    sweep->requestsSize = (config->numRequests + 1) * sizeof(struct Request);
+    sweep->requests = mmap(NULL, sweep->requestsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (sweep->requests == MAP_FAILED) {
+        fprintf(stderr, "Error when mapping the requests\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // mapped binary traces have no .we = -1 marker
+    memcpy(sweep->requests, config->requests, config->numRequests * sizeof(struct Request));
+    sweep->requests[config->numRequests].we = -1;
+    free_requests(config);
+
+    // the simulations only read the requests
+    mprotect(sweep->requests, sweep->requestsSize, PROT_READ);
+}
+
+/**
+ * @brief Simulates a configuration in this process and stores the result (never returns)
+ * @details The output of the simulation is discarded, stderr goes to the pipe of the worker.
+ * Without `simulate`, only the options are checked and the parsed Config is stored.
+ */
+static void run_configuration(Sweep* sweep, SweepResult* slot, int errorPipe, bool simulate) {
+    int devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDOUT_FILENO);
+    dup2(errorPipe, STDERR_FILENO);
+    close(devnull);
+    close(errorPipe);
+
+    Config* config = parse_configuration(sweep, slot->values);
+    if (!simulate) {
+        slot->config = *config;
+        _exit(EXIT_SUCCESS);
+    }
+
+    // the requests are already loaded, free_requests() unmaps them in this process only
+    config->requests = sweep->requests;
+    config->numRequests = sweep->numRequests;
+    config->requestsMapping = sweep->requests;
+    config->requestsMappingSize = sweep->requestsSize;
+
+    set_config(config);
+    slot->result = run_simulation(
+        config->cycles,
+        config->l1CacheLines, config->l2CacheLines, config->cacheLineSize,
+        config->l1CacheLatency, config->l2CacheLatency, config->memoryLatency,
+        config->numRequests, config->requests,
+        config->tracefile
+    );
+    slot->simulated = true;
+
+    fflush(stdout);
+    _exit(EXIT_SUCCESS);
+}
+
+/**
+ * @brief Runs run_configuration() in a new process and waits for it
+ * @note The SystemC kernel cannot be restarted after sc_stop(), so a process only ever simulates once
+ * @return true if successful, otherwise the error is in the slot
+ */
+static bool run_process(Sweep* sweep, SweepResult* slot, bool simulate) {
+    int errorPipe[2];
+    if (pipe(errorPipe) == -1) {
+        snprintf(slot->error, SWEEP_ERROR_SIZE, "Failed to create a pipe");
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(errorPipe[0]);
+        run_configuration(sweep, slot, errorPipe[1], simulate);
+    }
+    close(errorPipe[1]);
+
+    // keep the first line of stderr, the rest is read so that the simulation does not block
+    char error[SWEEP_ERROR_SIZE];
+    char buffer[512];
+    size_t length = 0;
+    ssize_t bytes;
+    while ((bytes = read(errorPipe[0], buffer, sizeof(buffer))) > 0) {
+        size_t keep = ((size_t) bytes < sizeof(error) - 1 - length) ? (size_t) bytes : sizeof(error) - 1 - length;
+        memcpy(error + length, buffer, keep);
+        length += keep;
+    }
+    close(errorPipe[0]);
+    error[length] = '\0';
+    error[strcspn(error, "\n")] = '\0';
+
+    int status = 0;
+    if (pid == -1) {
+        snprintf(slot->error, SWEEP_ERROR_SIZE, "Failed to start the simulation");
+        return false;
+    }
+    if (waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        slot->simulated = false;
+        if (error[0] != '\0') {
+            snprintf(slot->error, SWEEP_ERROR_SIZE, "%s", error);
+        }
+        else if (WIFSIGNALED(status)) {
+            snprintf(slot->error, SWEEP_ERROR_SIZE, "Simulation killed by signal %d", WTERMSIG(status));
+        }
+        else {
+            snprintf(slot->error, SWEEP_ERROR_SIZE, "Simulation failed");
+        }
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Checks a chunk of configurations and simulates the valid ones together
+ * @details With run_retimed_simulation() in the retime mode, run_l1_filtered_simulation() in the L1 filter mode,
+ * run_lockstep_simulation() otherwise
+ */
+static void run_chunk(Sweep* sweep, size_t first, size_t last) {
+    Config* configs = malloc((last - first) * sizeof(Config));
+    size_t* indices = malloc((last - first) * sizeof(size_t));
+    CacheStats* cacheStats = malloc((last - first) * sizeof(CacheStats));
+    if (configs == NULL || indices == NULL || cacheStats == NULL) {
+        fprintf(stderr, "Error when allocating the sweep\n");
+        _exit(EXIT_FAILURE);
+    }
+    size_t count = 0;
+
+    // ./cache checks the options of every configuration in a short-lived process
+    for (size_t i = first; i < last; i++) {
+        SweepResult* slot = &sweep->shared->results[i];
+        if (run_process(sweep, slot, false)) {
+            configs[count] = slot->config;
+            indices[count++] = i;
+        }
+    }
+
+    if (sweep->retime) {
+        run_retimed_simulation(configs, count, sweep->numRequests, sweep->requests, cacheStats);
+    }
+    else if (sweep->l1Filter) {
+        run_l1_filtered_simulation(configs, count, sweep->numRequests, sweep->requests, cacheStats);
+    }
+    else {
+        run_lockstep_simulation(configs, count, sweep->numRequests, sweep->requests, cacheStats);
+    }
+
+    for (size_t j = 0; j < count; j++) {
+        SweepResult* slot = &sweep->shared->results[indices[j]];
+        slot->result.cycles = cacheStats[j].cycles;
+        slot->result.hits = cacheStats[j].hits;
+        slot->result.misses = cacheStats[j].misses;
+        slot->result.primitiveGateCount = cacheStats[j].primitiveGateCount;
+        slot->simulated = true;
+    }
+    free(configs);
+    free(indices);
+    free(cacheStats);
+}
+
+/**
+ * @brief Takes chunks of configurations until there are none left (never returns)
+ * @details
+ * Each configuration is simulated in a new process. In the retime, lockstep and L1 filter modes, the worker
+ * takes `sweep->chunk` configurations at once and simulates them itself. A chunk never crosses a block.
+ */
+static void run_worker(Sweep* sweep) {
+    size_t chunksPerBlock = (sweep->block + sweep->chunk - 1) / sweep->chunk;
+    size_t numChunks = sweep->numConfigs / sweep->block * chunksPerBlock;
+    size_t task;
+    while ((task = atomic_fetch_add(&sweep->shared->next, 1)) < numChunks) {
+        size_t block = task / chunksPerBlock * sweep->block;
+        size_t first = block + task % chunksPerBlock * sweep->chunk;
+        size_t last = (first + sweep->chunk < block + sweep->block) ? first + sweep->chunk : block + sweep->block;
+
+        if (sweep->retime || sweep->lockstep || sweep->l1Filter) {
+            run_chunk(sweep, first, last);
+        }
+        else {
+            run_process(sweep, &sweep->shared->results[first], true);
+        }
+    }
+    _exit(EXIT_SUCCESS);
+}
+
+/**
+ * @brief Sweeps start here
+ *
+ * @details
+ * 1. The arguments are split into the swept options and the options of ./cache
+ * 2. The first configuration is checked and the requests are loaded once, into shared read-only memory
+ * 3. `--jobs` workers take the configurations one by one from a shared counter
+ * 4. Each configuration is simulated in its own process, which writes its Result into shared memory
+ *    (in the retime, lockstep and L1 filter modes, a worker takes a chunk of configurations and simulates them together)
+ * 5. The parent prints one table of all results (print_sweep_table())
+ */
+int main(int argc, char* argv[]) {
+    SweepParameter parameters[SWEEP_PARAMETERS];
+    for (size_t p = 0; p < SWEEP_PARAMETERS; p++) {
+        parameters[p].option = SWEEP_OPTIONS[p].option;
+        parameters[p].title = SWEEP_OPTIONS[p].title;
+        parameters[p].values = malloc(SWEEP_MAX_VALUES * sizeof(char*));
+        if (parameters[p].values == NULL) {
+            fprintf(stderr, "Error when allocating the sweep\n");
+            exit(EXIT_FAILURE);
+        }
+        parameters[p].values[0] = SWEEP_OPTIONS[p].defaultValue;
+        parameters[p].count = 1;
+    }
+
+    Sweep sweep;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned jobs = (cpus > 0) ? (unsigned) cpus : 1;
+    parse_sweep_input(argc, argv, &sweep, parameters, &jobs);
+
+    // every combination of the swept values, the last option changes fastest
+    sweep.numConfigs = 1;
+    for (size_t p = 0; p < SWEEP_PARAMETERS; p++) {
+        sweep.numConfigs *= parameters[p].count;
+    }
+    if (sweep.numConfigs > SWEEP_MAX_VALUES * 16) {
+        fprintf(stderr, "Invalid input: The sweep has %zu configurations (at most %d)\n", sweep.numConfigs,
+            SWEEP_MAX_VALUES * 16);
+        exit(EXIT_FAILURE);
+    }
+
+    // the first configuration checks the options of ./cache, its Config loads the requests
+    const char* first[SWEEP_PARAMETERS];
+    for (size_t p = 0; p < SWEEP_PARAMETERS; p++) {
+        first[p] = parameters[p].values[0];
+    }
+    Config* config = parse_configuration(&sweep, first);
+    share_requests(config, &sweep);
+
+    // the engine, the ways and the write policy are the same for every configuration. Retiming goes first
+    // (one simulation for all latencies), then lockstep (it reads the requests once for all configurations),
+    // the L1 filter covers set-associative caches. The line size, the L1 lines and the L2 lines
+    // (the first three options) change the slowest.
+    bool functional = config->engine == ENGINE_FUNCTIONAL && config->writePolicy == WRITE_THROUGH;
+    size_t perL1 = sweep.numConfigs / (parameters[0].count * parameters[1].count);
+    size_t perCaches = perL1 / parameters[2].count;
+    sweep.retime = sweep.retime && config->engine == ENGINE_FUNCTIONAL && perCaches > 1;
+    sweep.lockstep = sweep.lockstep && functional && !sweep.retime && config->l1Ways == 1 && config->l2Ways == 1;
+    sweep.l1Filter = sweep.l1Filter && functional && !sweep.retime && !sweep.lockstep && perL1 > 1;
+    sweep.block = sweep.retime ? perCaches : sweep.l1Filter ? perL1 : sweep.numConfigs;
+
+    size_t sharedSize = sizeof(SweepShared) + sweep.numConfigs * sizeof(SweepResult);
+    sweep.shared = mmap(NULL, sharedSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (sweep.shared == MAP_FAILED) {
+        fprintf(stderr, "Error when mapping the results\n");
+        exit(EXIT_FAILURE);
+    }
+    atomic_init(&sweep.shared->next, 0);
+    for (size_t i = 0; i < sweep.numConfigs; i++) {
+        size_t index = i;
+        for (size_t p = SWEEP_PARAMETERS; p-- > 0;) {
+            sweep.shared->results[i].values[p] = parameters[p].values[index % parameters[p].count];
+            index /= parameters[p].count;
+        }
+        sweep.shared->results[i].simulated = false;
+        snprintf(sweep.shared->results[i].error, SWEEP_ERROR_SIZE, "Not simulated");
+    }
+
+    // the forked processes must not flush the buffers of the parent again
+    fflush(stdout);
+    fflush(stderr);
+
+    if (jobs > sweep.numConfigs) {
+        jobs = (unsigned) sweep.numConfigs;
+    }
+    sweep.chunk = (sweep.numConfigs + jobs - 1) / jobs;
+    if (sweep.chunk > SWEEP_CHUNK_CONFIGS && !sweep.retime) {
+        sweep.chunk = SWEEP_CHUNK_CONFIGS;
+    }
+    if (sweep.chunk > sweep.block) {
+        sweep.chunk = sweep.block;
+    }
+    if (!sweep.retime && !sweep.lockstep && !sweep.l1Filter) {
+        sweep.chunk = 1;
+    }
+    unsigned started = 0;
+    for (unsigned w = 0; w < jobs; w++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            run_worker(&sweep);
+        }
+        if (pid == -1) {
+            fprintf(stderr, "Failed to start worker %u\n", w);
+            break;
+        }
+        started++;
+    }
+    if (started == 0) {
+        exit(EXIT_FAILURE);
+    }
+    while (wait(NULL) > 0) {}
+
+    print_sweep_table(config, started, parameters, sweep.shared->results, sweep.numConfigs);
+
+    munmap(sweep.shared, sharedSize);
+    munmap(sweep.requests, sweep.requestsSize);
+    free(config);
+    return 0;
+}
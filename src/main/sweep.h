@@ -0,0 +1,44 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdbool.h>
+
+#include "simulator.hpp"
+#include "parser/parse.h"
+
+// Options of ./cache that can be swept (see SWEEP_OPTIONS in sweep.c)
+#define SWEEP_PARAMETERS 9
+
+// At most this many values per swept option
+#define SWEEP_MAX_VALUES 4096
+
+// At most this many configurations are simulated at once by a worker in the lockstep and L1 filter modes
+#define SWEEP_CHUNK_CONFIGS 32
+
+// Bytes of the error message kept per configuration
+#define SWEEP_ERROR_SIZE 160
+
+/**
+ * @brief One swept option of ./cache and its values
+ * @note The values are passed on as they are, ./cache checks them
+ */
+typedef struct {
+    const char* option; // long option of ./cache, e.g. "l1-lines"
+    const char* title; // column title of the table
+    const char** values; // values of the option, in the order given
+    size_t count; // number of values
+} SweepParameter;
+
+/**
+ * @brief Outcome of one configuration of a sweep
+ * @note Lives in memory shared by all processes of the sweep, the values point to strings of the parent
+ */
+typedef struct {
+    const char* values[SWEEP_PARAMETERS]; // value of every swept option
+    Config config; // the parsed options (retime, lockstep and L1 filter modes only)
+    Result result; // only valid if simulated
+    bool simulated; // false if ./cache rejected the configuration or the simulation failed
+    char error[SWEEP_ERROR_SIZE]; // first line of stderr if not simulated
+} SweepResult;
+
+#endif // SWEEP_H
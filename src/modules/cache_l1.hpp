@@ -8,6 +8,8 @@
 #include <vector>
 
 #include "../main/simulator.hpp" // the struct moved here - Leon
+#include "tag_store.hpp"
+#include "line_arena.hpp"
 
 // using namespace directives won't get carried over. 
 using namespace sc_core;
@@ -22,6 +24,13 @@ using namespace std;
 * its write miss policy is no-write-allocate, no-fetch-on-write, and no-write-before-hit
 * its write hit policy is write-through
 * 
+* The cache is set-associative with `ways` lines per set (direct-mapped with one way), see TAG_STORE
+* 
+* With writeBack, the policy is write-back, write-allocate instead:
+* 1. A write hit only updates the line and marks it as dirty, L2 is not involved
+* 2. On a miss (read or write), a dirty victim is written back to L2 as a whole line first,
+*    then the line is fetched from L2, and a write is merged into it
+* 
 * @author Van Trang Nguyen
 */
 SC_MODULE(L1){
@@ -36,7 +45,7 @@ SC_MODULE(L1){
     sc_out<bool> write_enable_out;      // Write-enable signal propagated to L2 cache
 
     sc_in<char*> data_out_to_CPU;       // Read data to the CPU
-    sc_in<char*> data_out_to_L2;        // Data propagated from CPU to the L2 cache
+    sc_in<char*> data_out_to_L2;        // Data propagated from CPU to the L2 cache (a whole line on a writeback)
     
     sc_out<bool> hit;                   // Cache hit signal
     sc_in<bool> done_from_L2;           // Signal indicating the completion operation in L2
@@ -47,21 +56,47 @@ SC_MODULE(L1){
     sc_in<bool> valid_in;               // valid marker from CPU
     sc_out<bool> valid_out;             // marks if the command propagated to L2 is valid
     
-    vector<vector<char>> cache_blocks;  // Cache blocks represented in a 2D vector
+    LINE_ARENA cache_blocks;            // Data of the cache lines, cache_blocks[line][byte]
     
-    vector<bool> valid;                 // Vector indicating the validity of cache lines
-    vector<uint32_t> tags;              // Vector storing the tags for each cache line
+    TAG_STORE tag_store;                // Tags, valid bits and replacement state of the cache lines
 
     unsigned cacheLineSize;             // Size of each cache line
     unsigned l1CacheLines;              // Number of cache lines in the L1 cache
     unsigned l1CacheLatency;            // Latency of L1 cache in clock cycles
+    bool writeBack;                     // write-back, write-allocate instead of write-through
+    bool timingOnly;                    // only tags and valid bits, no line data (cache_blocks stays empty)
+    size_t writebacks = 0;              // dirty lines written back to L2
+    bool idle = false;                  // update() waits for a request
+
+    /**
+     * @brief States of update_fsm(), each one is a place where update() waits
+     */
+    enum State {
+        RESET,          // before the first clock edge
+        IDLE,           // top of the loop in update()
+        WAIT_VALID,     // waiting for a valid request from the CPU
+        LATENCY,        // waiting l1CacheLatency cycles
+        ACCESS,         // tags and data are accessible
+        WAIT_L2,        // waiting for done_from_L2
+        WB_ACCESS,      // write-back: hit, or choose the victim
+        WB_EVICT_WAIT,  // write-back: waiting for done_from_L2 after writing back the victim
+        WB_EVICT_END,   // write-back: waiting for done_from_L2 to fall
+        WB_FETCH,       // write-back: request the line from L2
+        WB_FETCH_WAIT,  // write-back: waiting for done_from_L2 after the fetch
+        WB_COMPLETE,    // write-back: read or write the line
+        DONE            // signal done, wait for the next clock edge
+    };
+
+    State state = RESET;                // current state of update_fsm()
+    unsigned pending_deltas = 0;        // delta cycles left before the current state runs
+    unsigned cycles_left = 0;           // clock cycles left in LATENCY
 
-    // Optimization - Leon
-    unsigned int log2_cacheLineSize = 0;    // log2(cacheLineSize)
-    unsigned int log2_l1CacheLines = 0;     // log2(l1CacheLines)
-    unsigned int power_of_two = 1;
+    // The request being processed by update_fsm()
+    unsigned int address_int = 0;
+    unsigned int offset = 0;
+    int line = -1;                      // cache line of the request, -1 on a miss
+    bool writing = false;
 
-   
 
 
     /**
@@ -71,52 +106,120 @@ SC_MODULE(L1){
      * @param cacheLineSize The size of each cache line.
      * @param l1CacheLines The number of cache lines in the L1 cache.
      * @param l1CacheLatency The latency of the L1 cache in clock cycles.
+     * @param ways The number of lines per set (1 = direct-mapped).
+     * @param replacement The replacement policy if there is more than one way.
+     * @param writeBack Write-back, write-allocate instead of write-through, no-write-allocate.
+     * @param timingOnly Keep no line data and copy nothing over the data buses (the timing is the same).
      *
      * @authors 
      * Van Trang Nguyen
      * Lie Leon Alexius
      */
     SC_CTOR(L1);
-    L1(sc_module_name name, unsigned cacheLineSize, unsigned l1CacheLines, unsigned l1CacheLatency) : sc_module(name), cacheLineSize(cacheLineSize), l1CacheLines(l1CacheLines), l1CacheLatency(l1CacheLatency){
-        cache_blocks.resize(l1CacheLines, vector<char> (cacheLineSize));
-        valid.resize(l1CacheLines);
-        tags.resize(l1CacheLines);
-
+    L1(sc_module_name name, unsigned cacheLineSize, unsigned l1CacheLines, unsigned l1CacheLatency,
+        unsigned ways = 1, Replacement replacement = REPLACEMENT_LRU, bool writeBack = false, bool timingOnly = false) :
+        sc_module(name), tag_store(cacheLineSize, l1CacheLines, ways, replacement),
+        cacheLineSize(cacheLineSize), l1CacheLines(l1CacheLines), l1CacheLatency(l1CacheLatency), writeBack(writeBack),
+        timingOnly(timingOnly){
+        if (!timingOnly) {
+            cache_blocks.resize(l1CacheLines, cacheLineSize);
+        }
 
         /*
             Optimization - Leon
-            log2() is equivalent as shifting n times
-
-            Ex: 0001.0000 (16) returns 4
-            0000.1000 - 1
-            0000.0100 - 2
-            0000.0010 - 3
-            0000.0001 - 4
-            0000.0000 - stop
+            log2() is equivalent as shifting n times, see log2_line_size() and TAG_STORE
         */
 
-        while ((cacheLineSize >>= 1) > 0) {
-            log2_cacheLineSize++;
-        }
-        l1CacheLines -= 1;    
-        while ((l1CacheLines >>= 1) > 0) {
-            log2_l1CacheLines++;
-        }
-        log2_l1CacheLines++;
-
-        power_of_two <<= (log2_l1CacheLines);
-
-        // std::cout << log2_l1CacheLines << std::endl;
-        // std::cout << power_of_two << std::endl;
-
         /*
             Use SC_THREAD() instead of C_THREAD() because:
             C_THREAD() wait(SC_ZERO_TIME) waits for 1 Cycle not 1 Delta + Depracated
+
+            With FSM_CONTROLLERS (make CONTROLLERS=fsm), the same controller runs as an SC_METHOD
+            state machine instead, which does not need a coroutine stack and a context switch per wait().
         */
+#ifdef FSM_CONTROLLERS
+        SC_METHOD(update_fsm);
+        sensitive << clk.pos();
+#else
         SC_THREAD(update);
         sensitive << clk.pos();
+#endif
     };
 
+    /**
+     * @brief Empty the cache between two runs (see CPU_L1_L2::reset()), the controller must be waiting for a request
+     */
+    void reset() {
+        tag_store.reset();
+        cache_blocks.clear();
+        writebacks = 0;
+    }
+
+    /**
+     * @brief Whether the controller waits for a request (see CPU_L1_L2::reset())
+     */
+    bool is_idle() const {
+#ifdef FSM_CONTROLLERS
+        return state == IDLE || state == WAIT_VALID;
+#else
+        return idle;
+#endif
+    }
+
+    /*
+        The data of a request: nothing is copied with timingOnly, hits, misses and the handshakes with L2 stay the same
+    */
+
+    /**
+     * @brief Write the 4 bytes from the CPU into a line
+     */
+    void store_word(int line, unsigned int offset) {
+        if (timingOnly) return;
+        for (int i = 0; i < 4; i++) {
+            cache_blocks[line][i + offset] = data_in_from_CPU->read()[i];
+        }
+    }
+
+    /**
+     * @brief Write 4 bytes of a line to the bus to the CPU
+     */
+    void load_word(int line, unsigned int offset) {
+        if (timingOnly) return;
+        for (unsigned i = 0; i < 4; i++) {
+            data_out_to_CPU->read()[i] = cache_blocks[line][i + offset];
+        }
+    }
+
+    /**
+     * @brief Write the 4 bytes from the CPU to the bus to L2 (write-through)
+     */
+    void forward_word() {
+        if (timingOnly) return;
+        for (int i = 0; i < 4; i++) {
+            data_out_to_L2->read()[i] = data_in_from_CPU->read()[i];
+        }
+    }
+
+    /**
+     * @brief Load a whole line from the bus from L2
+     */
+    void fill_line(int line) {
+        if (timingOnly) return;
+        for (unsigned i = 0; i < cacheLineSize; i++) {
+            cache_blocks[line][i] = data_in_from_L2->read()[i];
+        }
+    }
+
+    /**
+     * @brief Write a whole line to the bus to L2 (write-back of a dirty victim)
+     */
+    void evict_line(int line) {
+        if (timingOnly) return;
+        for (unsigned i = 0; i < cacheLineSize; i++) {
+            data_out_to_L2->read()[i] = cache_blocks[line][i];
+        }
+    }
+
     /**
      * @brief Main update method for the L1 cache.
      * @details 
@@ -139,9 +242,11 @@ SC_MODULE(L1){
             wait(SC_ZERO_TIME);
             
             // wait until cpu's signal is valid
+            idle = true;
             while (!valid_in->read()) {
                 wait();
             }
+            idle = false;
             
             unsigned int address_int = address->read();
 
@@ -165,37 +270,39 @@ SC_MODULE(L1){
                 1. index is (address_int >> int(log2(cacheLineSize))) % (l1CacheLines) as 
                 it is not guaranteed that cache lines are a power of two;
                 2. tag was address_int >> (log2_cacheLineSize + log2_l1CacheLines);
+
+                With more than one way, the index selects a set instead of a line (see TAG_STORE)
             */
             unsigned int offset = address_int & (cacheLineSize - 1);
             
-            unsigned int index = ((address_int >> log2_cacheLineSize) & (power_of_two - 1)) % l1CacheLines;
-            unsigned int tag = address_int >> (log2_cacheLineSize + (log2_l1CacheLines - (power_of_two != l1CacheLines)));
-
-            // std::cout << tag << " " << index << " " << tags[index] << " " << sc_time_stamp().to_seconds() << std::endl;
-            
             // Tags and Data is only accessible after l1 latency cycles.
             for (unsigned i = 0; i < l1CacheLatency; i++) {
                 
                 wait();
             }
 
+            // cache line holding the address, -1 on a miss
+            int line = tag_store.find(address_int);
+
+            // write-back, write-allocate
+            if (writeBack) {
+                update_write_back(address_int, offset, line);
+            }
+
             // write operation
-            if (write_enable->read()){
+            else if (write_enable->read()){
                 
                 // write hit, write through
-                if ((tags[index] == tag) && (valid[index]))
+                if (line >= 0)
                 {   
                     hit->write(true);
+                    tag_store.touch(line);
                     // write the input data to the matching cacheline
-                    for (int i = 0; i < 4; i++){
-                        cache_blocks[index][i + offset] = data_in_from_CPU->read()[i];
-                    }
+                    store_word(line, offset);
                 }
 
                 // no matter write miss or write hit, propagate to L2
-                for (int i = 0; i < 4; i++) {
-                    data_out_to_L2->read()[i] = data_in_from_CPU->read()[i];
-                }
+                forward_word();
                 
                 // Signal to L2, then mark as valid propagation
                 address_out->write(address->read());
@@ -219,10 +326,11 @@ SC_MODULE(L1){
             else {
 
                 // cache hit
-                if (valid[index] && tags[index]==tag)
+                if (line >= 0)
                 {
                     // std::cout << std::hex << address << std::endl;
                     hit->write(true);                    
+                    tag_store.touch(line);
                 }
 
                 // Read miss, propagate to L2, load cacheline from L2 to L1, and write to data_out_to_CPU
@@ -245,22 +353,18 @@ SC_MODULE(L1){
                     valid_out->write(false);
 
 
-                    // Write the data to the appropriate CacheLine
+                    // Write the data to the appropriate CacheLine (the victim of the set)
                     // Data that is sent by L2 is a whole cacheLine
-                    for (unsigned i = 0; i < cacheLineSize; i++) {
-                        cache_blocks[index][i] = data_in_from_L2->read()[i]; 
-                    }
-                    valid[index] = true; // set data is valid
-                    tags[index] = tag; // update tag
+                    line = tag_store.victim(address_int);
+                    fill_line(line);
+                    tag_store.fill(line, address_int); // set data is valid, update tag
 
 
 
                 }
 
                 // Write data to bus for the CPU (4 Bytes)
-                for (unsigned i = 0; i < 4; i++) {
-                    data_out_to_CPU->read()[i] = cache_blocks[index][i + offset];
-                }
+                load_word(line, offset);
             }
 
             
@@ -269,6 +373,283 @@ SC_MODULE(L1){
            
         }
     }
+
+    /**
+     * @brief The access of update() with the write-back, write-allocate policy
+     *
+     * @param address_int address of the request
+     * @param offset offset of the address in its cache line
+     * @param line cache line holding the address, -1 on a miss
+     */
+    void update_write_back(unsigned int address_int, unsigned int offset, int line) {
+        bool writing = write_enable->read();
+
+        // read or write hit, nothing is propagated to L2
+        if (line >= 0) {
+            hit->write(true);
+            tag_store.touch(line);
+        }
+
+        // read or write miss
+        else {
+            line = tag_store.victim(address_int);
+
+            // write the dirty victim back to L2 (a whole line), and wait until L2 is ready again
+            if (tag_store.is_dirty(line)) {
+                evict_line(line);
+                request_L2(tag_store.line_address(line), true);
+                writebacks++;
+
+                while (done_from_L2->read()) {
+                    wait();
+                }
+            }
+
+            // fetch the line from L2, also on a write miss (write-allocate)
+            request_L2(address->read(), false);
+            fill_line(line);
+            tag_store.fill(line, address_int);
+        }
+
+        if (writing) {
+            store_word(line, offset);
+            tag_store.mark_dirty(line);
+        }
+        else {
+            // Write data to bus for the CPU (4 Bytes)
+            load_word(line, offset);
+        }
+    }
+
+    /**
+     * @brief Propagate a request to L2 and wait until L2 is done (same handshake as in update())
+     */
+    void request_L2(uint32_t address_L2, bool write_enable_L2) {
+        address_out->write(address_L2);
+        write_enable_out->write(write_enable_L2);
+        valid_out->write(true);
+
+        while (!done_from_L2->read()) {
+            wait();
+            wait(SC_ZERO_TIME);
+            wait(SC_ZERO_TIME);
+            wait(SC_ZERO_TIME);
+            wait(SC_ZERO_TIME);
+            wait(SC_ZERO_TIME);
+            wait(SC_ZERO_TIME);
+        }
+        valid_out->write(false);
+    }
+
+    /**
+     * @brief Wait for the next clock edge (and then n delta cycles), like wait() in update()
+     */
+    void wait_clock(State next, unsigned deltas = 0) {
+        state = next;
+        pending_deltas = deltas;
+        next_trigger();
+    }
+
+    /**
+     * @brief Wait for n delta cycles, like n times wait(SC_ZERO_TIME) in update()
+     */
+    void wait_delta(State next, unsigned deltas = 1) {
+        state = next;
+        pending_deltas = deltas - 1;
+        next_trigger(SC_ZERO_TIME);
+    }
+
+    /**
+     * @brief update() as an SC_METHOD state machine (built with FSM_CONTROLLERS)
+     * @details
+     * Every wait() of update() is a next_trigger() here, and the state tells where to continue.
+     * The signals are written in the same delta cycles as in update(), so the timing is identical.
+     */
+    void update_fsm() {
+        if (pending_deltas > 0) {
+            pending_deltas--;
+            next_trigger(SC_ZERO_TIME);
+            return;
+        }
+
+        while (true) {
+            switch (state) {
+            case RESET:
+                wait_clock(IDLE); // wait for next clk event (refer to SC_START(ZERO) in CPU_L1_L2)
+                return;
+
+            case IDLE:
+                hit->write(false);
+                done->write(false);
+                wait_delta(WAIT_VALID, 2);
+                return;
+
+            case WAIT_VALID: {
+                // wait until cpu's signal is valid
+                if (!valid_in->read()) {
+                    wait_clock(WAIT_VALID);
+                    return;
+                }
+
+                // extracts metadata bits from address - optimized (see update())
+                address_int = address->read();
+                offset = address_int & (cacheLineSize - 1);
+
+                cycles_left = l1CacheLatency;
+                state = LATENCY;
+                break;
+            }
+
+            case LATENCY:
+                // Tags and Data is only accessible after l1 latency cycles.
+                if (cycles_left > 0) {
+                    cycles_left--;
+                    wait_clock(LATENCY);
+                    return;
+                }
+                state = ACCESS;
+                break;
+
+            case ACCESS:
+                if (writeBack) {
+                    state = WB_ACCESS;
+                    break;
+                }
+
+                writing = write_enable->read();
+                line = tag_store.find(address_int);
+
+                // write operation
+                if (writing) {
+                    // write hit, write through
+                    if (line >= 0) {
+                        hit->write(true);
+                        tag_store.touch(line);
+                        store_word(line, offset);
+                    }
+
+                    // no matter write miss or write hit, propagate to L2
+                    forward_word();
+                }
+
+                // read hit
+                else if (line >= 0) {
+                    hit->write(true);
+                    tag_store.touch(line);
+                    load_word(line, offset);
+                    state = DONE;
+                    break;
+                }
+
+                // write or read miss: signal to L2, then mark as valid propagation
+                address_out->write(address->read());
+                write_enable_out->write(write_enable->read());
+                valid_out->write(true);
+                state = WAIT_L2;
+                break;
+
+            case WAIT_L2:
+                // Wait until L2 is done, mark as invalid propagation
+                if (!done_from_L2->read()) {
+                    wait_clock(WAIT_L2, 6);
+                    return;
+                }
+                valid_out->write(false);
+
+                // Read miss: load the cacheline from L2 to L1, and write to data_out_to_CPU
+                if (!writing) {
+                    line = tag_store.victim(address_int);
+                    fill_line(line);
+                    tag_store.fill(line, address_int);
+
+                    load_word(line, offset);
+                }
+                state = DONE;
+                break;
+
+            case WB_ACCESS:
+                // write-back, write-allocate (see update_write_back())
+                writing = write_enable->read();
+                line = tag_store.find(address_int);
+
+                // read or write hit, nothing is propagated to L2
+                if (line >= 0) {
+                    hit->write(true);
+                    tag_store.touch(line);
+                    state = WB_COMPLETE;
+                    break;
+                }
+
+                // read or write miss: write the dirty victim back to L2 first
+                line = tag_store.victim(address_int);
+                if (!tag_store.is_dirty(line)) {
+                    state = WB_FETCH;
+                    break;
+                }
+                evict_line(line);
+                address_out->write(tag_store.line_address(line));
+                write_enable_out->write(true);
+                valid_out->write(true);
+                writebacks++;
+                state = WB_EVICT_WAIT;
+                break;
+
+            case WB_EVICT_WAIT:
+                if (!done_from_L2->read()) {
+                    wait_clock(WB_EVICT_WAIT, 6);
+                    return;
+                }
+                valid_out->write(false);
+                state = WB_EVICT_END;
+                break;
+
+            case WB_EVICT_END:
+                // wait until L2 is ready again
+                if (done_from_L2->read()) {
+                    wait_clock(WB_EVICT_END);
+                    return;
+                }
+                state = WB_FETCH;
+                break;
+
+            case WB_FETCH:
+                // fetch the line from L2, also on a write miss (write-allocate)
+                address_out->write(address->read());
+                write_enable_out->write(false);
+                valid_out->write(true);
+                state = WB_FETCH_WAIT;
+                break;
+
+            case WB_FETCH_WAIT:
+                if (!done_from_L2->read()) {
+                    wait_clock(WB_FETCH_WAIT, 6);
+                    return;
+                }
+                valid_out->write(false);
+
+                fill_line(line);
+                tag_store.fill(line, address_int);
+                state = WB_COMPLETE;
+                break;
+
+            case WB_COMPLETE:
+                if (writing) {
+                    store_word(line, offset);
+                    tag_store.mark_dirty(line);
+                }
+                else {
+                    load_word(line, offset);
+                }
+                state = DONE;
+                break;
+
+            case DONE:
+                done->write(true); // signal as done
+                wait_clock(IDLE); // wait for next clk event
+                return;
+            }
+        }
+    }
 };
 
 #endif
@@ -10,6 +10,8 @@
 #include "../main/simulator.hpp" // the struct moved here - Leon
 #include "storeback_buffer.hpp"
 #include "prefetch_buffer.hpp"
+#include "tag_store.hpp"
+#include "line_arena.hpp"
 
 // using namespace directives won't get carried over. 
 using namespace sc_core;
@@ -18,6 +20,13 @@ using namespace std;
 /**
  * @brief L2 represents an L2 cache in a memory hierarchy system.
  * @details L2 handles read and write operations to and from L1 cache and main memory.
+ * The cache is set-associative with `ways` lines per set (direct-mapped with one way), see TAG_STORE
+ *
+ * With writeBack, the policy is write-back, write-allocate instead of write-through:
+ * 1. A write from L1 is the writeback of a whole line. It is stored in L2 and marked as dirty,
+ *    memory is not involved (no fetch is needed, the line is complete)
+ * 2. When a dirty line is replaced, it is written to memory (through the storeback buffer, if there is one)
+ * 3. Prefetched lines never replace a line that is already cached or dirty
  *
  * @author Van Trang Nguyen
  */
@@ -32,7 +41,7 @@ SC_MODULE(L2){
     sc_out<bool> write_enable_out;          // Write-enable signal propagated to memory
 
     sc_in<char*> data_out_to_L1;            // Data output to L1 cache
-    sc_in<char*> data_out_to_Mem;           // Data output to memory
+    sc_in<char*> data_out_to_Mem;           // Data output to memory (a whole line on a writeback)
 
     sc_out<bool> hit;                       // Cache hit signal
     sc_in<bool> done_from_Mem;              // Signal indicating the completion of an operation in memory
@@ -42,10 +51,9 @@ SC_MODULE(L2){
     sc_in<bool> valid_in;                   // valid marker from L1
     sc_out<bool> valid_out;                 // marks if the command propagated to RAM is valid
 
-    vector<vector<char>> cache_blocks;      // A 2D vector representing the cache blocks
+    LINE_ARENA cache_blocks;                // Data of the cache lines, cache_blocks[line][byte]
 
-    vector<bool> valid;                     // Vector indicating the validity of cache lines
-    vector<uint32_t> tags;                  // Vector storing the tags for each cache line
+    TAG_STORE tag_store;                    // Tags, valid bits and replacement state of the cache lines
 
     // We will use a WTCB (Write Through with Conditional Flush buffer)
     STOREBACK* storeback;
@@ -55,12 +63,204 @@ SC_MODULE(L2){
     unsigned cacheLineSize;                 // Size of each cache line
     unsigned l2CacheLines;                  // Number of cache lines in the L2 cache
     unsigned l2CacheLatency;                // Latency of L2 cache in clock cycles
+    bool writeBack;                         // write-back, write-allocate instead of write-through
+    bool timingOnly;                        // only tags and valid bits, no line data (cache_blocks stays empty)
+    bool idle = false;                      // update() waits for a request
+    size_t writebacks = 0;                  // dirty lines written back to memory
+    size_t flush_stalls = 0;                // cycles that read misses waited for the storeback buffer to be flushed
+    size_t forwarded_loads = 0;             // read misses read from memory, with bytes from the storeback buffer
+    size_t buffer_loads = 0;                // read misses taken from the storeback buffer alone, memory was not read
+    size_t prefetches = 0;                  // prefetched lines that arrived in the cache
+    size_t late_prefetches = 0;             // read misses that waited for their line to arrive from a prefetch
+    size_t useful_prefetches = 0;           // prefetched lines that a read hit before they were replaced
+    vector<char> prefetched;                // prefetched[line]: the line was prefetched and has not been read yet
 
     // Optimization - Leon
     unsigned int log2_cacheLineSize = 0;    // log2(cacheLineSize)
-    unsigned int log2_l2CacheLines = 0;     // log2(l2CacheLines)
-    unsigned int power_of_two = 1;
     unsigned int buffer_size;
+
+    /**
+     * @brief Empty the cache between two runs (see CPU_L1_L2::reset()), the controller must be waiting for a request
+     */
+    void reset() {
+        tag_store.reset();
+        cache_blocks.clear();
+        writebacks = 0;
+        flush_stalls = 0;
+        forwarded_loads = 0;
+        buffer_loads = 0;
+        prefetches = 0;
+        late_prefetches = 0;
+        useful_prefetches = 0;
+        prefetched.assign(l2CacheLines, 0);
+    }
+
+    /**
+     * @brief Whether the controller waits for a request (see CPU_L1_L2::reset())
+     */
+    bool is_idle() const {
+#ifdef FSM_CONTROLLERS
+        return state == IDLE || state == WAIT_VALID;
+#else
+        return idle;
+#endif
+    }
+
+    /*
+        The data of a request: nothing is copied with timingOnly (the buffers have no slots either),
+        hits, misses and the handshakes with memory stay the same
+    */
+
+    /**
+     * @brief Write the 4 bytes from L1 into a line
+     */
+    void store_word(int line, unsigned int offset) {
+        if (timingOnly) return;
+        for (unsigned i = 0; i < 4; i++) {
+            cache_blocks[line][i + offset] = data_in_from_L1->read()[i];
+        }
+    }
+
+    /**
+     * @brief Write the 4 bytes from L1 to the bus to memory (write-through)
+     */
+    void forward_word() {
+        if (timingOnly) return;
+        for (unsigned i = 0; i < 4; i++) {
+            data_out_to_Mem->read()[i] = data_in_from_L1->read()[i];
+        }
+    }
+
+    /**
+     * @brief Copy the 4 bytes on the bus to memory into the slot of the next write to the storeback buffer
+     */
+    void copy_word() {
+        if (timingOnly) return;
+        char* payload = storeback->payload();
+        for (unsigned i = 0; i < 4; i++) {
+            payload[i] = data_out_to_Mem->read()[i];
+        }
+    }
+
+    /**
+     * @brief Load a whole line from the bus from memory
+     */
+    void fill_line(int line) {
+        if (timingOnly) return;
+        for (unsigned i = 0; i < cacheLineSize; i++) {
+            cache_blocks[line][i] = data_in_from_Mem->read()[i];
+        }
+    }
+
+    /**
+     * @brief Load a line read from the prefetch buffer
+     */
+    void load_prefetched(int line, const char* data) {
+        if (timingOnly) return;
+        for (unsigned i = 0; i < cacheLineSize; i++) {
+            cache_blocks[line][i] = data[i];
+        }
+    }
+
+    /**
+     * @brief Write a whole line to the bus to L1
+     */
+    void reply_line(int line) {
+        if (timingOnly) return;
+        for (unsigned i = 0; i < cacheLineSize; i++) {
+            data_out_to_L1->read()[i] = cache_blocks[line][i];
+        }
+    }
+
+    /**
+     * @brief Store a whole line written back by L1
+     */
+    void store_line(int line) {
+        if (timingOnly) return;
+        for (unsigned i = 0; i < cacheLineSize; i++) {
+            cache_blocks[line][i] = data_in_from_L1->read()[i];
+        }
+    }
+
+    /**
+     * @brief Write a whole line to the bus to memory (write-back of a dirty victim)
+     */
+    void evict_line(int line) {
+        if (timingOnly) return;
+        for (unsigned i = 0; i < cacheLineSize; i++) {
+            data_out_to_Mem->read()[i] = cache_blocks[line][i];
+        }
+    }
+
+    /**
+     * @brief Store-to-load forwarding: write the bytes of the line that are still in the storeback buffer over it
+     * @return Whether the buffer held bytes of the line (also with timingOnly, where nothing is copied)
+     */
+    bool forward_line(int line, unsigned int address_int) {
+        return storeback->forward(address_int >> log2_cacheLineSize, address_int & ~(cacheLineSize - 1),
+            timingOnly ? nullptr : cache_blocks[line]);
+    }
+
+    /**
+     * @brief Copy a line into the slot of the next write to the storeback buffer
+     */
+    void copy_line(int line) {
+        if (timingOnly) return;
+        char* payload = storeback->payload();
+        for (unsigned i = 0; i < cacheLineSize; i++) {
+            payload[i] = cache_blocks[line][i];
+        }
+    }
+
+    /**
+     * @brief States of update_fsm(), each one is a place where update() waits
+     */
+    enum State {
+        RESET,              // before the first clock edge
+        IDLE,               // top of the loop in update()
+        WAIT_VALID,         // waiting for a valid request from L1
+        LATENCY,            // waiting l2CacheLatency cycles
+        ACCESS,             // tags and data are accessible
+        PREFETCH_WAIT,      // read miss on a line that is on its way from a prefetch, wait until it arrives
+        READ,               // read hit or miss
+        STOREBACK_WRITE,    // storeback->write(), before the write into the buffer
+        STOREBACK_PUSH,     // storeback->write(), writing into the buffer
+        STOREBACK_FULL,     // the buffer was full, wait for the next clock edge
+        STOREBACK_RETRY,    // try again, unless L1 has withdrawn the request
+        WAIT_MEM_WRITE,     // waiting for done_from_Mem after a write
+        WRITE_END,          // the write has been propagated
+        MISS,               // read miss, flush the storeback buffer or read from memory
+        FLUSH,              // waiting for the storeback buffer to be flushed
+        FLUSH_LINE,         // selective flush: waiting until memory has written the entries of the line
+        FLUSH_END,          // waiting for done_from_Mem to fall after the flush
+        READ_MEM,           // propagate the read miss to memory
+        WAIT_MEM_READ,      // waiting for done_from_Mem after a read
+        REPLY,              // bring the read data back to L1
+        WB_INSTALL,         // write-back: a line written back by L1 replaces the victim
+        WB_STORE,           // write-back: store the line written back by L1
+        EVICT,              // write-back: write the dirty victim to memory
+        EVICT_WRITE,        // storeback->write(), before the write into the buffer
+        EVICT_PUSH,         // storeback->write(), writing into the buffer
+        EVICT_FULL,         // the buffer was full, wait for the next clock edge
+        EVICT_WAIT,         // waiting for done_from_Mem after the write (no storeback buffer)
+        EVICT_END,          // waiting for done_from_Mem to fall (no storeback buffer)
+        DONE,               // signal done
+        DONE_WAIT           // wait for the next clock edge
+    };
+
+    State state = RESET;                    // current state of update_fsm()
+    unsigned pending_deltas = 0;            // delta cycles left before the current state runs
+    unsigned cycles_left = 0;               // clock cycles left in LATENCY
+
+    // The request being processed by update_fsm()
+    unsigned int address_int = 0;
+    unsigned int offset = 0;
+    int line = -1;                          // cache line of the request, -1 on a miss
+    uint32_t storeback_address = 0;         // address of the write waiting for the storeback buffer
+    bool forwarding_line = false;           // the line of the read miss has entries in the storeback buffer
+    sc_time prefetch_ready;                 // when the line of a read miss arrives from a prefetch (PREFETCH_WAIT)
+    State evict_next = DONE;                // where to continue after EVICT
+    uint32_t evict_address = 0;             // address of the victim
     
 
     
@@ -72,32 +272,36 @@ SC_MODULE(L2){
     * @param cacheLineSize The size of each cache line.
     * @param l2CacheLines The number of cache lines in the L2 cache.
     * @param l2CacheLatency The latency of the L2 cache in clock cycles.
+    * @param ways The number of lines per set (1 = direct-mapped).
+    * @param replacement The replacement policy if there is more than one way.
+    * @param writeBack Write-back, write-allocate instead of write-through.
+    * @param timingOnly Keep no line data and copy nothing over the data buses (the timing is the same).
     *
     * @authors 
     * Van Trang Nguyen
     * Lie Leon Alexius
     */
     SC_CTOR(L2);
-    L2(sc_module_name name, unsigned cacheLineSize, unsigned l2CacheLines, unsigned l2CacheLatency, PREFETCH* prefetch, STOREBACK* storeback) : sc_module(name), cacheLineSize(cacheLineSize), l2CacheLines(l2CacheLines), l2CacheLatency(l2CacheLatency), storeback(storeback), prefetch(prefetch) {
-        cache_blocks.resize(l2CacheLines, vector<char> (cacheLineSize));
-        valid.resize(l2CacheLines);
-        tags.resize(l2CacheLines);
-        
+    L2(sc_module_name name, unsigned cacheLineSize, unsigned l2CacheLines, unsigned l2CacheLatency, PREFETCH* prefetch, STOREBACK* storeback,
+        unsigned ways = 1, Replacement replacement = REPLACEMENT_LRU, bool writeBack = false, bool timingOnly = false) :
+        sc_module(name), tag_store(cacheLineSize, l2CacheLines, ways, replacement),
+        storeback(storeback), prefetch(prefetch), cacheLineSize(cacheLineSize), l2CacheLines(l2CacheLines), l2CacheLatency(l2CacheLatency),
+        writeBack(writeBack), timingOnly(timingOnly) {
+        if (!timingOnly) {
+            cache_blocks.resize(l2CacheLines, cacheLineSize);
+        }
+        prefetched.assign(l2CacheLines, 0);
         
         // Optimization - Leon
-        while ((cacheLineSize >>= 1) > 0) {
-            log2_cacheLineSize++;
-        }
-        l2CacheLines -= 1;
-        while ((l2CacheLines >>= 1) > 0) {
-            log2_l2CacheLines++;
-        }
-        log2_l2CacheLines++;
-
-        power_of_two <<= log2_l2CacheLines;
+        log2_cacheLineSize = log2_line_size(cacheLineSize);
 
+#ifdef FSM_CONTROLLERS
+        SC_METHOD(update_fsm);
+        sensitive << clk.pos();
+#else
         SC_THREAD(update);
         sensitive << clk.pos();
+#endif
     }
 
    /**
@@ -118,17 +322,17 @@ SC_MODULE(L2){
             wait(SC_ZERO_TIME);
 
             // wait until L1's signal is valid
+            idle = true;
             while (!valid_in->read()) {
                 wait();
                 wait(SC_ZERO_TIME);
             }
+            idle = false;
 
             unsigned address_int = address->read();
 
             // extracts metadata bits from address - optimized (see L1)
             unsigned int offset = address_int & (cacheLineSize - 1);
-            unsigned int index = ((address_int >> log2_cacheLineSize) & (power_of_two - 1)) % (l2CacheLines);
-            unsigned int tag = address_int >> (log2_cacheLineSize + log2_l2CacheLines - (power_of_two != l2CacheLines));
 
             // Tags and data is only accessible after l2 latency cyles
             // Here it is -1 so that the simulation logic stays consistent -
@@ -137,23 +341,33 @@ SC_MODULE(L2){
                 wait();
             }
             
+            // the prefetched lines that have arrived go into the cache first
+            install_prefetched();
+
+            // cache line holding the address, -1 on a miss
+            int line = tag_store.find(address_int);
+
+            // write-back: a whole line written back by L1
+            if (writeBack && write_enable->read()) {
+                write_back_from_L1(address_int, line);
+            }
+
             // write operation
-            if(write_enable->read()){
-                
+            else if(write_enable->read()){
+                // a prefetch of the line that is on its way would be stale
+                cancel_prefetch(address_int);
+
                 // write hit, write through
-                if (tags[index] == tag && valid[index])
+                if (line >= 0)
                 {
                     hit->write(true);
+                    tag_store.touch(line);
                     // write the input data to the matching cacheline 
-                    for (unsigned i=0; i<4;i++){
-                        cache_blocks[index][i+offset]= data_in_from_L1->read()[i];
-                    }
+                    store_word(line, offset);
                 }
                 
                 //no matter write miss or hit, continues to propagate to Memory
-                for (unsigned i = 0; i < 4; i++){    
-                    data_out_to_Mem->read()[i] = data_in_from_L1->read()[i];
-                }
+                forward_word();
 
                 // Signal to RAM, then mark as valid propagation
                 address_out->write(address->read());
@@ -163,12 +377,8 @@ SC_MODULE(L2){
 
 
                 if (storeback != nullptr) {
-                    char* new_data = new char[4]();
-                    //write to buffer
-                    for (unsigned i = 0; i < 4; i++){    
-                        new_data[i] = data_out_to_Mem->read()[i];
-                    }
-                    while (!storeback->write(new_data, address, (address_int >> log2_cacheLineSize))) {
+                    copy_word();
+                    while (!storeback->write(address, (address_int >> log2_cacheLineSize))) {
                         wait(SC_ZERO_TIME);
                         wait();
                         if (!valid_in->read()) break;
@@ -188,68 +398,45 @@ SC_MODULE(L2){
 
             // read operation
             else {
+                // a miss on a line that is on its way from memory waits for it instead of reading it again
+                if (line < 0) {
+                    line = wait_prefetched(address_int);
+                }
+                prefetch_read(address_int, line);
 
                 // cache hit
-                if (valid[index] && tags[index]==tag)
+                if (line >= 0)
                 {
                     hit->write(true);
+                    tag_store.touch(line);
                 }
 
                 // Read miss, propagate to mem
                 else 
                 {
-                    // If there is a storeback buffer -> check the tag and the address in the storeback buffer if the tag and address is there or not
-                    if (storeback != nullptr && storeback->in_buffer((address_int >> log2_cacheLineSize))) {
-                        // If unconditional, then always flush. Otherwise, if yes, flush all contents of the buffer into the memory
-                        // NOTE: We can also flush the data with the same tag, while leaving the others,
-                        // but this overcomplicates the structure of the buffer and will not make it
-                        // FIFO again.
-                        while (!done_from_Mem->read()) {
-                            wait();
-                            wait(SC_ZERO_TIME);
-                            wait(SC_ZERO_TIME);
-                        }
+                    // the line is loaded into the victim of the set, a dirty victim has to be written back first
+                    line = tag_store.victim(address_int);
+                    if (writeBack && tag_store.is_dirty(line)) {
+                        write_back(line);
                     }
-                    valid_out->write(true);
 
+                    // Store-to-load forwarding: the entries of the line are not flushed, their bytes are taken from the buffer
+                    bool forwarding = storeback != nullptr && storeback->forwarding
+                        && storeback->pending((address_int >> log2_cacheLineSize));
 
-                    // Signal to RAM, then mark as valid propagation
-                    address_out->write(address->read()); 
-                    write_enable_out->write(write_enable->read());
-
-                    // Wait until RAM is done
-                    while (!done_from_Mem->read()) {
-                        wait();
-                        wait(SC_ZERO_TIME);
-                        wait(SC_ZERO_TIME);
+                    // the buffer holds the whole line, memory is not read
+                    if (forwarding && storeback->covers((address_int >> log2_cacheLineSize), address_int & ~(cacheLineSize - 1))) {
+                        forward_line(line, address_int);
+                        fill_tag(line, address_int);
+                        buffer_loads++;
                     }
-                    
-                    
-                    
-                    valid_out->write(false);
-
-                    
-                    
-                    // Write the data from RAM to the appropriate CacheLine
-                    // Data that is sent by RAM is a whole cacheLine
-                    for (unsigned i = 0; i < cacheLineSize; i++) {
-                        cache_blocks[index][i] = data_in_from_Mem->read()[i];
-                    }
-                    valid[index] = true; // set data is valid
-                    tags[index] = tag; // update tag
-
-                    
-                    //load the prefetched lines into cache
-                    if (prefetch != nullptr) {
-                        read_from_prefetch();
+                    else {
+                        load_line(line, address_int, forwarding);
                     }
-                    
                 }
 
-                //bring the read data back to L1
-                for (unsigned i = 0; i < 4; i++) {
-                    data_out_to_L1->read()[i] = cache_blocks[index][i];
-                }
+                //bring the read data back to L1 (a whole cacheLine)
+                reply_line(line);
             
             }
 
@@ -264,48 +451,574 @@ SC_MODULE(L2){
 
 
     /**
-     *@brief This method waits for the prefetch buffer to get the data and then load it into L2
-     * */
-    void read_from_prefetch() {
+     * @brief Read miss: flush the storeback buffer if needed, then load the line from memory into `line`
+     * @param forwarding The line has entries in the storeback buffer, their bytes are written over it (no flush for them)
+     */
+    void load_line(int line, unsigned int address_int, bool forwarding) {
+        // Selective flush: only wait until memory has written the entries of this line,
+        // the read then aborts the write of the next entry (see STOREBACK::pending())
+        if (storeback != nullptr && storeback->selective) {
+            if (storeback->flush_pending((address_int >> log2_cacheLineSize))) {
+                while (storeback->flush_pending((address_int >> log2_cacheLineSize))) {
+                    wait();
+                    wait(SC_ZERO_TIME);
+                    wait(SC_ZERO_TIME);
+                    flush_stalls++;
+                }
+                flush_end();
+            }
+        }
+
+        // If there is a storeback buffer -> check the tag and the address in the storeback buffer if the tag and address is there or not
+        else if (!forwarding && storeback != nullptr && storeback->in_buffer((address_int >> log2_cacheLineSize))) {
+            // If unconditional, then always flush. Otherwise, if yes, flush all contents of the buffer into the memory
+            // (--storeback-flush=line only waits for the entries of the line, see above)
+            while (!done_from_Mem->read()) {
+                wait();
+                wait(SC_ZERO_TIME);
+                wait(SC_ZERO_TIME);
+                flush_stalls++;
+            }
+            flush_end();
+        }
+
+        // memory may still signal the done of the last write of the storeback buffer
+        while (storeback != nullptr && done_from_Mem->read()) {
+            wait();
+        }
+
+        valid_out->write(true);
+
+        // Signal to RAM, then mark as valid propagation (memory reads the line from its first byte, like a prefetch)
+        address_out->write(address_int & ~(cacheLineSize - 1));
+        write_enable_out->write(write_enable->read());
+
+        // Wait until RAM is done
+        while (!done_from_Mem->read()) {
+            wait();
+            wait(SC_ZERO_TIME);
+            wait(SC_ZERO_TIME);
+        }
+
+        valid_out->write(false);
+
+        // Write the data from RAM to the appropriate CacheLine (the victim of the set)
+        // Data that is sent by RAM is a whole cacheLine
+        fill_line(line);
+        if (forwarding && forward_line(line, address_int)) {
+            forwarded_loads++;
+        }
+        fill_tag(line, address_int); // set data is valid, update tag
+    }
+
+    /**
+     * @brief End of a flush of the storeback buffer, before the read goes to memory
+     * @details the read must not take the done of the flush for its own, so wait until memory is ready again
+     */
+    void flush_end() {
+        while (done_from_Mem->read()) {
+            wait();
+            flush_stalls++;
+        }
+    }
+
+    /**
+     * @brief Load the prefetched lines that have arrived by now into the cache (see PREFETCH::pop())
+     */
+    void install_prefetched() {
+        if (prefetch == nullptr) return;
 
         char* data;
-        uint32_t address_u;
+        uint32_t address_new;
+        while (prefetch->pop(sc_time_stamp(), data, address_new)) {
+            //find the cache line for the new address (the line itself if it is already cached, else the victim),
+            //update its tag and mark it as valid
+            int line_new = prefetch_line(address_new);
+            if (line_new < 0) {
+                continue;
+            }
 
-        //check each line of prefetch
-        for (int i = 0; i < prefetch->capacity; i++) {
-            
-            // If no write was underway, then read from buffer. But if the buffer is empty, then
-            // memory has finished its task and will await further instructions.
+            // data is a slot of the prefetch buffer, nothing to free
+            load_prefetched(line_new, data);
+        }
+    }
 
-            while (!prefetch->read(data, address_u)) {
-                //wait until the prefetch has the data and address
+    /**
+     * @brief A read miss on a line that is on its way from a prefetch: wait until it arrives
+     * @return The cache line it was loaded into, -1 if it is not on its way (or was dropped, see prefetch_line())
+     */
+    int wait_prefetched(unsigned int address_int) {
+        sc_time ready;
+        if (prefetch == nullptr || !prefetch->arrival(address_int, ready)) return -1;
+
+        while (sc_time_stamp() < ready) {
+            wait();
+        }
+        late_prefetches++;
+        install_prefetched();
+        return tag_store.find(address_int);
+    }
+
+    /**
+     * @brief A write of the line to memory: a prefetch of it that is on its way has the old bytes (see PREFETCH::cancel())
+     */
+    void cancel_prefetch(uint32_t address_int) {
+        if (prefetch != nullptr) prefetch->cancel(address_int);
+    }
+
+    /**
+     * @brief The cache line a prefetched line is loaded into, -1 if it is dropped
+     * @details With write-back, the prefetched line would overwrite newer data if the line is already cached,
+     * and a dirty victim would have to be written back, so the prefetched line is dropped in both cases.
+     */
+    int prefetch_line(uint32_t address_new) {
+        prefetches++;
+        bool cached = tag_store.find(address_new) >= 0;
+
+        if (!writeBack) {
+            unsigned line_new = tag_store.insert(address_new);
+            if (!cached) prefetched[line_new] = 1;
+            return (int) line_new;
+        }
+
+        if (cached) return -1;
+        unsigned line_new = tag_store.victim(address_new);
+        if (tag_store.is_dirty(line_new)) return -1;
+
+        tag_store.fill(line_new, address_new);
+        prefetched[line_new] = 1;
+        return (int) line_new;
+    }
+
+    /**
+     * @brief Update the tag of a line that is loaded on demand (a read miss, or a line written back by L1)
+     */
+    void fill_tag(int line, uint32_t address_int) {
+        tag_store.fill(line, address_int);
+        prefetched[line] = 0;
+    }
+
+    /**
+     * @brief A read from L1: train the prefetcher (see PREFETCH::train()), a hit on a prefetched line made it useful
+     * @param line cache line holding the address, -1 on a miss
+     */
+    void prefetch_read(uint32_t address_int, int line) {
+        if (prefetch == nullptr) return;
+        prefetch->train(address_int);
+        if (line >= 0 && prefetched[line]) {
+            useful_prefetches++;
+            prefetched[line] = 0;
+        }
+    }
+
+    /**
+     * @brief Store a line written back by L1 (write-back, write-allocate)
+     *
+     * @param address_int address of the line
+     * @param line cache line holding the address, -1 on a miss
+     */
+    void write_back_from_L1(unsigned address_int, int line) {
+        if (line >= 0) {
+            tag_store.touch(line);
+        }
+        else {
+            // the line is complete, it only replaces the victim (which is written back if it is dirty)
+            line = tag_store.victim(address_int);
+            if (tag_store.is_dirty(line)) {
+                write_back(line);
+            }
+            fill_tag(line, address_int);
+        }
+
+        store_line(line);
+        tag_store.mark_dirty(line);
+    }
+
+    /**
+     * @brief Write a dirty cache line to memory, through the storeback buffer if there is one
+     * @details The handshake is the one of a write-through write in update().
+     * Without a storeback buffer, it also waits until memory is ready again.
+     */
+    void write_back(unsigned line) {
+        uint32_t line_address = tag_store.line_address(line);
+        writebacks++;
+        cancel_prefetch(line_address);
+
+        evict_line(line);
+
+        // Signal to RAM, then mark as valid propagation
+        address_out->write(line_address);
+        write_enable_out->write(true);
+        valid_out->write(true);
+
+        if (storeback != nullptr) {
+            copy_line(line);
+            while (!storeback->write(line_address, (line_address >> log2_cacheLineSize))) {
+                wait(SC_ZERO_TIME);
+                wait();
+            }
+            valid_out->write(false);
+        } else {
+            // Wait until RAM is done, mark as invalid propagation
+            while (!done_from_Mem->read()) {
                 wait();
                 wait(SC_ZERO_TIME);
                 wait(SC_ZERO_TIME);
             }
+            valid_out->write(false);
 
-            //store the address from the buffer
-            uint32_t address_new = address_u;
-            //calculate cache index for new addess
-            unsigned int index_new = ((address_new >> log2_cacheLineSize) & (power_of_two - 1)) % (l2CacheLines);;
-            //calculate cache tag for new address
-            unsigned int tag_new = address_new >> (log2_cacheLineSize + log2_l2CacheLines - (power_of_two != l2CacheLines));;
-            
-            // Write to memory
-            for (unsigned i = 0; i < cacheLineSize; i++) {
-                cache_blocks[index_new][i] = data[i];
+            while (done_from_Mem->read()) {
+                wait();
             }
+        }
+    }
+
+    /**
+     * @brief Wait for the next clock edge (and then n delta cycles), like wait() in update()
+     */
+    void wait_clock(State next, unsigned deltas = 0) {
+        state = next;
+        pending_deltas = deltas;
+        next_trigger();
+    }
 
-            //update the tag in the cache block of L2
-            tags[index_new] = tag_new;
-            //mark the block as valid
-            valid[index_new] = true;
+    /**
+     * @brief Wait for n delta cycles, like n times wait(SC_ZERO_TIME) in update()
+     */
+    void wait_delta(State next, unsigned deltas = 1) {
+        state = next;
+        pending_deltas = deltas - 1;
+        next_trigger(SC_ZERO_TIME);
+    }
 
-            // Free the pointer from data
-            delete[] data;
+    /**
+     * @brief update() as an SC_METHOD state machine (built with FSM_CONTROLLERS)
+     * @details
+     * Every wait() of update() is a next_trigger() here, and the state tells where to continue.
+     * The waits inside of STOREBACK::write() and wait_prefetched() are states as well,
+     * so the signals and buffers are accessed in the same delta cycles as in update().
+     */
+    void update_fsm() {
+        if (pending_deltas > 0) {
+            pending_deltas--;
+            next_trigger(SC_ZERO_TIME);
+            return;
+        }
+
+        while (true) {
+            switch (state) {
+            case RESET:
+                wait_clock(IDLE); // wait for next clk event
+                return;
+
+            case IDLE:
+                done->write(false);
+                hit->write(false);
+                wait_delta(WAIT_VALID, 2);
+                return;
+
+            case WAIT_VALID:
+                // wait until L1's signal is valid
+                if (!valid_in->read()) {
+                    wait_clock(WAIT_VALID, 1);
+                    return;
+                }
+
+                // extracts metadata bits from address - optimized (see L1)
+                address_int = address->read();
+                offset = address_int & (cacheLineSize - 1);
+
+                cycles_left = l2CacheLatency;
+                state = LATENCY;
+                break;
+
+            case LATENCY:
+                // Tags and data is only accessible after l2 latency cyles
+                if (cycles_left > 0) {
+                    cycles_left--;
+                    wait_clock(LATENCY);
+                    return;
+                }
+                state = ACCESS;
+                break;
+
+            case ACCESS:
+                // the prefetched lines that have arrived go into the cache first
+                install_prefetched();
+                line = tag_store.find(address_int);
+
+                // write-back: a whole line written back by L1 (see write_back_from_L1())
+                if (writeBack && write_enable->read()) {
+                    if (line >= 0) {
+                        tag_store.touch(line);
+                        state = WB_STORE;
+                        break;
+                    }
+                    line = tag_store.victim(address_int);
+                    evict_next = WB_INSTALL;
+                    state = tag_store.is_dirty(line) ? EVICT : WB_INSTALL;
+                }
+
+                // write operation
+                else if (write_enable->read()) {
+                    // a prefetch of the line that is on its way would be stale
+                    cancel_prefetch(address_int);
+
+                    // write hit, write through
+                    if (line >= 0) {
+                        hit->write(true);
+                        tag_store.touch(line);
+                        store_word(line, offset);
+                    }
+
+                    // no matter write miss or hit, continues to propagate to Memory
+                    forward_word();
+
+                    // Signal to RAM, then mark as valid propagation
+                    address_out->write(address->read());
+                    write_enable_out->write(write_enable->read());
+                    valid_out->write(true);
+
+                    if (storeback != nullptr) {
+                        copy_word();
+                        state = STOREBACK_WRITE;
+                    } else {
+                        state = WAIT_MEM_WRITE;
+                    }
+                }
+
+                // read: a miss on a line that is on its way from a prefetch waits for it (see wait_prefetched())
+                else {
+                    state = (line < 0 && prefetch != nullptr && prefetch->arrival(address_int, prefetch_ready))
+                        ? PREFETCH_WAIT : READ;
+                }
+                break;
+
+            case PREFETCH_WAIT:
+                if (sc_time_stamp() < prefetch_ready) {
+                    wait_clock(PREFETCH_WAIT);
+                    return;
+                }
+                late_prefetches++;
+                install_prefetched();
+                line = tag_store.find(address_int);
+                state = READ;
+                break;
+
+            case READ:
+                prefetch_read(address_int, line);
+
+                // read hit
+                if (line >= 0) {
+                    hit->write(true);
+                    tag_store.touch(line);
+                    state = REPLY;
+                }
+
+                // read miss, the line is loaded into the victim (written back first if it is dirty)
+                else {
+                    line = tag_store.victim(address_int);
+                    evict_next = MISS;
+                    state = (writeBack && tag_store.is_dirty(line)) ? EVICT : MISS;
+                }
+                break;
+
+            case MISS:
+                // take the line from the storeback buffer, or flush it first if needed (see update())
+                forwarding_line = storeback != nullptr && storeback->forwarding
+                    && storeback->pending((address_int >> log2_cacheLineSize));
+                if (forwarding_line && storeback->covers((address_int >> log2_cacheLineSize), address_int & ~(cacheLineSize - 1))) {
+                    forward_line(line, address_int);
+                    fill_tag(line, address_int);
+                    buffer_loads++;
+                    state = REPLY;
+                }
+                else if (storeback != nullptr && storeback->selective) {
+                    state = storeback->flush_pending((address_int >> log2_cacheLineSize)) ? FLUSH_LINE : READ_MEM;
+                }
+                else if (!forwarding_line && storeback != nullptr && storeback->in_buffer((address_int >> log2_cacheLineSize))) {
+                    state = FLUSH;
+                }
+                else {
+                    state = READ_MEM;
+                }
+                break;
+
+            case STOREBACK_WRITE:
+                storeback_address = address->read();
+                wait_delta(STOREBACK_PUSH, 2);
+                return;
+
+            case STOREBACK_PUSH:
+                if (storeback->push(storeback_address, (address_int >> log2_cacheLineSize))) {
+                    state = WRITE_END;
+                    break;
+                }
+                wait_delta(STOREBACK_FULL);
+                return;
+
+            case STOREBACK_FULL:
+                wait_clock(STOREBACK_RETRY);
+                return;
+
+            case STOREBACK_RETRY:
+                state = valid_in->read() ? STOREBACK_WRITE : WRITE_END;
+                break;
+
+            case WAIT_MEM_WRITE:
+                // Wait until RAM is done, mark as invalid propagation
+                if (!done_from_Mem->read()) {
+                    wait_clock(WAIT_MEM_WRITE, 2);
+                    return;
+                }
+                state = WRITE_END;
+                break;
+
+            case WRITE_END:
+                valid_out->write(false);
+                state = DONE;
+                break;
+
+            case FLUSH:
+                if (!done_from_Mem->read()) {
+                    flush_stalls++;
+                    wait_clock(FLUSH, 2);
+                    return;
+                }
+                state = FLUSH_END;
+                break;
+
+            case FLUSH_LINE:
+                if (storeback->flush_pending((address_int >> log2_cacheLineSize))) {
+                    flush_stalls++;
+                    wait_clock(FLUSH_LINE, 2);
+                    return;
+                }
+                state = FLUSH_END;
+                break;
+
+            case FLUSH_END:
+                if (done_from_Mem->read()) {
+                    flush_stalls++;
+                    wait_clock(FLUSH_END);
+                    return;
+                }
+                state = READ_MEM;
+                break;
+
+            case READ_MEM:
+                // memory may still signal the done of the last write of the storeback buffer
+                if (storeback != nullptr && done_from_Mem->read()) {
+                    wait_clock(READ_MEM);
+                    return;
+                }
+                valid_out->write(true);
+
+                // Signal to RAM, then mark as valid propagation (the first byte of the line, see load_line())
+                address_out->write(address_int & ~(cacheLineSize - 1));
+                write_enable_out->write(write_enable->read());
+                state = WAIT_MEM_READ;
+                break;
+
+            case WAIT_MEM_READ:
+                // Wait until RAM is done
+                if (!done_from_Mem->read()) {
+                    wait_clock(WAIT_MEM_READ, 2);
+                    return;
+                }
+                valid_out->write(false);
+
+                // Write the data from RAM to the appropriate CacheLine (the victim chosen in ACCESS)
+                fill_line(line);
+                if (forwarding_line && forward_line(line, address_int)) {
+                    forwarded_loads++;
+                }
+                fill_tag(line, address_int);
+                state = REPLY;
+                break;
+
+            case REPLY:
+                //bring the read data back to L1 (a whole cacheLine)
+                reply_line(line);
+                state = DONE;
+                break;
+
+            case WB_INSTALL:
+                fill_tag(line, address_int);
+                state = WB_STORE;
+                break;
+
+            case WB_STORE:
+                store_line(line);
+                tag_store.mark_dirty(line);
+                state = DONE;
+                break;
+
+            case EVICT:
+                // write the dirty victim to memory (see write_back())
+                evict_address = tag_store.line_address(line);
+                writebacks++;
+                cancel_prefetch(evict_address);
+
+                evict_line(line);
+
+                address_out->write(evict_address);
+                write_enable_out->write(true);
+                valid_out->write(true);
+
+                if (storeback != nullptr) {
+                    copy_line(line);
+                    state = EVICT_WRITE;
+                } else {
+                    state = EVICT_WAIT;
+                }
+                break;
+
+            case EVICT_WRITE:
+                wait_delta(EVICT_PUSH, 2);
+                return;
+
+            case EVICT_PUSH:
+                if (storeback->push(evict_address, (evict_address >> log2_cacheLineSize))) {
+                    valid_out->write(false);
+                    state = evict_next;
+                    break;
+                }
+                wait_delta(EVICT_FULL);
+                return;
+
+            case EVICT_FULL:
+                wait_clock(EVICT_WRITE);
+                return;
+
+            case EVICT_WAIT:
+                if (!done_from_Mem->read()) {
+                    wait_clock(EVICT_WAIT, 2);
+                    return;
+                }
+                valid_out->write(false);
+                state = EVICT_END;
+                break;
+
+            case EVICT_END:
+                // wait until memory is ready again
+                if (done_from_Mem->read()) {
+                    wait_clock(EVICT_END);
+                    return;
+                }
+                state = evict_next;
+                break;
+
+            case DONE:
+                done->write(true); // signal as done
+                wait_delta(DONE_WAIT, 2);
+                return;
+
+            case DONE_WAIT:
+                wait_clock(IDLE); // wait for next clk event
+                return;
+            }
         }
-        
-        return;
     }
 
     
@@ -0,0 +1,76 @@
+#ifndef CACHE_STATS_HPP
+#define CACHE_STATS_HPP
+
+#include "../main/simulator.hpp"
+
+/**
+ * @brief Builds the CacheStats of a single request
+ *
+ * @details
+ * Calculating the misses and hits
+ * l2_executes is true IFF the request has been propagated from L1 to L2
+
+ * 1. Misses:
+ *    - If L1 Hit: Misses = 0
+ *    - If L1 Miss: Miss = !(hit_L1) + (1 - hit_L2)
+ *
+ * 2. Hits:
+ *    - If L1 Hit: Hits = 1
+ *    - If L1 Miss: Hits = hit_L2
+ *
+ * @param cycle_count cycles needed for the request
+ * @param hit_L1 L1 hit
+ * @param l2_executes the request reached L2
+ * @param hit_L2 L2 hit (only counted if l2_executes)
+ * @param we write enable of the request
+ */
+inline CacheStats request_stats(size_t cycle_count, bool hit_L1, bool l2_executes, bool hit_L2, bool we) {
+    size_t hits = hit_L1 || (l2_executes && hit_L2);
+    size_t misses = 1 - hits;
+
+    CacheStats res = {
+        cycle_count, // cycles
+        misses, // misses
+        hits, // hits
+        0,
+        hits && !we,
+        misses && !we,
+        hits && we,
+        misses && we,
+        hit_L1 && !we,
+        (!hit_L1) && !we,
+        hit_L1 && we,
+        (!hit_L1) && we,
+        l2_executes && hit_L2 && !we,
+        l2_executes && (!hit_L2) && !we,
+        l2_executes && hit_L2 && we,
+        l2_executes && (!hit_L2) && we,
+    };
+    return res;
+}
+
+/**
+ * @brief updates the CacheStats
+ * @param count how many requests had these stats (see LOCKSTEP_L1_L2)
+ * @note ignores `primitiveGateCount`
+ * @author Lie Leon Alexius
+ */
+inline void statsUpdater(CacheStats* cacheStats, CacheStats tempStats, size_t count = 1) {
+    cacheStats->cycles += tempStats.cycles * count;
+    cacheStats->misses += tempStats.misses * count;
+    cacheStats->hits += tempStats.hits * count;
+    cacheStats->read_hits += tempStats.read_hits * count;
+    cacheStats->read_misses += tempStats.read_misses * count;
+    cacheStats->write_hits += tempStats.write_hits * count;
+    cacheStats->write_misses += tempStats.write_misses * count;
+    cacheStats->read_hits_L1 += tempStats.read_hits_L1 * count;
+    cacheStats->read_misses_L1 += tempStats.read_misses_L1 * count;
+    cacheStats->write_hits_L1 += tempStats.write_hits_L1 * count;
+    cacheStats->write_misses_L1 += tempStats.write_misses_L1 * count;
+    cacheStats->read_hits_L2 += tempStats.read_hits_L2 * count;
+    cacheStats->read_misses_L2 += tempStats.read_misses_L2 * count;
+    cacheStats->write_hits_L2 += tempStats.write_hits_L2 * count;
+    cacheStats->write_misses_L2 += tempStats.write_misses_L2 * count;
+}
+
+#endif
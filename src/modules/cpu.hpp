@@ -0,0 +1,178 @@
+#ifndef CPU_HPP
+#define CPU_HPP
+
+#include <systemc>
+
+#include "../main/simulator.hpp"
+#include "cache_stats.hpp"
+
+// using namespace directives won't get carried over.
+using namespace sc_core;
+using namespace std;
+
+/**
+ * @brief CPU issues a whole array of requests to L1 from inside of the simulation.
+ *
+ * @details
+ * With the CPU, the whole trace runs in a single sc_start() (see CPU_L1_L2::stream_requests()),
+ * instead of entering the SystemC kernel once per request.
+ *
+ * The CPU behaves exactly like CPU_L1_L2::send_request():
+ * 1. Requests are issued on clock boundaries, in the same delta cycle as the clock edge,
+ *    which is where the writes from outside of the kernel used to take effect.
+ * 2. The CPU sleeps until done_from_L1 rises (or the cycle budget is used up), then it
+ *    wakes up on the next clock boundary, collects the CacheStats and issues the next request.
+ * 3. A request that reaches L2 is detected by the rising valid_to_L2.
+ *
+ * After the last request (or when the budget is exceeded) the CPU pauses the simulation.
+ * The last request is finished from outside with finish_last_request(), so that the
+ * simulation stops exactly on the clock boundary, like the cycle by cycle loop does.
+ */
+SC_MODULE(CPU) {
+    sc_in<char*> data_out_to_L1;            // Data bus to L1 (4 Bytes)
+    sc_out<uint32_t> address;               // Address of the request
+    sc_out<bool> write_enable;              // Write-enable of the request
+    sc_out<bool> valid;                     // marks if the request on the bus is valid
+
+    sc_in<bool> done_from_L1;               // L1 finished the request
+    sc_in<bool> hit_from_L1;                // Hit flag of L1
+    sc_in<bool> hit_from_L2;                // Hit flag of L2
+    sc_in<bool> valid_to_L2;                // request propagated from L1 to L2
+
+    struct Request* requests = nullptr;     // Requests to be issued
+    size_t numRequests = 0;                 // Number of requests (stops earlier at .we == -1)
+    int cycles = 0;                         // Remaining cycle budget, -1 if exceeded
+
+    CacheStats* cacheStats = nullptr;       // Accumulated stats of all finished requests
+    bool forceTerminate = false;            // true if the budget has been exceeded
+
+    sc_time period;                         // clock period
+    sc_event start;                         // notified to start streaming the requests
+    bool l2_executes = false;               // valid_to_L2 has risen during the current request
+
+    // The last request, finished by finish_last_request()
+    struct Request last_request;
+    size_t last_cycle_count = 0;
+    sc_time last_end;                       // clock boundary at which the last request ends
+    bool last_pending = false;
+
+    SC_CTOR(CPU);
+    CPU(sc_module_name name, sc_time period) : sc_module(name), period(period) {
+        SC_THREAD(run);
+        sensitive << start;
+        dont_initialize();
+
+        SC_METHOD(on_valid_to_L2);
+        sensitive << valid_to_L2.pos();
+        dont_initialize();
+    }
+
+    void on_valid_to_L2() {
+        l2_executes = true;
+    }
+
+    /**
+     * @brief Put a request on the bus (same as the beginning of CPU_L1_L2::send_request())
+     */
+    void issue(struct Request request) {
+        uint32_t data_req = request.data;
+        for (int i = 0; i < 4; i++) {
+            data_out_to_L1->read()[i] = (char) (data_req & 0xFF);
+            data_req = data_req >> 8;
+        }
+
+        write_enable->write(request.we);
+        address->write(request.addr);
+        valid->write(true);
+        l2_executes = false;
+    }
+
+    /**
+     * @brief CacheStats of the request that has just finished, read on the clock boundary
+     */
+    CacheStats collect(struct Request request, size_t cycle_count) {
+        return request_stats(cycle_count, hit_from_L1->read(), l2_executes, hit_from_L2->read(), request.we);
+    }
+
+    /**
+     * @brief Issues the requests of every stream_requests() call (the streaming parser sends one batch per call)
+     */
+    void run() {
+        for (;;) {
+            issue_requests();
+            wait(); // for the next start
+        }
+    }
+
+    /**
+     * @brief Issues every request, one after another
+     */
+    void issue_requests() {
+        for (size_t i = 0; i < numRequests; i++) {
+            struct Request request = requests[i];
+
+            // If req.we == -1, end simulation
+            if (request.we == -1) break;
+
+            issue(request);
+            sc_time request_start = sc_time_stamp();
+
+            // Sleep until L1 is done, at most until the budget is used up
+            if (cycles > 0) {
+                wait(period * cycles, done_from_L1.posedge_event());
+            }
+            if (cycles <= 0 || timed_out()) {
+                cycles = -1;
+                forceTerminate = true;
+                sc_pause();
+
+                // only if the simulation goes on (CPU_L1_L2::reset()): finish the request on its clock boundary
+                if (!done_from_L1->read()) wait(done_from_L1.posedge_event());
+                size_t cycle_count = (size_t) ((sc_time_stamp() - request_start) / period) + 1;
+                wait(request_start + period * (double) cycle_count - sc_time_stamp());
+                valid->write(false);
+                return;
+            }
+
+            // done rose somewhere in the last cycle, the request ends on the next clock boundary
+            size_t cycle_count = (size_t) ((sc_time_stamp() - request_start) / period) + 1;
+            cycles -= (int) cycle_count;
+            sc_time request_end = request_start + period * (double) cycle_count;
+
+            // Last request: pause now, the simulation is finished up to the boundary from outside
+            if (i + 1 == numRequests || requests[i + 1].we == -1) {
+                last_request = request;
+                last_cycle_count = cycle_count;
+                last_end = request_end;
+                last_pending = true;
+                sc_pause();
+                wait(request_end - sc_time_stamp());
+                valid->write(false);
+                return;
+            }
+
+            wait(request_end - sc_time_stamp());
+            statsUpdater(cacheStats, collect(request, cycle_count));
+        }
+    }
+
+    /**
+     * @brief Forget the last run (see CPU_L1_L2::reset())
+     */
+    void reset() {
+        forceTerminate = false;
+        last_pending = false;
+        cycles = 0;
+    }
+
+    /**
+     * @brief Collect the stats of the last request, after the simulation reached the clock boundary
+     */
+    void finish_last_request() {
+        if (!last_pending) return;
+        statsUpdater(cacheStats, collect(last_request, last_cycle_count));
+        last_pending = false;
+    }
+};
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef EVENT_DRIVER_HPP
+#define EVENT_DRIVER_HPP
+
+#include <systemc>
+
+#include "../main/simulator.hpp"
+
+// using namespace directives won't get carried over.
+using namespace sc_core;
+using namespace std;
+
+/**
+ * @brief EVENT_DRIVER lets CPU_L1_L2 advance the simulation until a done flag rises,
+ * instead of calling sc_start() once per clock cycle.
+ *
+ * @details
+ * The driver runs sc_start() with the whole remaining cycle budget. As soon as the awaited
+ * done flag rises, the simulation is paused with sc_pause(). The cycles are then calculated
+ * from sc_time_stamp(), and the simulation is finished up to the next clock boundary, so
+ * that the state of all modules is exactly the same as with the cycle by cycle loop.
+ *
+ * Reminder: sc_start(period) processes the events at its start time, but not the events at its end time.
+ * So a flag that rises anywhere in [start + (k-1) * period, start + k * period) is seen after k steps.
+ */
+SC_MODULE(EVENT_DRIVER) {
+    sc_in<bool> done_from_L1;               // done flag of L1 (end of a request)
+    sc_in<bool> done_from_Memory;           // done flag of Memory (end of the queued writes)
+    sc_in<bool> valid_to_L2;                // request propagated from L1 to L2
+
+    bool awaiting_L1 = false;               // pause when done_from_L1 rises
+    bool awaiting_Memory = false;           // pause when done_from_Memory rises
+    bool done_seen = false;                 // the awaited flag has risen
+    bool l2_executes = false;               // valid_to_L2 has risen during the current request
+
+    sc_time period;                         // clock period
+
+    SC_CTOR(EVENT_DRIVER);
+    EVENT_DRIVER(sc_module_name name, sc_time period) : sc_module(name), period(period) {
+        SC_METHOD(on_done_from_L1);
+        sensitive << done_from_L1.pos();
+        dont_initialize();
+
+        SC_METHOD(on_done_from_Memory);
+        sensitive << done_from_Memory.pos();
+        dont_initialize();
+
+        SC_METHOD(on_valid_to_L2);
+        sensitive << valid_to_L2.pos();
+        dont_initialize();
+    }
+
+    void on_done_from_L1() {
+        if (awaiting_L1) {
+            done_seen = true;
+            sc_pause();
+        }
+    }
+
+    void on_done_from_Memory() {
+        if (awaiting_Memory) {
+            done_seen = true;
+            sc_pause();
+        }
+    }
+
+    void on_valid_to_L2() {
+        l2_executes = true;
+    }
+
+    /**
+     * @brief Run until done_from_L1 rises (same as `do { sc_start(period) } while (!done_from_L1)`)
+     *
+     * @param cycles Remaining cycle budget, set to -1 if the request does not finish in time
+     * @return The number of cycles the request took (0 if the budget is exceeded)
+     */
+    size_t run_until_L1_done(int &cycles) {
+        l2_executes = false;
+        awaiting_L1 = true;
+        size_t cycle_count = run_until_done(cycles);
+        awaiting_L1 = false;
+        return cycle_count;
+    }
+
+    /**
+     * @brief Run until done_from_Memory is set (same as `while (!done_from_Memory) sc_start(period)`)
+     *
+     * @param cycles Remaining cycle budget, set to -1 if the memory does not finish in time
+     * @return The number of cycles needed (0 if the budget is exceeded)
+     */
+    size_t run_until_Memory_done(int &cycles) {
+        if (done_from_Memory.read()) return 0;
+        awaiting_Memory = true;
+        size_t cycle_count = run_until_done(cycles);
+        awaiting_Memory = false;
+        return cycle_count;
+    }
+
+    /**
+     * @brief Run the simulation until the awaited flag rises or the budget is used up
+     */
+    size_t run_until_done(int &cycles) {
+        done_seen = false;
+
+        if (cycles <= 0) {
+            cycles = -1;
+            return 0;
+        }
+
+        sc_time start = sc_time_stamp();
+        sc_start(period * cycles);
+
+        if (!done_seen) {
+            cycles = -1;
+            return 0;
+        }
+
+        // Finish the cycle in which the flag has risen
+        size_t cycle_count = (size_t) ((sc_time_stamp() - start) / period) + 1;
+        sc_start(start + period * (double) cycle_count - sc_time_stamp());
+
+        cycles -= (int) cycle_count;
+        return cycle_count;
+    }
+};
+
+#endif
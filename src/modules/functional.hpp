@@ -0,0 +1,254 @@
+#ifndef FUNCTIONAL_HPP
+#define FUNCTIONAL_HPP
+
+#include <vector>
+
+#include "../main/simulator.hpp"
+#include "gate_count.hpp"
+#include "cache_stats.hpp"
+#include "tag_store.hpp"
+
+using namespace std;
+
+/**
+ * @brief FUNCTIONAL_L1_L2 is an untimed model of CPU_L1_L2 that bypasses SystemC.
+ *
+ * @details
+ * Same policies as L1 and L2: write-through, no-write-allocate, a read miss fills L2 and then L1.
+ * The tags and the replacement are the TAG_STORE of L1 and L2, so the same lines are replaced.
+ *
+ * Instead of running the clock, the cycles are calculated from the latencies.
+ * These are the exact cycle counts of the SystemC model:
+ * 1. L1 Read Hit: l1CacheLatency + 1
+ * 2. L1 Read Miss, L2 Read Hit: l1CacheLatency + l2CacheLatency + 1
+ * 3. L2 Read Miss: l1CacheLatency + l2CacheLatency + memoryLatency + 1
+ * 4. Write (Hit or Miss): l1CacheLatency + l2CacheLatency + memoryLatency + 1 (write-through)
+ *
+ * With writeBack (write-back, write-allocate), a write costs the same as a read of the address, and:
+ * 5. A dirty L1 victim is written back to L2 first: + l2CacheLatency + 2
+ * 6. Every dirty L2 victim is written to memory: + memoryLatency + 2
+ *
+ * @note Prefetch and storeback buffers are not modelled, their timing only exists in SystemC
+ */
+struct FUNCTIONAL_L1_L2 {
+
+    unsigned l1CacheLines;      // Number of cache lines in L1 cache
+    unsigned l2CacheLines;      // Number of cache lines in L2 cache
+    unsigned cacheLineSize;     // Size of each cache line
+
+    TAG_STORE l1;               // L1 tag store
+    TAG_STORE l2;               // L2 tag store
+
+    size_t l1HitCycles;         // cycles of an L1 hit
+    size_t l2HitCycles;         // cycles of an L1 miss that hits in L2
+    size_t memoryCycles;        // cycles of every request that goes to memory
+
+    bool writeBack;             // write-back, write-allocate instead of write-through
+    size_t l2WritebackCycles;   // extra cycles of a dirty L1 victim
+    size_t memoryWritebackCycles; // extra cycles of a dirty L2 victim
+    size_t writebacks_L1 = 0;   // dirty lines written back from L1 to L2
+    size_t writebacks_L2 = 0;   // dirty lines written back from L2 to memory
+
+    FUNCTIONAL_L1_L2(unsigned l1CacheLines, unsigned l2CacheLines, unsigned cacheLineSize,
+        unsigned l1CacheLatency, unsigned l2CacheLatency, unsigned memoryLatency,
+        unsigned l1Ways = 1, unsigned l2Ways = 1, Replacement replacement = REPLACEMENT_LRU, bool writeBack = false) :
+        l1CacheLines(l1CacheLines), l2CacheLines(l2CacheLines), cacheLineSize(cacheLineSize),
+        l1(cacheLineSize, l1CacheLines, l1Ways, replacement), l2(cacheLineSize, l2CacheLines, l2Ways, replacement),
+        writeBack(writeBack) {
+
+        l1HitCycles = outcome_cycles(l1CacheLatency, l2CacheLatency, memoryLatency, false, true, false);
+        l2HitCycles = outcome_cycles(l1CacheLatency, l2CacheLatency, memoryLatency, false, false, true);
+        memoryCycles = outcome_cycles(l1CacheLatency, l2CacheLatency, memoryLatency, false, false, false);
+        l2WritebackCycles = l2_writeback_cycles(l2CacheLatency);
+        memoryWritebackCycles = memory_writeback_cycles(memoryLatency);
+    }
+
+    /**
+     * @brief Cycles of a request from its outcome (1. to 6. above), for the models that only count outcomes
+     *
+     * @param writeBack With write-through every write goes to memory
+     * @param dirtyL1 Dirty L1 victims written back to L2 (write-back only)
+     * @param dirtyL2 Dirty L2 victims written to memory (write-back only)
+     */
+    static size_t outcome_cycles(unsigned l1CacheLatency, unsigned l2CacheLatency, unsigned memoryLatency,
+        bool we, bool hit_L1, bool hit_L2, bool writeBack = false, unsigned dirtyL1 = 0, unsigned dirtyL2 = 0) {
+        size_t l1HitCycles = (size_t) l1CacheLatency + 1;
+        size_t l2HitCycles = l1HitCycles + l2CacheLatency;
+        size_t memoryCycles = l2HitCycles + memoryLatency;
+
+        if (we && !writeBack) return memoryCycles;
+        return (hit_L1 ? l1HitCycles : hit_L2 ? l2HitCycles : memoryCycles)
+            + dirtyL1 * l2_writeback_cycles(l2CacheLatency) + dirtyL2 * memory_writeback_cycles(memoryLatency);
+    }
+
+    /**
+     * @brief Extra cycles of a dirty L1 victim (5. above)
+     */
+    static size_t l2_writeback_cycles(unsigned l2CacheLatency) {
+        return (size_t) l2CacheLatency + 2;
+    }
+
+    /**
+     * @brief Extra cycles of a dirty L2 victim (6. above)
+     */
+    static size_t memory_writeback_cycles(unsigned memoryLatency) {
+        return (size_t) memoryLatency + 2;
+    }
+
+    /**
+     * @brief Charge the cycles of a request to a cycle budget, the same budget as the SystemC model: one decrement per cycle
+     * @return false if the request does not fit, the budget is then unchanged
+     */
+    static bool charge_cycles(int &cycles, size_t cycle_count) {
+        if ((size_t) cycles < cycle_count) return false;
+        cycles -= (int) cycle_count;
+        return true;
+    }
+
+    /**
+     * @brief Send a request to the functional memory hierarchy
+     *
+     * @param request The request to send.
+     * @param cycles Remaining cycle budget, becomes negative if the request does not finish in time
+     * @return CacheStats of this request (same as CPU_L1_L2::send_request)
+     */
+    CacheStats send_request(struct Request request, int &cycles) {
+        if (writeBack) return send_request_write_back(request, cycles);
+
+        int line_L1 = l1.find(request.addr);
+        bool hit_L1 = line_L1 >= 0;
+        bool l2_executes = !hit_L1 || request.we;
+        int line_L2 = l2_executes ? l2.find(request.addr) : -1;
+        bool hit_L2 = line_L2 >= 0;
+        size_t cycle_count;
+
+        // hits count as a use for the replacement, in the same order as in the SystemC model
+        if (hit_L1) l1.touch(line_L1);
+        if (hit_L2) l2.touch(line_L2);
+
+        if (request.we) {
+            // write-through, no-write-allocate: no line is loaded
+            cycle_count = memoryCycles;
+        }
+        else if (hit_L1) {
+            cycle_count = l1HitCycles;
+        }
+        else if (hit_L2) {
+            cycle_count = l2HitCycles;
+            l1.fill(l1.victim(request.addr), request.addr);
+        }
+        else {
+            cycle_count = memoryCycles;
+            l2.fill(l2.victim(request.addr), request.addr);
+            l1.fill(l1.victim(request.addr), request.addr);
+        }
+
+        return finish_request(cycle_count, hit_L1, l2_executes, hit_L2, request.we, cycles);
+    }
+
+    /**
+     * @brief send_request() with the write-back, write-allocate policy
+     * @details The lines are replaced in the same order as in L1 and L2: the L1 victim is chosen first,
+     * then L2 stores the dirty L1 victim, and then L2 loads the requested line.
+     */
+    CacheStats send_request_write_back(struct Request request, int &cycles) {
+        int line_L1 = l1.find(request.addr);
+        bool hit_L1 = line_L1 >= 0;
+        bool hit_L2 = false;
+        size_t cycle_count = l1HitCycles;
+
+        if (hit_L1) {
+            l1.touch(line_L1);
+        }
+        else {
+            unsigned victim_L1 = l1.victim(request.addr);
+
+            // the dirty victim of L1 is written back to L2 (a whole line, no fetch needed)
+            if (l1.is_dirty(victim_L1)) {
+                uint32_t victim_address = l1.line_address(victim_L1);
+                int line_L2 = l2.find(victim_address);
+                writebacks_L1++;
+                cycle_count += l2WritebackCycles;
+
+                if (line_L2 >= 0) {
+                    l2.touch(line_L2);
+                }
+                else {
+                    line_L2 = l2.victim(victim_address);
+                    cycle_count += evict_L2(line_L2);
+                    l2.fill(line_L2, victim_address);
+                }
+                l2.mark_dirty(line_L2);
+            }
+
+            // load the line from L2, also on a write miss (write-allocate)
+            int line_L2 = l2.find(request.addr);
+            hit_L2 = line_L2 >= 0;
+            if (hit_L2) {
+                l2.touch(line_L2);
+                cycle_count += l2HitCycles - l1HitCycles;
+            }
+            else {
+                line_L2 = l2.victim(request.addr);
+                cycle_count += evict_L2(line_L2) + memoryCycles - l1HitCycles;
+                l2.fill(line_L2, request.addr);
+            }
+
+            line_L1 = victim_L1;
+            l1.fill(line_L1, request.addr);
+        }
+
+        if (request.we) l1.mark_dirty(line_L1);
+
+        return finish_request(cycle_count, hit_L1, !hit_L1, hit_L2, request.we, cycles);
+    }
+
+    /**
+     * @brief Cycles to write an L2 line to memory before it is replaced (0 if it is clean)
+     */
+    size_t evict_L2(unsigned line) {
+        if (!l2.is_dirty(line)) return 0;
+        writebacks_L2++;
+        return memoryWritebackCycles;
+    }
+
+    /**
+     * @brief Charge the cycles of a request to the budget and build its CacheStats
+     */
+    CacheStats finish_request(size_t cycle_count, bool hit_L1, bool l2_executes, bool hit_L2, bool we, int &cycles) {
+        if (!charge_cycles(cycles, cycle_count)) {
+            cycles = -1;
+            CacheStats res = {};
+            return res;
+        }
+
+        CacheStats res = request_stats(cycle_count, hit_L1, l2_executes, hit_L2, we);
+        return res;
+    }
+
+    /**
+     * @brief There are no queued memory writes without a storeback buffer
+     */
+    unsigned finish_memory(int &cycles) {
+        return 0;
+    }
+
+    /**
+     * @brief Empty both caches and the counters, the same state as after the constructor
+     */
+    void reset() {
+        l1.reset();
+        l2.reset();
+        writebacks_L1 = 0;
+        writebacks_L2 = 0;
+    }
+
+    /**
+     * @brief Same gate count as CPU_L1_L2 without buffers
+     */
+    size_t get_gate_count() {
+        return gate_count(l1CacheLines, l2CacheLines, cacheLineSize, 0, 0, l1.ways, l2.ways, l1.replacement, writeBack);
+    }
+};
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef GATE_COUNT_HPP
+#define GATE_COUNT_HPP
+
+#include <cstddef>
+
+#include "../main/simulator.hpp"
+#include "prefetcher.hpp"
+
+/**
+ * @brief log2() of a cache line size, equivalent as shifting n times (see L1)
+ */
+inline unsigned log2_line_size(unsigned cacheLineSize) {
+    unsigned result = 0;
+    while ((cacheLineSize >>= 1) > 0) {
+        result++;
+    }
+    return result;
+}
+
+/**
+ * @brief Number of index bits for a given number of cache lines, rounded up (see L1)
+ */
+inline unsigned log2_line_count(unsigned cacheLines) {
+    unsigned result = 0;
+    cacheLines -= 1;
+    while ((cacheLines >>= 1) > 0) {
+        result++;
+    }
+    return result + 1;
+}
+
+/**
+ * @brief Bits of replacement state per set of a cache
+ *
+ * @details
+ * 1. LRU: the age of every way, log2(ways) bits each
+ * 2. PLRU: one bit per node of the tree, ways - 1
+ * 3. FIFO: a pointer to the next way to replace, log2(ways) bits
+ * 4. RANDOM: nothing per set (one shared LFSR, see gate_count())
+ */
+inline unsigned replacement_bits(unsigned ways, Replacement replacement) {
+    if (ways <= 1) return 0;
+    unsigned log2_ways = log2_line_count(ways);
+    switch (replacement) {
+        case REPLACEMENT_PLRU: return ways - 1;
+        case REPLACEMENT_FIFO: return log2_ways;
+        case REPLACEMENT_RANDOM: return 0;
+        default: return ways * log2_ways;
+    }
+}
+
+/**
+ * Calculates the total number of gates required for the memory system.
+ *
+ * The gate count is calculated based on the number of gates required for the memory components,
+ * control components, and tag comparison components, without including RAM.
+ *
+ * @note Shared by every engine, so that the gate count does not depend on how the hierarchy is simulated
+ *
+ * A set-associative cache (ways > 1) decodes sets instead of lines, compares the tags of all ways
+ * in parallel, selects the hitting way with a multiplexer and stores the replacement state.
+ * With one way per set, the result is the same as for the direct-mapped caches.
+ *
+ * Write-back caches store a dirty bit per line, and the storeback buffer holds whole lines instead of 4 Bytes.
+ * A combining storeback buffer holds whole lines with a byte mask, and compares the tag of a write with every entry.
+ * A selective flush or store-to-load forwarding compares the tag of a read miss with every entry
+ * (the same comparators for all of them).
+ * The prefetch buffer compares the line of a read miss with every line on its way (see PREFETCH::arrival()).
+ * The stride and stream prefetchers store a table of PREFETCHER_TABLE_SIZE entries (region, last line, stride or
+ * direction, confidence, valid bit) and compare the region and the stride of a read with its entry.
+ *
+ * @return The total number of gates required for the memory system.
+ */
+inline size_t gate_count(
+    unsigned l1CacheLines, unsigned l2CacheLines, unsigned cacheLineSize,
+    unsigned storebackLines, unsigned prefetchLines,
+    unsigned l1Ways = 1, unsigned l2Ways = 1, Replacement replacement = REPLACEMENT_LRU,
+    bool writeBack = false, bool storebackCombining = false, bool selectiveFlush = false, bool storebackForwarding = false,
+    Prefetcher prefetcher = PREFETCHER_NEXTLINE
+)
+{
+    // Only for the "saving" part
+    // Each bit of memory consists of 6 CMOS Transistors (2 NOT Gates) -> 2
+    // Each line has the size of cacheLineSize bytes, Gataes = 2*cacheLineSize*8
+    // Each tag is a 32 bit integer -> 32 -> 64 gates for a line of tag
+    // For a line: 64 + 16*cacheLineSize
+    // l1CacheLines, l2CacheLines -> (l1CacheLines + l2CacheLines)*(64 + 16*cacheLineSize)
+
+    // Control part
+    // Multiplexers (to know which address to go to), comparators (for the tags)
+    //
+    //---------------------------------------------------------------------------------
+    // The index selects a set (= a line if direct-mapped)
+    unsigned l1Sets = l1CacheLines / l1Ways;
+    unsigned l2Sets = l2CacheLines / l2Ways;
+
+    unsigned log2_cacheLineSize = log2_line_size(cacheLineSize);
+    unsigned log2_l1CacheLines = log2_line_count(l1Sets);
+    unsigned log2_l2CacheLines = log2_line_count(l2Sets);
+
+    // For memory
+    unsigned gates_cache_line = 2*8*cacheLineSize;
+
+    unsigned gates_valid = 2;
+    unsigned gates_dirty = writeBack ? 2 : 0;
+    // Bits used for storing the tags
+    unsigned gates_l1_tags = (log2_cacheLineSize + log2_l1CacheLines)*2;
+    unsigned gates_l2_tags = (log2_cacheLineSize + log2_l2CacheLines)*2;
+
+    unsigned gates_l1_memory = (gates_cache_line + gates_l1_tags + gates_valid + gates_dirty)*l1CacheLines;
+    unsigned gates_l2_memory = (gates_cache_line + gates_l2_tags + gates_valid + gates_dirty)*l2CacheLines;
+
+    unsigned total_gates_for_memory = gates_l1_memory + gates_l2_memory;
+    //---------------------------------------------------------------------------------
+    // Address Latch Gates
+    unsigned address_latches = 4 * 32;
+
+
+    //---------------------------------------------------------------------------------
+    // For accessing a certain cell
+    // Predecoder are used to alleviate the logical effort in the decoder
+    unsigned predecoder_l1 = (log2_l1CacheLines + 2)/3 * 8;
+    unsigned predecoder_l2 = (log2_l2CacheLines + 2)/3 * 8;
+
+    unsigned decoder_l1 = l1Sets;
+    unsigned decoder_l2 = l2Sets;
+
+    // To get a certain column
+    unsigned multiplexer_l1_column = cacheLineSize;
+    unsigned multiplexer_l2_column = cacheLineSize;
+
+    // To select the hitting way of a set, one 2:1 multiplexer per bit of a line and way
+    unsigned multiplexer_l1_way = (l1Ways - 1) * 8 * cacheLineSize;
+    unsigned multiplexer_l2_way = (l2Ways - 1) * 8 * cacheLineSize;
+
+    unsigned total_addresser = predecoder_l1 + predecoder_l2 + decoder_l1 + decoder_l2 + multiplexer_l1_column + multiplexer_l2_column
+        + multiplexer_l1_way + multiplexer_l2_way;
+    //---------------------------------------------------------------------------------
+    // Comparison of tags:
+    // This comparator just needs to compare if the tag in the table and the tag
+    // from the address is the same. So it only uses AND Gates.
+    unsigned comparator_l1 = 32 - (log2_cacheLineSize + log2_l1CacheLines);
+    unsigned comparator_l2 = 32 - (log2_cacheLineSize + log2_l2CacheLines);
+
+    // The tags of all ways of a set are compared at the same time
+    unsigned total_comparator = comparator_l1 * l1Ways + comparator_l2 * l2Ways;
+
+    //---------------------------------------------------------------------------------
+    // Replacement state: 2 gates per bit (like the cache memory), and a 16 bit LFSR for RANDOM
+    unsigned replacement_l1 = 2 * replacement_bits(l1Ways, replacement) * l1Sets;
+    unsigned replacement_l2 = 2 * replacement_bits(l2Ways, replacement) * l2Sets;
+    unsigned lfsr_gates = 2 * 16 + 3;
+    unsigned lfsr_l1 = (l1Ways > 1 && replacement == REPLACEMENT_RANDOM) ? lfsr_gates : 0;
+    unsigned lfsr_l2 = (l2Ways > 1 && replacement == REPLACEMENT_RANDOM) ? lfsr_gates : 0;
+
+    unsigned total_replacement = replacement_l1 + replacement_l2 + lfsr_l1 + lfsr_l2;
+
+    //---------------------------------------------------------------------------------
+    // Buffer
+    unsigned storeback_entry = (writeBack || storebackCombining) ? cacheLineSize : 4;
+    unsigned storeback_mask = storebackCombining ? cacheLineSize / 8 : 0;
+    unsigned storeback_gates = (32 + storeback_entry + storeback_mask) * 4 * storebackLines;
+    unsigned prefetch_gates = (32 + cacheLineSize) * 4 * prefetchLines;
+
+    // The table of the stride and stream prefetchers (next-line only adds to the address of the miss)
+    unsigned prefetcher_gates = 0;
+    if (prefetchLines != 0 && prefetcher != PREFETCHER_NEXTLINE) {
+        unsigned region_bits = 32 - PREFETCHER_REGION_BITS;
+        unsigned line_bits = 32 - log2_cacheLineSize;
+        unsigned stride_bits = (prefetcher == PREFETCHER_STRIDE) ? line_bits : 1;
+        prefetcher_gates = 2 * (region_bits + line_bits + stride_bits + 2 + 1) * PREFETCHER_TABLE_SIZE;
+        total_comparator += region_bits + stride_bits;
+    }
+
+    unsigned total_buffer_gate = storeback_gates + prefetch_gates + prefetcher_gates;
+
+    // Add comparator for write buffers
+    total_comparator += ((prefetchLines != 0) ? comparator_l2 : 0);
+    // The prefetch buffer compares the line of a read miss (or a write) with every line on its way
+    total_comparator += (32 - log2_cacheLineSize) * prefetchLines;
+    // A combining storeback buffer compares the line of a write (address without the offset) with every entry,
+    // a selective flush or forwarding the line of a read miss
+    total_comparator += ((storebackCombining || selectiveFlush || storebackForwarding)
+        ? (32 - log2_cacheLineSize) * storebackLines : 0);
+
+
+    return total_gates_for_memory + total_addresser + address_latches + total_comparator + total_buffer_gate + total_replacement;
+}
+
+#endif
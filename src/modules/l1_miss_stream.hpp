@@ -0,0 +1,165 @@
+#ifndef L1_MISS_STREAM_HPP
+#define L1_MISS_STREAM_HPP
+
+#include <vector>
+
+#include "../main/simulator.hpp"
+#include "gate_count.hpp"
+#include "cache_stats.hpp"
+#include "tag_store.hpp"
+#include "lockstep.hpp"
+#include "functional.hpp"
+
+using namespace std;
+
+/**
+ * @brief L1_MISS_STREAM is the part of the requests that reaches L2, recorded once for an L1 geometry.
+ *
+ * @details
+ * L1 is write-through and no-write-allocate, so whether a request reaches L2 only depends on the requests
+ * and on L1 (its line size, lines, ways and replacement), never on L2:
+ * 1. Reads that miss in L1 go to L2 (and then fill L1)
+ * 2. Writes always go to L2, L1 is only checked (write hit or miss)
+ * 3. Reads that hit in L1 stay in L1, they are only counted (l1HitsBefore of the next entry)
+ *
+ * Replaying the stream (see L2_REPLAY) gives every L2 the same requests in the same order as
+ * FUNCTIONAL_L1_L2, for any L2 and any latencies, without simulating L1 again.
+ * For kernels with a lot of L1 hits, the stream is much shorter than the requests.
+ */
+struct L1_MISS_STREAM {
+
+    /**
+     * @brief A request that reaches L2
+     */
+    struct Entry {
+        uint32_t addr;          // address of the request
+        uint32_t l1HitsBefore;  // L1 read hits since the previous entry
+        bool we;                // write (true) or read miss (false)
+        bool hit_L1;            // writes: the line was in L1
+    };
+
+    vector<Entry> entries;      // requests that reach L2, in order
+    size_t l1HitsAfter = 0;     // L1 read hits after the last entry
+    size_t numRequests = 0;     // requests recorded (entries + L1 read hits)
+
+    /**
+     * @brief Records the requests (until the `.we = -1` marker) with an L1 like FUNCTIONAL_L1_L2
+     */
+    L1_MISS_STREAM(unsigned l1CacheLines, unsigned cacheLineSize, unsigned l1Ways, Replacement replacement,
+        size_t numRequests, const struct Request* requests) {
+        TAG_STORE l1(cacheLineSize, l1CacheLines, l1Ways, replacement);
+        size_t hits = 0;
+
+        for (size_t i = 0; i < numRequests && requests[i].we != -1; i++) {
+            struct Request request = requests[i];
+            int line = l1.find(request.addr);
+            if (line >= 0) l1.touch(line);
+            this->numRequests++;
+
+            if (line >= 0 && !request.we) {
+                hits++;
+                continue;
+            }
+
+            // reads miss and fill L1 (after L2, which does not change L1), writes load no line
+            if (!request.we) l1.fill(l1.victim(request.addr), request.addr);
+
+            // more than 2^32 - 1 hits in a row are split with an entry that is not sent to L2 (see L2_REPLAY)
+            while (hits > UINT32_MAX) {
+                entries.push_back({0, UINT32_MAX, false, true});
+                hits -= UINT32_MAX;
+            }
+            entries.push_back({request.addr, (uint32_t) hits, (bool) request.we, line >= 0});
+            hits = 0;
+        }
+        l1HitsAfter = hits;
+    }
+};
+
+/**
+ * @brief L2_REPLAY sends an L1_MISS_STREAM to an L2 and counts the cycles and CacheStats of FUNCTIONAL_L1_L2.
+ *
+ * @details
+ * The cycles of a request are the ones of FUNCTIONAL_L1_L2 (write-through). The L1 read hits between two
+ * entries are charged one by one to the cycle budget, so the simulation stops at the same request as
+ * FUNCTIONAL_L1_L2 if the budget runs out. Like LOCKSTEP_L1_L2, only the outcomes are counted.
+ */
+struct L2_REPLAY {
+
+    TAG_STORE l2;               // L2 tag store
+
+    size_t outcomeCycles[LOCKSTEP_OUTCOMES]; // cycles of every outcome (see LOCKSTEP_L1_L2::outcome())
+    size_t outcomes[LOCKSTEP_OUTCOMES] = {}; // number of requests of every outcome (see LOCKSTEP_L1_L2::outcome())
+
+    L2_REPLAY(unsigned l2CacheLines, unsigned cacheLineSize, unsigned l1CacheLatency, unsigned l2CacheLatency,
+        unsigned memoryLatency, unsigned l2Ways = 1, Replacement replacement = REPLACEMENT_LRU) :
+        l2(cacheLineSize, l2CacheLines, l2Ways, replacement) {
+
+        // same cycles as FUNCTIONAL_L1_L2 (write-through)
+        for (unsigned code = 0; code < LOCKSTEP_OUTCOMES; code++) {
+            bool we = code & 4, hit_L1 = code & 2, hit_L2 = code & 1;
+            outcomeCycles[code] = FUNCTIONAL_L1_L2::outcome_cycles(l1CacheLatency, l2CacheLatency, memoryLatency, we, hit_L1, hit_L2);
+        }
+    }
+
+    /**
+     * @brief Charges `count` L1 read hits to the budget
+     * @return false if the budget ran out (the hits that still fit are counted)
+     */
+    bool l1_hits(size_t count, int &cycles) {
+        unsigned code = LOCKSTEP_L1_L2::outcome(false, true, false);
+        size_t l1HitCycles = outcomeCycles[code];
+        size_t fit = (size_t) cycles / l1HitCycles;
+        bool finished = fit >= count;
+        if (!finished) count = fit;
+
+        cycles -= (int) (count * l1HitCycles);
+        outcomes[code] += count;
+        return finished;
+    }
+
+    /**
+     * @brief Replays the stream
+     *
+     * @param stream The requests that reach L2.
+     * @param cycles The number of cycles for the simulation.
+     * @param cacheStats The CacheStats to be updated (cycles = SIZE_MAX if the budget ran out).
+     */
+    void run(const L1_MISS_STREAM& stream, int cycles, CacheStats* cacheStats) {
+        bool finished = replay(stream, cycles);
+        for (unsigned code = 0; code < LOCKSTEP_OUTCOMES; code++) {
+            bool we = code & 4, hit_L1 = code & 2, hit_L2 = code & 1;
+            statsUpdater(cacheStats, request_stats(outcomeCycles[code], hit_L1, !hit_L1 || we, hit_L2, we), outcomes[code]);
+        }
+
+        // if forced to stop, cycles need to be SIZE_MAX
+        if (!finished) {
+            cacheStats->cycles = SIZE_MAX;
+        }
+    }
+
+    /**
+     * @brief Counts the outcomes of the stream
+     * @return false if the budget ran out
+     */
+    bool replay(const L1_MISS_STREAM& stream, int cycles) {
+        for (const L1_MISS_STREAM::Entry& entry : stream.entries) {
+            if (!l1_hits(entry.l1HitsBefore, cycles)) return false;
+            // only splits a long run of L1 hits
+            if (!entry.we && entry.hit_L1) continue;
+
+            int line = l2.find(entry.addr);
+            bool hit_L2 = line >= 0;
+            if (hit_L2) l2.touch(line);
+
+            if (!entry.we && !hit_L2) l2.fill(l2.victim(entry.addr), entry.addr);
+
+            unsigned code = LOCKSTEP_L1_L2::outcome(entry.we, entry.hit_L1, hit_L2);
+            if (!FUNCTIONAL_L1_L2::charge_cycles(cycles, outcomeCycles[code])) return false;
+            outcomes[code]++;
+        }
+        return l1_hits(stream.l1HitsAfter, cycles);
+    }
+};
+
+#endif
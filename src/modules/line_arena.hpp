@@ -0,0 +1,74 @@
+#ifndef LINE_ARENA_HPP
+#define LINE_ARENA_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+using namespace std;
+
+// Alignment of the first line of a LINE_ARENA (a host cache line)
+#define LINE_ARENA_ALIGNMENT 64
+
+/**
+ * @brief LINE_ARENA holds the data of every cache line of L1 or L2 in a single block of memory.
+ *
+ * @details
+ * Line `i` starts at byte `i * cacheLineSize`, the first line is aligned to LINE_ARENA_ALIGNMENT bytes.
+ * Before, every line was a vector<char> of its own: one allocation per line when the cache is built,
+ * and a pointer to follow before every access.
+ *
+ * `arena[line][i]` is byte i of the line, the same as with the old vector<vector<char>>.
+ * The tags and valid bits are not here, they stay in TAG_STORE, so that a lookup only touches the tags.
+ */
+struct LINE_ARENA {
+
+    vector<char> storage;       // the lines, plus room to align the first one
+    char* base = nullptr;       // first byte of line 0
+    size_t lineSize = 0;        // bytes per line
+    size_t lines = 0;           // number of lines
+
+    LINE_ARENA() {}
+
+    LINE_ARENA(size_t lines, size_t lineSize) {
+        resize(lines, lineSize);
+    }
+
+    // base points into storage
+    LINE_ARENA(const LINE_ARENA&) = delete;
+    LINE_ARENA& operator=(const LINE_ARENA&) = delete;
+
+    /**
+     * @brief `lines` zeroed lines of `lineSize` bytes
+     */
+    void resize(size_t lines, size_t lineSize) {
+        this->lines = lines;
+        this->lineSize = lineSize;
+        storage.assign(lines * lineSize + LINE_ARENA_ALIGNMENT, 0);
+
+        uintptr_t address = (uintptr_t) storage.data();
+        base = storage.data() + ((LINE_ARENA_ALIGNMENT - address % LINE_ARENA_ALIGNMENT) % LINE_ARENA_ALIGNMENT);
+    }
+
+    /**
+     * @brief first byte of a line
+     */
+    char* operator[](size_t line) {
+        return base + line * lineSize;
+    }
+
+    const char* operator[](size_t line) const {
+        return base + line * lineSize;
+    }
+
+    /**
+     * @brief zero every line (nothing to do if the arena was never sized)
+     */
+    void clear() {
+        if (base == nullptr) return;
+        memset(base, 0, lines * lineSize);
+    }
+};
+
+#endif
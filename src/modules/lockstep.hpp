@@ -0,0 +1,205 @@
+#ifndef LOCKSTEP_HPP
+#define LOCKSTEP_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include "../main/simulator.hpp"
+#include "gate_count.hpp"
+#include "cache_stats.hpp"
+#include "functional.hpp"
+
+using namespace std;
+
+// Outcomes of a request in LOCKSTEP_L1_L2: read or write, L1 hit, L2 hit
+#define LOCKSTEP_OUTCOMES 8
+
+/**
+ * @brief LOCKSTEP_L1_L2 simulates several direct-mapped, write-through FUNCTIONAL_L1_L2 in one pass.
+ *
+ * @details
+ * Every request is read once and stepped through all configurations before the next one, so the
+ * requests are only loaded once, however many configurations there are.
+ *
+ * Structure of arrays: each parameter of the configurations is an array with one entry per configuration,
+ * and the tags and valid bits of all configurations are one array each (configuration k owns the
+ * lines l1Base[k] .. l1Base[k] + l1 lines - 1). A request is processed in two loops:
+ * 1. lookup(): the set, the tag and the tag check of every configuration, without branches,
+ *    so that the compiler can vectorize it across the configurations
+ * 2. update(): the fills and the cycles of every configuration, same policy and cycles as FUNCTIONAL_L1_L2
+ *
+ * Sets and tags are the ones of TAG_STORE with one way. The index is below 2 * sets, so the `% sets`
+ * of a set count that is not a power of two is a conditional subtraction.
+ *
+ * The cycles and stats of a request only depend on its outcome (read or write, L1 hit, L2 hit), so every
+ * configuration only counts the outcomes, and cache_stats() builds its CacheStats from the counts.
+ * Every configuration has its own cycle budget, a configuration that exceeds its budget stops counting
+ * (cycles = SIZE_MAX) while the others go on.
+ *
+ * @note Set-associative and write-back caches need the replacement state of TAG_STORE, use FUNCTIONAL_L1_L2
+ */
+struct LOCKSTEP_L1_L2 {
+
+    size_t numConfigs;              // Number of configurations
+
+    // Geometry per configuration
+    vector<uint32_t> lineShift;     // log2(cacheLineSize) of L1 and L2
+    vector<uint32_t> l1IndexMask;   // 2^log2(sets) - 1
+    vector<uint32_t> l1Sets;        // number of sets (= lines)
+    vector<uint32_t> l1TagShift;    // offset bits + index bits
+    vector<uint32_t> l1Base;        // first line of the configuration in l1Tags / l1Valid
+    vector<uint32_t> l2IndexMask;
+    vector<uint32_t> l2Sets;
+    vector<uint32_t> l2TagShift;
+    vector<uint32_t> l2Base;
+
+    // Tags and valid bits of all configurations
+    vector<uint32_t> l1Tags;
+    vector<uint8_t> l1Valid;
+    vector<uint32_t> l2Tags;
+    vector<uint8_t> l2Valid;
+
+    // Cycles and number of requests of every outcome, LOCKSTEP_OUTCOMES per configuration (see outcome())
+    vector<size_t> outcomeCycles;
+    vector<size_t> outcomes;
+
+    // Results of lookup() for update()
+    vector<uint32_t> l1Line;
+    vector<uint32_t> l2Line;
+    vector<uint8_t> hitL1;
+    vector<uint8_t> hitL2;
+
+    vector<int> budget;             // remaining cycles, negative once exceeded
+
+    /**
+     * @brief The configurations are given as arrays of numConfigs entries
+     */
+    LOCKSTEP_L1_L2(size_t numConfigs, const unsigned* l1CacheLines, const unsigned* l2CacheLines, const unsigned* cacheLineSize,
+        const unsigned* l1CacheLatency, const unsigned* l2CacheLatency, const unsigned* memoryLatency, int cycles) :
+        numConfigs(numConfigs), lineShift(numConfigs), l1IndexMask(numConfigs), l1Sets(numConfigs), l1TagShift(numConfigs),
+        l1Base(numConfigs), l2IndexMask(numConfigs), l2Sets(numConfigs), l2TagShift(numConfigs), l2Base(numConfigs),
+        outcomeCycles(numConfigs * LOCKSTEP_OUTCOMES), outcomes(numConfigs * LOCKSTEP_OUTCOMES),
+        l1Line(numConfigs), l2Line(numConfigs), hitL1(numConfigs), hitL2(numConfigs),
+        budget(numConfigs, cycles) {
+
+        size_t l1Total = 0, l2Total = 0;
+        for (size_t k = 0; k < numConfigs; k++) {
+            lineShift[k] = log2_line_size(cacheLineSize[k]);
+            set_geometry(l1CacheLines[k], lineShift[k], l1IndexMask[k], l1Sets[k], l1TagShift[k]);
+            set_geometry(l2CacheLines[k], lineShift[k], l2IndexMask[k], l2Sets[k], l2TagShift[k]);
+            l1Base[k] = l1Total;
+            l2Base[k] = l2Total;
+            l1Total += l1CacheLines[k];
+            l2Total += l2CacheLines[k];
+
+            // same cycles as FUNCTIONAL_L1_L2 (write-through)
+            for (unsigned code = 0; code < LOCKSTEP_OUTCOMES; code++) {
+                bool we = code & 4, hit_L1 = code & 2, hit_L2 = code & 1;
+                outcomeCycles[k * LOCKSTEP_OUTCOMES + code] = FUNCTIONAL_L1_L2::outcome_cycles(
+                    l1CacheLatency[k], l2CacheLatency[k], memoryLatency[k], we, hit_L1, hit_L2);
+            }
+        }
+
+        l1Tags.resize(l1Total);
+        l1Valid.resize(l1Total);
+        l2Tags.resize(l2Total);
+        l2Valid.resize(l2Total);
+    }
+
+    /**
+     * @brief Index mask, sets and tag shift of a direct-mapped cache (see TAG_STORE)
+     */
+    static void set_geometry(unsigned cacheLines, unsigned shift, uint32_t& indexMask, uint32_t& sets, uint32_t& tagShift) {
+        unsigned log2_sets = log2_line_count(cacheLines);
+        unsigned power_of_two = 1u << log2_sets;
+        indexMask = power_of_two - 1;
+        sets = cacheLines;
+        tagShift = shift + log2_sets - (power_of_two != cacheLines);
+    }
+
+    /**
+     * @brief Sets and tag checks of the address in every configuration
+     */
+    void lookup(uint32_t address) {
+        for (size_t k = 0; k < numConfigs; k++) {
+            uint32_t index1 = (address >> lineShift[k]) & l1IndexMask[k];
+            uint32_t index2 = (address >> lineShift[k]) & l2IndexMask[k];
+            index1 -= (index1 >= l1Sets[k]) ? l1Sets[k] : 0;
+            index2 -= (index2 >= l2Sets[k]) ? l2Sets[k] : 0;
+
+            uint32_t line1 = l1Base[k] + index1;
+            uint32_t line2 = l2Base[k] + index2;
+            l1Line[k] = line1;
+            l2Line[k] = line2;
+            hitL1[k] = l1Valid[line1] & (l1Tags[line1] == (address >> l1TagShift[k]));
+            hitL2[k] = l2Valid[line2] & (l2Tags[line2] == (address >> l2TagShift[k]));
+        }
+    }
+
+    /**
+     * @brief Outcome of a request: 4 * write + 2 * L1 hit + L2 hit (the L2 hit only counts if the request reached L2)
+     */
+    static unsigned outcome(bool we, bool hit_L1, bool hit_L2) {
+        return (we << 2) | (hit_L1 << 1) | (hit_L2 && (!hit_L1 || we));
+    }
+
+    /**
+     * @brief Fills and cycles of the request in every configuration (see FUNCTIONAL_L1_L2::send_request())
+     */
+    void update(struct Request request) {
+        bool we = request.we;
+        for (size_t k = 0; k < numConfigs; k++) {
+            if (budget[k] < 0) continue;
+
+            unsigned code = outcome(we, hitL1[k], hitL2[k]);
+            size_t cycle_count = outcomeCycles[k * LOCKSTEP_OUTCOMES + code];
+
+            // a read miss fills L2 (if it missed there as well) and then L1, writes load no line
+            if (!we && !hitL1[k]) {
+                if (!(code & 1)) {
+                    l2Valid[l2Line[k]] = true;
+                    l2Tags[l2Line[k]] = request.addr >> l2TagShift[k];
+                }
+                l1Valid[l1Line[k]] = true;
+                l1Tags[l1Line[k]] = request.addr >> l1TagShift[k];
+            }
+
+            if (!FUNCTIONAL_L1_L2::charge_cycles(budget[k], cycle_count)) {
+                budget[k] = -1;
+                continue;
+            }
+            outcomes[k * LOCKSTEP_OUTCOMES + code]++;
+        }
+    }
+
+    /**
+     * @brief Sends the requests to every configuration, until the `.we = -1` marker
+     */
+    void run(size_t numRequests, const struct Request* requests) {
+        for (size_t i = 0; i < numRequests && requests[i].we != -1; i++) {
+            lookup(requests[i].addr);
+            update(requests[i]);
+        }
+    }
+
+    /**
+     * @brief CacheStats of a configuration, the same as FUNCTIONAL_L1_L2 would have counted
+     * @note primitiveGateCount is not set
+     */
+    CacheStats cache_stats(size_t k) const {
+        CacheStats cacheStats = {};
+        for (unsigned code = 0; code < LOCKSTEP_OUTCOMES; code++) {
+            bool we = code & 4, hit_L1 = code & 2, hit_L2 = code & 1;
+            CacheStats requestStats = request_stats(outcomeCycles[k * LOCKSTEP_OUTCOMES + code], hit_L1, !hit_L1 || we, hit_L2, we);
+            statsUpdater(&cacheStats, requestStats, outcomes[k * LOCKSTEP_OUTCOMES + code]);
+        }
+
+        // if forced to stop, cycles need to be SIZE_MAX
+        if (budget[k] < 0) {
+            cacheStats.cycles = SIZE_MAX;
+        }
+        return cacheStats;
+    }
+};
+
+#endif
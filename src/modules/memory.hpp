@@ -5,10 +5,12 @@
 
 #ifdef __cplusplus // added #ifdef __cplusplus so that it works as a c header - anthony
 #include <systemc>
+#include <algorithm>
 
 #include "../main/simulator.hpp" // the struct moved here - Leon
 #include "storeback_buffer.hpp"
 #include "prefetch_buffer.hpp"
+#include "sparse_memory.hpp"
 
 // using namespace directives won't get carried over. 
 using namespace sc_core;
@@ -19,13 +21,14 @@ using namespace std;
  * @details MEMORY handles read and write operations directly from L2 cache.
  * 
  * @note 
- * memory_blocks[] cover all possible memory address, not just 1_000_000 (1 MB)
+ * memory_blocks cover all possible memory address, not just 1_000_000 (1 MB)
  * Assume that address is 0x0000.0000 till 0xFFFF.FFFF (4_294_967_295)
+ * Only the 4 KiB pages that are written to are allocated (see SPARSE_MEMORY)
  *
  * @author Alexander Anthony Tang
  */
 SC_MODULE(MEMORY) {
-    sc_in<char*> data_in_from_L2;       // Data input from L2 cache for write (4 Bytes)
+    sc_in<char*> data_in_from_L2;       // Data input from L2 cache for write (writeSize Bytes)
     sc_in<char*> data_out_to_L2;        // Data output to L2 cache for read (cacheLineSize Bytes)  
     sc_in<uint32_t> address;            // Address input for read/write operations
     sc_in<bool> write_enable;           // Write-enable signal for a write operation
@@ -38,12 +41,50 @@ SC_MODULE(MEMORY) {
     PREFETCH* prefetch;
 
 
-    char memory_blocks[4294967296];     // Memory blocks represented by an array of char
+    SPARSE_MEMORY memory_blocks;        // Memory blocks, pages are allocated on first write
     unsigned int latency;               // Latency of memory in clock cycles
 
     unsigned int cacheLineSize;         // Size of each cache line
+    unsigned int writeSize;             // Bytes per write: 4 (write-through) or a whole cache line (write-back)
+    bool timingOnly;                    // no data: nothing is read, written or allocated (memory_blocks stays empty)
     bool write_underway = false;
+    bool aborted = false;               // temp holds a write that was aborted by a read
     char* temp = nullptr;
+    uint32_t temp_address = 0;          // address of the aborted write in temp
+    size_t aborted_writes = 0;          // writes of the storeback buffer aborted by a read (and started again)
+    size_t aborted_cycles = 0;          // latency cycles of those writes before they were aborted
+
+    /**
+     * @brief States of update_fsm(), each one is a place where update() waits
+     */
+    enum State {
+        RESET,              // before the first clock edge
+        IDLE,               // top of the loop in update()
+        CLEAR,              // mark as not done
+        WAIT_VALID,         // waiting for a valid request from L2 (or a write underway)
+        READ_LATENCY,       // waiting latency cycles before a read
+        READ,               // load the cache line to the bus
+        READ_DONE,          // the read is done, start the prefetches
+        AFTER_READ,         // continue the write underway
+        WRITE_LATENCY,      // waiting latency cycles before a write (no storeback buffer)
+        WRITE,              // write to memory (no storeback buffer)
+        FLUSH,              // write_from_buffer()
+        FLUSH_NEXT,         // write_from_buffer(), next write
+        FLUSH_POP,          // storeback->read(), reading from the buffer
+        FLUSH_RELEASE,      // storeback->read(), the read was successful
+        FLUSH_LATENCY,      // write_from_buffer(), waiting latency cycles
+        FLUSH_CHECK,        // write_from_buffer(), abort if L2 issues a read
+        FLUSH_WRITE         // write_from_buffer(), write to memory
+    };
+
+    State state = RESET;                // current state of update_fsm()
+    unsigned pending_deltas = 0;        // delta cycles left before the current state runs
+    unsigned cycles_left = 0;           // clock cycles left in the LATENCY states
+
+    // The request being processed by update_fsm()
+    uint32_t request_address = 0;       // address of the request
+    char* flush_data = nullptr;         // write from the storeback buffer
+    uint32_t flush_address = 0;         // address of flush_data
 
 
    /**
@@ -52,14 +93,80 @@ SC_MODULE(MEMORY) {
     * @param name Name of the module.
     * @param cacheLineSize Size of each cache line.
     * @param memoryLatency Latency of the memory in clock cycles.
+    * @param writeSize Bytes written per write request (4, or cacheLineSize if L2 writes back whole lines).
+    * @param timingOnly Keep no data, the buffers get nullptr instead of lines (the timing is the same).
     *
     * @author Alexander Anthony Tang
     */
     SC_CTOR(MEMORY);
-    MEMORY(sc_module_name name, unsigned int cacheLineSize, unsigned int latency, PREFETCH* prefetch, STOREBACK* storeback) 
-    : sc_module(name), latency(latency), cacheLineSize(cacheLineSize), storeback(storeback), prefetch(prefetch) {
+    MEMORY(sc_module_name name, unsigned int cacheLineSize, unsigned int latency, PREFETCH* prefetch, STOREBACK* storeback,
+        unsigned int writeSize = 4, bool timingOnly = false) 
+    : sc_module(name), latency(latency), cacheLineSize(cacheLineSize), writeSize(writeSize), timingOnly(timingOnly),
+    storeback(storeback), prefetch(prefetch) {
+#ifdef FSM_CONTROLLERS
+        SC_METHOD(update_fsm);
+        sensitive << clock.pos();
+#else
         SC_THREAD(update);
         sensitive << clock.pos();
+#endif
+    }
+
+   /**
+    * @brief Zero the memory between two runs (see CPU_L1_L2::reset()), every queued write must be finished
+    */
+    void reset() {
+        memory_blocks.reset();
+        aborted_writes = 0;
+        aborted_cycles = 0;
+    }
+
+   /**
+    * @brief Read `count` bytes from `address_u` into `data`
+    * @return the address after the bytes, it stops at UINT_MAX (also with timingOnly, where nothing is read)
+    */
+    uint32_t read_bytes(uint32_t address_u, char* data, unsigned count) {
+        if (timingOnly) return (uint32_t) min((uint64_t) address_u + count, (uint64_t) UINT_MAX);
+
+        for (unsigned i = 0; i < count; i++) {
+            data[i] = memory_blocks.read(address_u);
+            // If the address is now at its maximum, we stop any more write/read process
+            if (address_u >= UINT_MAX) break;
+            address_u++;
+        }
+        return address_u;
+    }
+
+   /**
+    * @brief Write writeSize bytes of `data` to `address_u`, nothing with timingOnly
+    */
+    void write_bytes(uint32_t address_u, const char* data) {
+        if (timingOnly) return;
+
+        for (unsigned i = 0; i < writeSize; i++) {
+            memory_blocks.write(address_u, data[i]);
+            // If the address is now at its maximum, we stop any more write/read process
+            if (address_u >= UINT_MAX) break;
+            address_u++;
+        }
+    }
+
+   /**
+    * @brief Write an entry of the storeback buffer: writeSize bytes, or the bytes of its mask if it combines writes
+    */
+    void write_entry(uint32_t address_u, const char* data) {
+        storeback->retire();
+        if (!storeback->combining) {
+            write_bytes(address_u, data);
+            return;
+        }
+        if (timingOnly) return;
+
+        // the entry is a whole line, it cannot cross UINT_MAX
+        const char* mask = storeback->mask(data);
+        for (unsigned i = 0; i < storeback->lineSize; i++) {
+            if (mask[i]) memory_blocks.write(address_u + i, data[i]);
+        }
     }
 
    /**
@@ -85,6 +192,9 @@ SC_MODULE(MEMORY) {
             
             
             while(!valid_in->read() && !write_underway) {
+                // L2 may write into the storeback buffer before memory waits again (right after it was drained),
+                // memory then misses its valid: write the buffer anyway
+                if (storeback != nullptr && storeback->queued()) break;
                 wait();
                 wait(SC_ZERO_TIME);
                 wait(SC_ZERO_TIME);
@@ -98,7 +208,10 @@ SC_MODULE(MEMORY) {
             
 
             // Case: Read
-            if (!write_enable->read() ) {
+            if (valid_in->read() && !write_enable->read() ) {
+                // the read goes before the prefetches that have not started yet
+                if (prefetch != nullptr) prefetch->defer(sc_time_stamp());
+
                 // Load the data to the Bus, Load the whole cacheLine
 
                 // Wait to sync with latency             
@@ -106,25 +219,15 @@ SC_MODULE(MEMORY) {
                     wait();
                 }
 
-                for (unsigned i = 0; i < cacheLineSize; i++) {
-                    data_out_to_L2->read()[i] = memory_blocks[address_u];
-                    // If the address is now at its maximum, we stop any more write/read process
-                    if (address_u >= UINT_MAX) break;
-                    address_u++;
-                }
+                address_u = read_bytes(address_u, data_out_to_L2->read(), cacheLineSize);
 
                 done->write(true);
                 wait(SC_ZERO_TIME);
                 wait(SC_ZERO_TIME);
                 if (prefetch != nullptr) {
                     //Optimization: Prefetching - Trang
-                    //Prefetching - load 1 cache line starting from address
-                    for (int i = 1; i <= prefetch->capacity; i++)
-                    {
-                        
-                        prefetch_next_line(address_u + i*(cacheLineSize));
-                    }
-                    
+                    //Prefetching - start the reads of the lines the prefetcher predicted for this read (see PREFETCHER)
+                    issue_prefetches();
                 }
                 
 
@@ -145,13 +248,8 @@ SC_MODULE(MEMORY) {
                     for (unsigned i = 0; i < latency; i++) {
                         wait();
                     }
-                    // Write data to memory (in_Bus is 4 Bytes - data is 4 Bytes)
-                    for (unsigned i = 0; i < 4; i++) {
-                        memory_blocks[address_u] = data_in_from_L2->read()[i];
-                        // If the address is now at its maximum, we stop any more write/read process
-                        if (address_u >= UINT_MAX) break;
-                        address_u++;
-                    }
+                    // Write data to memory (in_Bus is writeSize Bytes - data is writeSize Bytes)
+                    write_bytes(address_u, data_in_from_L2->read());
                     // Signal as done
                     done->write(true);
                     // Wait for next clock.
@@ -176,9 +274,11 @@ SC_MODULE(MEMORY) {
             // only be fetched from the FIFO if it is done finished written. To work with SystemC's
             // FIFO, which always gets reduced everytime read() is called, we need to store the data
             // in a temporary variable, temp.
-            if (temp != nullptr) {
+            if (aborted) {
                 data = temp;
+                address_u = temp_address;
                 temp = nullptr;
+                aborted = false;
             } else {
                 // If no write was underway, then read from buffer. But if the buffer is empty, then
                 // memory has finished its task and will await further instructions.
@@ -198,7 +298,11 @@ SC_MODULE(MEMORY) {
                 // If L2 issues a read, it needs to store the data temporarily and abort the write.
                 if (!write_enable->read() && valid_in->read()) {
                     write_underway = true;
+                    aborted = true;
                     temp = data;
+                    temp_address = address_u;
+                    aborted_writes++;
+                    aborted_cycles += i;
                     
                     return;
                 }
@@ -207,41 +311,220 @@ SC_MODULE(MEMORY) {
             }
 
             
-            // Write to memory
-            for (unsigned i = 0; i < 4; i++) {
-                memory_blocks[address_u] = data[i];
-                // If the address is now at its maximum, we stop any more write/read process
-                if (address_u >= UINT_MAX) break;
-                address_u++;
-            }
-            
+            // Write to memory (data is a slot of the storeback buffer, nothing to free)
+            write_entry(address_u, data);
+        }
+    }
 
-            // Free the pointer from data
-            delete[] data;
+    /**
+     * @brief Start the reads of the lines predicted for a read miss, memory does not wait for them (see PREFETCH::issue())
+     * @details Lines that are on their way already are skipped, and so are the lines with writes in the storeback
+     * buffer (their bytes are not in memory yet) and the lines that do not fit into the buffer.
+     */
+    void issue_prefetches() {
+        for (uint32_t line_address : prefetch->lines) {
+            if (prefetch->is_full()) break;
+            if (prefetch->find(line_address) != nullptr) continue;
+            if (storeback != nullptr && storeback->pending(line_address / cacheLineSize)) continue;
+
+            // the line is read into the slot of the next issue
+            read_bytes(line_address, prefetch->payload(), cacheLineSize);
+            prefetch->issue(line_address, sc_time_stamp(), latency);
         }
     }
 
-    //load the next line into the buffer - Trang
-    void prefetch_next_line(uint32_t address_u) {
-        
-        
-        char* prefetched_line = new char[cacheLineSize] ();
-        uint32_t address_temp = address_u;
+    /**
+     * @brief Wait for the next clock edge (and then n delta cycles), like wait() in update()
+     */
+    void wait_clock(State next, unsigned deltas = 0) {
+        state = next;
+        pending_deltas = deltas;
+        next_trigger();
+    }
 
-        for (unsigned i = 0; i < cacheLineSize; i++) {
-            prefetched_line[i] = memory_blocks[address_temp];
-            // If the address is now at its maximum, we stop any more write/read process
-            if (address_temp >= UINT_MAX) break;
-            address_temp++;
+    /**
+     * @brief Wait for n delta cycles, like n times wait(SC_ZERO_TIME) in update()
+     */
+    void wait_delta(State next, unsigned deltas = 1) {
+        state = next;
+        pending_deltas = deltas - 1;
+        next_trigger(SC_ZERO_TIME);
+    }
+
+    /**
+     * @brief update() and write_from_buffer() as an SC_METHOD state machine
+     * (built with FSM_CONTROLLERS)
+     * @details
+     * Every wait() is a next_trigger() here, and the state tells where to continue.
+     * The waits inside of STOREBACK::read() are states as well,
+     * so the signals and buffers are accessed in the same delta cycles as in update().
+     */
+    void update_fsm() {
+        if (pending_deltas > 0) {
+            pending_deltas--;
+            next_trigger(SC_ZERO_TIME);
+            return;
         }
 
-         // Wait to sync with latency
-        for (unsigned i = 0; i < latency; i++) {
+        while (true) {
+            switch (state) {
+            case RESET:
+                wait_clock(IDLE);
+                return;
+
+            case IDLE:
+                wait_delta(CLEAR, 2);
+                return;
+
+            case CLEAR:
+                // mark as not done, and wait for signal from L2 is valid
+                done->write(false);
+                wait_delta(WAIT_VALID, 2);
+                return;
+
+            case WAIT_VALID:
+                // (a write into the storeback buffer whose valid memory missed, see update())
+                if (!valid_in->read() && !write_underway && (storeback == nullptr || !storeback->queued())) {
+                    wait_clock(WAIT_VALID, 2);
+                    return;
+                }
 
-            wait();
-        }
-        prefetch->write(prefetched_line, address_u);
+                // get the address
+                request_address = address->read();
+
+                if (valid_in->read() && !write_enable->read()) {
+                    // the read goes before the prefetches that have not started yet
+                    if (prefetch != nullptr) prefetch->defer(sc_time_stamp());
+                    cycles_left = latency;
+                    state = READ_LATENCY;
+                }
+                // If it uses a storeback buffer, start write from buffer.
+                else if (storeback != nullptr) {
+                    write_underway = true;
+                    state = FLUSH;
+                }
+                else {
+                    cycles_left = latency;
+                    state = WRITE_LATENCY;
+                }
+                break;
+
+            case READ_LATENCY:
+                // Wait to sync with latency
+                if (cycles_left > 0) {
+                    cycles_left--;
+                    wait_clock(READ_LATENCY);
+                    return;
+                }
+                state = READ;
+                break;
+
+            case READ:
+                // Load the data to the Bus, Load the whole cacheLine
+                request_address = read_bytes(request_address, data_out_to_L2->read(), cacheLineSize);
+
+                done->write(true);
+                wait_delta(READ_DONE, 2);
+                return;
+
+            case READ_DONE:
+                //Prefetching - start the reads of the predicted lines (see issue_prefetches())
+                if (prefetch != nullptr) {
+                    issue_prefetches();
+                }
+                state = AFTER_READ;
+                break;
+
+            case AFTER_READ:
+                state = write_underway ? FLUSH : IDLE;
+                break;
+
+            case WRITE_LATENCY:
+                // Wait to sync with latency
+                if (cycles_left > 0) {
+                    cycles_left--;
+                    wait_clock(WRITE_LATENCY);
+                    return;
+                }
+                state = WRITE;
+                break;
+
+            case WRITE:
+                // Write data to memory (in_Bus is writeSize Bytes - data is writeSize Bytes)
+                write_bytes(request_address, data_in_from_L2->read());
+                // Signal as done, wait for next clock.
+                done->write(true);
+                wait_clock(IDLE);
+                return;
+
+            case FLUSH:
+                done->write(false);
+                wait_delta(FLUSH_NEXT);
+                return;
+
+            case FLUSH_NEXT:
+                // Continue writing from temp if aborted (see write_from_buffer())
+                if (aborted) {
+                    flush_data = temp;
+                    flush_address = temp_address;
+                    temp = nullptr;
+                    aborted = false;
+                    cycles_left = latency;
+                    state = FLUSH_LATENCY;
+                    break;
+                }
+                wait_delta(FLUSH_POP);
+                return;
 
+            case FLUSH_POP:
+                if (storeback->pop(flush_data, flush_address)) {
+                    wait_delta(FLUSH_RELEASE);
+                    return;
+                }
+                // the buffer is empty, memory has finished its task
+                done->write(true);
+                write_underway = false;
+                wait_clock(IDLE);
+                return;
+
+            case FLUSH_RELEASE:
+                storeback->release();
+                cycles_left = latency;
+                state = FLUSH_LATENCY;
+                break;
+
+            case FLUSH_LATENCY:
+                // Wait to sync with latency
+                if (cycles_left > 0) {
+                    wait_delta(FLUSH_CHECK, 2);
+                    return;
+                }
+                state = FLUSH_WRITE;
+                break;
+
+            case FLUSH_CHECK:
+                // If L2 issues a read, it needs to store the data temporarily and abort the write.
+                if (!write_enable->read() && valid_in->read()) {
+                    write_underway = true;
+                    aborted = true;
+                    temp = flush_data;
+                    temp_address = flush_address;
+                    aborted_writes++;
+                    aborted_cycles += latency - cycles_left;
+                    state = IDLE;
+                    break;
+                }
+                cycles_left--;
+                wait_clock(FLUSH_LATENCY);
+                return;
+
+            case FLUSH_WRITE:
+                // Write to memory (flush_data is a slot of the storeback buffer, nothing to free)
+                write_entry(flush_address, flush_data);
+                state = FLUSH_NEXT;
+                break;
+            }
+        }
     }
 };
 
@@ -9,6 +9,11 @@
 #include "cache_l2.hpp"
 #include "storeback_buffer.hpp"
 #include "prefetch_buffer.hpp"
+#include "event_driver.hpp"
+#include "cpu.hpp"
+#include "cache_stats.hpp"
+#include "gate_count.hpp"
+#include "tag_store.hpp"
 
 
 #include <cmath>
@@ -90,6 +95,17 @@ struct CPU_L1_L2 {
     unsigned l1CacheLatency;    // Latency of L1 cache
     unsigned l2CacheLatency;    // Latency of L2 cache
     unsigned memoryLatency;     // Latency of main memory
+    unsigned l1Ways;            // Number of lines per set in L1 cache
+    unsigned l2Ways;            // Number of lines per set in L2 cache
+    Replacement replacement;    // Replacement policy of both caches
+    bool writeBack;             // write-back, write-allocate instead of write-through (both caches)
+    bool timingOnly;            // no cache line or memory data, only tags and valid bits
+    bool storebackCombining;    // the storeback buffer merges the writes to a line into one entry
+    bool selectiveFlush;        // a read miss of L2 only waits for the storeback entries of its line
+    bool storebackForwarding;   // a read miss of L2 takes the bytes of its line from the storeback buffer
+    Prefetcher prefetcher;      // which lines memory prefetches after a read miss of L2
+    unsigned prefetchDegree;    // lines per prefetch (0 = the size of the prefetch buffer)
+    unsigned prefetchDistance;  // lines from the read to the first prefetched line
     size_t numRequests;         // Number of requests
     struct Request* requests;   // Array of requests
     const char* tracefile;      // Tracefile name
@@ -99,6 +115,8 @@ struct CPU_L1_L2 {
     MEMORY* memory;             // Pointer to main memory
     STOREBACK* storeback = nullptr;       // Pointer to Store back buffer
     PREFETCH* prefetch = nullptr;
+    EVENT_DRIVER* event_driver = nullptr; // Pointer to the event driver (nullptr = cycle by cycle)
+    CPU* cpu = nullptr;                   // Pointer to the CPU module (nullptr = requests are sent from outside)
 
     // Bus between CPU and Cache (L1)
     sc_signal<char*> data_in;
@@ -161,6 +179,8 @@ struct CPU_L1_L2 {
     * 3. Write Hit: Update value (L1 or L2), Write to Memory
     * 4. Read Hit: If in L1, L2 won't do anything (wait), etc.
     *
+    * With writeBack, writes stay in the caches, a dirty line is written to the next level when it is replaced.
+    *
     * @param l1CacheLines Number of cache lines in L1 cache.
     * @param l2CacheLines Number of cache lines in L2 cache.
     * @param cacheLineSize Size of each cache line in L1 and L2.
@@ -168,6 +188,19 @@ struct CPU_L1_L2 {
     * @param l2CacheLatency Latency of L2 cache.
     * @param memoryLatency Latency of main memory.
     * @param tracefile Name of trace file.
+    * @param eventDriven Advance the simulation from done event to done event instead of cycle by cycle.
+    * @param streaming Issue the requests from a CPU module, the whole trace runs in one sc_start().
+    * @param l1Ways Number of lines per set in L1 cache (1 = direct-mapped).
+    * @param l2Ways Number of lines per set in L2 cache (1 = direct-mapped).
+    * @param replacement Replacement policy of the set-associative caches.
+    * @param writeBack Write-back, write-allocate caches instead of write-through, no-write-allocate.
+    * @param timingOnly Store no data in L1, L2 and memory, the cycles, hits and misses are the same.
+    * @param storebackCombining The storeback buffer holds lines and merges the writes to a line (see STOREBACK).
+    * @param selectiveFlush A read miss of L2 only waits until the storeback entries of its line are written.
+    * @param storebackForwarding A read miss of L2 takes the bytes of its line from the storeback buffer (see L2::update()).
+    * @param prefetcher Which lines memory prefetches after a read miss of L2 (see PREFETCHER).
+    * @param prefetchDegree Lines per prefetch, at most prefetchBufferLines (0 = prefetchBufferLines).
+    * @param prefetchDistance Lines from the read to the first prefetched line (1 = the next line).
     *
     * @authors
     * Alexander Anthony Tang
@@ -177,36 +210,50 @@ struct CPU_L1_L2 {
     CPU_L1_L2 (unsigned l1CacheLines, unsigned l2CacheLines, const unsigned cacheLineSize,
         unsigned l1CacheLatency, unsigned l2CacheLatency, unsigned memoryLatency,
         const char* tracefile,
-        unsigned prefetchBufferLines = 0, unsigned storebackBufferLines = 0, bool storeBufferConditional = false) :
+        unsigned prefetchBufferLines = 0, unsigned storebackBufferLines = 0, bool storeBufferConditional = false,
+        bool eventDriven = true, bool streaming = false,
+        unsigned l1Ways = 1, unsigned l2Ways = 1, Replacement replacement = REPLACEMENT_LRU, bool writeBack = false,
+        bool timingOnly = false, bool storebackCombining = false, bool selectiveFlush = false,
+        bool storebackForwarding = false, Prefetcher prefetcher = PREFETCHER_NEXTLINE, unsigned prefetchDegree = 0,
+        unsigned prefetchDistance = 1) :
         l1CacheLines(l1CacheLines), l2CacheLines(l2CacheLines), cacheLineSize(cacheLineSize), 
         l1CacheLatency(l1CacheLatency), l2CacheLatency(l2CacheLatency), memoryLatency(memoryLatency),
+        l1Ways(l1Ways), l2Ways(l2Ways), replacement(replacement), writeBack(writeBack), timingOnly(timingOnly),
+        storebackCombining(storebackCombining), selectiveFlush(selectiveFlush), storebackForwarding(storebackForwarding),
+        prefetcher(prefetcher), prefetchDegree(prefetchDegree), prefetchDistance(prefetchDistance),
         tracefile(tracefile) {
        
-        // Initialize L1, L2, and Memory
+        // With write-back, whole lines are written to L2 and memory
+        unsigned writeSize = writeBack ? cacheLineSize : 4;
+
+        // Initialize L1, L2, and Memory (the buffers keep no data with timingOnly)
         if (storebackBufferLines != 0) {
-            storeback = new STOREBACK("Storeback", storebackBufferLines, storeBufferConditional);
+            storeback = new STOREBACK("Storeback", storebackBufferLines, storeBufferConditional, writeSize, cacheLineSize,
+                storebackCombining, selectiveFlush, storebackForwarding, timingOnly);
         }
 
         //prefetch buffer
         if (prefetchBufferLines != 0) {
-            prefetch = new PREFETCH("Prefetch", prefetchBufferLines);
+            prefetch = new PREFETCH("Prefetch", prefetchBufferLines, timingOnly ? 0 : cacheLineSize, cacheLineSize,
+                sc_time(period, unit), prefetcher, prefetchDegree, prefetchDistance);
         }
 
-        l1 = new L1("L1", cacheLineSize, l1CacheLines, l1CacheLatency);
-        l2 = new L2("L2", cacheLineSize, l2CacheLines, l2CacheLatency,  prefetch, storeback);
-        memory = new MEMORY("Memory", cacheLineSize, memoryLatency, prefetch, storeback);
+        l1 = new L1("L1", cacheLineSize, l1CacheLines, l1CacheLatency, l1Ways, replacement, writeBack, timingOnly);
+        l2 = new L2("L2", cacheLineSize, l2CacheLines, l2CacheLatency,  prefetch, storeback, l2Ways, replacement, writeBack,
+            timingOnly);
+        memory = new MEMORY("Memory", cacheLineSize, memoryLatency, prefetch, storeback, writeSize, timingOnly);
 
 
         
         // Initialize data_in, etc. and set value to '\0'
-        // Bus from Memory -> L2 -> L1 is as big as a cacheLine, while the other is only 4 Bytes
+        // Bus from Memory -> L2 -> L1 is as big as a cacheLine, while the other is only 4 Bytes (a cacheLine with write-back)
         data_in = new char[4]();
         data_out = new char[4]();
 
-        data_from_L1_to_L2 = new char[4]();
+        data_from_L1_to_L2 = new char[writeSize]();
         data_from_L2_to_L1 = new char[cacheLineSize] ();
 
-        data_from_L2_to_Memory = new char[4] ();
+        data_from_L2_to_Memory = new char[writeSize] ();
         data_from_Memory_to_L2 = new char[cacheLineSize] ();
 
         // Bind signals
@@ -274,6 +321,27 @@ struct CPU_L1_L2 {
         l2->valid_out(valid_from_L2_to_Memory);
         memory->valid_in(valid_from_L2_to_Memory);
 
+        // 8. Bind the event driver
+        if (eventDriven) {
+            event_driver = new EVENT_DRIVER("Event_Driver", sc_time(period, unit));
+            event_driver->done_from_L1(done_from_L1);
+            event_driver->done_from_Memory(done_from_Memory);
+            event_driver->valid_to_L2(valid_from_L1_to_L2);
+        }
+
+        // 9. Bind the CPU
+        if (streaming) {
+            cpu = new CPU("CPU", sc_time(period, unit));
+            cpu->data_out_to_L1(data_in);
+            cpu->address(address);
+            cpu->write_enable(write_enable);
+            cpu->valid(valid);
+            cpu->done_from_L1(done_from_L1);
+            cpu->hit_from_L1(hit_from_L1);
+            cpu->hit_from_L2(hit_from_L2);
+            cpu->valid_to_L2(valid_from_L1_to_L2);
+        }
+
         // start simulation for 1 delta cycle, without advancing the time (Simulation Second)
         sc_start(SC_ZERO_TIME);
 
@@ -351,74 +419,86 @@ struct CPU_L1_L2 {
         bool cache_l2_executes = false; // whether L2 runs or not
         size_t hit_L2 = 0; // does L2 hit? 0 or 1
         
-
-        // run the simulation (+1) to process the request
-        do {
-
-            sc_start(period, unit);
-            cycles--;
+        if (event_driver != nullptr) {
+            // run the simulation until L1 is done, skipping the cycles in between
+            cycle_count = event_driver->run_until_L1_done(cycles);
             if (cycles < 0) {
                 CacheStats res = {};
                 return res;
             }
-
-            // if L1 miss, then request propagated to L2, thus valid_from_L1_to_L2 = true
-            if (valid_from_L1_to_L2) {
-                cache_l2_executes = true;
-                hit_L2 |= hit_from_L2.read(); // TODO: Make sure only return 1 not at 5 Sec
-            }
-
-            cycle_count++;
-
-            /*
-                Cases for cycles:
-                L1.done = true in 4 Sec if L1 hit
-                L1.done = true in 16 Sec (if L1 miss but L2 hit - L2.done = 12 Sec)
-                L1.done = true in 116 Sec (if L2 miss - Memory.done = 100 Sec)
-            */
-            
-        } while (!done_from_L1.read());
-        
-        /*
-            Calculating the misses and hits
-            cache_l2_executes is true IFF "valid_from_l1_to_l2" is true
-
-            1. Misses:
-               - If L1 Hit: Misses = 0
-               - If L1 Miss: Miss = !(hit_L1) + (1 - hit_L2)
-
-            2. Hits:
-               - If L1 Hit: Hits = 1
-               - If L1 Miss: Hits = hit_L2
-        */
-        
-        size_t hits = hit_from_L1 || ((cache_l2_executes) && (hit_from_L2));
-        size_t misses = 1 - hits;
+            cache_l2_executes = event_driver->l2_executes;
+        }
+        else {
+            // run the simulation (+1) to process the request
+            do {
+
+                sc_start(period, unit);
+                cycles--;
+                if (cycles < 0) {
+                    CacheStats res = {};
+                    return res;
+                }
+
+                // if L1 miss, then request propagated to L2, thus valid_from_L1_to_L2 = true
+                if (valid_from_L1_to_L2) {
+                    cache_l2_executes = true;
+                    hit_L2 |= hit_from_L2.read(); // TODO: Make sure only return 1 not at 5 Sec
+                }
+
+                cycle_count++;
+
+                /*
+                    Cases for cycles:
+                    L1.done = true in 4 Sec if L1 hit
+                    L1.done = true in 16 Sec (if L1 miss but L2 hit - L2.done = 12 Sec)
+                    L1.done = true in 116 Sec (if L2 miss - Memory.done = 100 Sec)
+                */
+                
+            } while (!done_from_L1.read());
+        }
         
-        // create Result and send back
-        CacheStats res = { 
-            cycle_count, // cycles
-            misses, // misses
-            hits, // hits
-            0,
-            hits && !request.we,
-            misses && !request.we,
-            hits && request.we,
-            misses && request.we,
-            hit_from_L1 && !request.we,
-            (!hit_from_L1) && !request.we,
-            hit_from_L1 && request.we,
-            (!hit_from_L1) && request.we,
-            (cache_l2_executes) && (hit_from_L2) && !request.we,
-            (cache_l2_executes) && (!hit_from_L2) && !request.we,
-            (cache_l2_executes) && (hit_from_L2) && request.we,
-            (cache_l2_executes) && (!hit_from_L2) && request.we,
-        };
+        // create Result and send back (see request_stats() for how hits and misses are calculated)
+        CacheStats res = request_stats(cycle_count, hit_from_L1, cache_l2_executes, hit_from_L2, request.we);
 
         valid = false; // set valid as false
         return res;
     }
 
+    /**
+     * @brief Let the CPU module issue all requests, in a single sc_start().
+     *
+     * @param requests A pointer to the array of Request structures.
+     * @param numRequests The number of requests (stops earlier at .we == -1).
+     * @param cycles Remaining cycle budget, set to -1 if exceeded.
+     * @param cacheStats The CacheStats to be updated.
+     * @return false if the cycle budget has been exceeded
+     */
+    bool stream_requests(struct Request* requests, size_t numRequests, int &cycles, CacheStats* cacheStats) {
+        // Nothing to issue, the CPU would never pause the simulation
+        if (numRequests == 0 || requests[0].we == -1) return true;
+
+        cpu->requests = requests;
+        cpu->numRequests = numRequests;
+        cpu->cycles = cycles;
+        cpu->cacheStats = cacheStats;
+
+        // the CPU pauses after the last request or when the budget is used up
+        cpu->start.notify(SC_ZERO_TIME);
+        sc_start();
+
+        if (cpu->forceTerminate) {
+            cycles = -1;
+            return false;
+        }
+
+        // finish the last request up to the clock boundary
+        sc_start(cpu->last_end - sc_time_stamp());
+        cpu->finish_last_request();
+
+        cycles = cpu->cycles;
+        return true;
+    }
+
     unsigned finish_memory(int &cycles) {
         if (storeback == nullptr) return 0;
         valid_from_L1_to_L2 = false;
@@ -427,6 +507,10 @@ struct CPU_L1_L2 {
         sc_start(SC_ZERO_TIME);
         // std::cout << memory->write_underway << std::endl;
         if (!memory->write_underway && storeback->is_empty()) return 0;
+        if (event_driver != nullptr) {
+            cycle_count = event_driver->run_until_Memory_done(cycles);
+            return (cycles < 0) ? -1 : cycle_count;
+        }
         while (!done_from_Memory) {
             cycles--;
             if (cycles < 0) return -1;
@@ -437,6 +521,54 @@ struct CPU_L1_L2 {
         return cycle_count;
     }
 
+    /**
+     * @brief Whether every controller waits for a request and the storeback buffer is written to memory
+     */
+    bool is_idle() {
+        return l1->is_idle() && l2->is_idle()
+            && !memory->write_underway && !valid_from_L2_to_Memory.read()
+            && (storeback == nullptr || storeback->is_empty());
+    }
+
+    /**
+     * @brief Bring the memory hierarchy back to its state after the constructor, for another run
+     *
+     * @details
+     * SystemC elaborates only once per process, so instead of building new modules (see libcachesim):
+     * 1. A request that has been stopped by the cycle limit is finished, the storeback buffer is written to memory
+     * 2. The clock runs until every controller waits for a request again, the prefetches on their way are dropped
+     * 3. The simulation stops on a clock boundary, like after a request (the CPU module: just before it)
+     * 4. The caches, the memory and the buffers are emptied, the memory keeps its pages (see SPARSE_MEMORY::reset())
+     *
+     * Only the simulated time goes on, the modules only wait for relative times.
+     */
+    void reset() {
+        // 1. The CPU module finishes its request on its own
+        if (cpu == nullptr && valid.read()) {
+            while (!done_from_L1.read()) sc_start(period, unit);
+            valid = false;
+        }
+        while (valid.read()) sc_start(period, unit);
+
+        // 2. Until L1 and L2 wait for a request and memory has no read or write left (prefetches complete in the background)
+        while (!is_idle()) sc_start(period, unit);
+        if (prefetch != nullptr) prefetch->reset();
+
+        // 3. Up to the next clock boundary, the clock edge on it has not run yet.
+        // The CPU module is started in the same delta cycle as that edge, which L1 would see one cycle late,
+        // so it stops just before the boundary: its first request is on the bus when the edge comes (like at time 0)
+        sc_time early = (cpu != nullptr) ? sc_get_time_resolution() : SC_ZERO_TIME;
+        sc_time boundary = sc_time(period, unit) * (floor((sc_time_stamp() + early) / sc_time(period, unit)) + 1);
+        sc_start(boundary - early - sc_time_stamp());
+
+        // 4. Empty every module
+        l1->reset();
+        l2->reset();
+        memory->reset();
+        if (storeback != nullptr) storeback->reset();
+        if (cpu != nullptr) cpu->reset();
+    }
+
     /**
      * @brief stop the simulation, close trace file, clean up
      * @authors
@@ -468,6 +600,8 @@ struct CPU_L1_L2 {
         delete l1;
         delete l2;
         delete memory;
+        delete event_driver;
+        delete cpu;
         delete clk;
 
         delete[] data_in.read();
@@ -479,6 +613,13 @@ struct CPU_L1_L2 {
     }
 
 
+    /**
+     * @brief Writes merged into an entry of the storeback buffer (--storeback-combine)
+     */
+    size_t combined_writes() {
+        return (storeback != nullptr) ? storeback->combined : 0;
+    }
+
     /**
      * Calculates the total number of gates required for the memory system.
      * 
@@ -488,69 +629,13 @@ struct CPU_L1_L2 {
      * @return The total number of gates required for the memory system.
      */
     size_t get_gate_count() {
-        // Only for the "saving" part
-        // Each bit of memory consists of 6 CMOS Transistors (2 NOT Gates) -> 2
-        // Each line has the size of cacheLineSize bytes, Gataes = 2*cacheLineSize*8
-        // Each tag is a 32 bit integer -> 32 -> 64 gates for a line of tag
-        // For a line: 64 + 16*cacheLineSize
-        // l1CacheLines, l2CacheLines -> (l1CacheLines + l2CacheLines)*(64 + 16*cacheLineSize)
-
-        // Control part
-        // Multiplexers (to know which address to go to), comparators (for the tags)
-        // 
-        //---------------------------------------------------------------------------------
-        // For memory
-        unsigned gates_cache_line = 2*8*cacheLineSize;
-        
-        unsigned gates_valid = 2;
-        // Bits used for storing the tags
-        unsigned gates_l1_tags = (l1->log2_cacheLineSize + l1->log2_l1CacheLines)*2;
-        unsigned gates_l2_tags = (l2->log2_cacheLineSize + l2->log2_l2CacheLines)*2;
-
-        unsigned gates_l1_memory = (gates_cache_line + gates_l1_tags + gates_valid)*l1CacheLines;
-        unsigned gates_l2_memory = (gates_cache_line + gates_l2_tags + gates_valid)*l2CacheLines;
-        
-        unsigned total_gates_for_memory = gates_l1_memory + gates_l2_memory;
-        //---------------------------------------------------------------------------------
-        // Address Latch Gates
-        unsigned address_latches = 4 * 32;
-
-
-        //---------------------------------------------------------------------------------
-        // For accessing a certain cell
-        // Predecoder are used to alleviate the logical effort in the decoder
-        unsigned predecoder_l1 = (l1->log2_l1CacheLines + 2)/3 * 8;
-        unsigned predecoder_l2 = (l2->log2_l2CacheLines + 2)/3 * 8;
-
-        unsigned decoder_l1 = l1CacheLines;
-        unsigned decoder_l2 = l2CacheLines;
-
-        // To get a certain column
-        unsigned multiplexer_l1_column = cacheLineSize;
-        unsigned multiplexer_l2_column = cacheLineSize;
-
-        unsigned total_addresser = predecoder_l1 + predecoder_l2 + decoder_l1 + decoder_l2 + multiplexer_l1_column + multiplexer_l2_column;
-        //---------------------------------------------------------------------------------
-        // Comparison of tags:
-        // This comparator just needs to compare if the tag in the table and the tag
-        // from the address is the same. So it only uses AND Gates.
-        unsigned comparator_l1 = 32 - (l1->log2_cacheLineSize + l1->log2_l1CacheLines);
-        unsigned comparator_l2 = 32 - (l2->log2_cacheLineSize + l2->log2_l2CacheLines);
-
-        unsigned total_comparator = comparator_l1 + comparator_l2;
-
-        //---------------------------------------------------------------------------------
-        // Buffer
-        unsigned storeback_gates = (32 + 4) * 4 * ((storeback != nullptr) ? storeback->capacity : 0);
-        unsigned prefetch_gates = (32 + cacheLineSize) * 4 * ((prefetch != nullptr) ? prefetch->capacity : 0);
-
-        unsigned total_buffer_gate = storeback_gates + prefetch_gates;
-        
-        // Add comparator for write buffers
-        total_comparator += ((prefetch != nullptr) ? comparator_l2 : 0);
-
-
-        return total_gates_for_memory + total_addresser + address_latches + total_comparator + total_buffer_gate;
+        return gate_count(
+            l1CacheLines, l2CacheLines, cacheLineSize,
+            (storeback != nullptr) ? storeback->capacity : 0,
+            (prefetch != nullptr) ? prefetch->capacity : 0,
+            l1Ways, l2Ways, replacement, writeBack, storebackCombining, selectiveFlush, storebackForwarding,
+            prefetcher
+        );
     }
 };
 
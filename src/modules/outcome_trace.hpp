@@ -0,0 +1,160 @@
+#ifndef OUTCOME_TRACE_HPP
+#define OUTCOME_TRACE_HPP
+
+#include <vector>
+#include <climits>
+#include <cstdint>
+
+#include "../main/simulator.hpp"
+#include "functional.hpp"
+#include "cache_stats.hpp"
+
+using namespace std;
+
+// Outcomes of a request in OUTCOME_TRACE, see OUTCOME_TRACE::outcome()
+#define OUTCOME_CODES 128
+
+/**
+ * @brief OUTCOME_TRACE records the outcome of every request once and re-times it for any latencies.
+ *
+ * @details
+ * Without buffers, the lines that FUNCTIONAL_L1_L2 hits, fills and writes back only depend on the
+ * requests and on the geometry (line size, lines, ways, replacement, write policy), never on
+ * the latencies. The latencies only decide the cycles of a request and where the cycle limit stops.
+ *
+ * The trace is recorded once with FUNCTIONAL_L1_L2 and stores one byte per request (see outcome()).
+ * retime() then computes the CacheStats of any number of latency triples:
+ * 1. Without the cycle limit, the CacheStats are built from the number of requests of every outcome
+ * 2. Triples that run out of cycles are stepped through the trace together, in a single pass
+ *
+ * The results are the same as FUNCTIONAL_L1_L2 with these latencies, including the cycle limit.
+ */
+struct OUTCOME_TRACE {
+
+    bool writeBack;                     // write-back, write-allocate instead of write-through
+    vector<uint8_t> codes;              // outcome of every request, in order
+    size_t counts[OUTCOME_CODES] = {};  // number of requests of every outcome
+
+    /**
+     * @brief Records the requests (until the `.we = -1` marker) with FUNCTIONAL_L1_L2
+     */
+    OUTCOME_TRACE(unsigned l1CacheLines, unsigned l2CacheLines, unsigned cacheLineSize,
+        unsigned l1Ways, unsigned l2Ways, Replacement replacement, bool writeBack,
+        size_t numRequests, const struct Request* requests) : writeBack(writeBack) {
+
+        // all latencies 0: the outcomes are the same, and the cycles can never run out
+        FUNCTIONAL_L1_L2 caches(l1CacheLines, l2CacheLines, cacheLineSize, 0, 0, 0, l1Ways, l2Ways, replacement, writeBack);
+        codes.reserve(numRequests);
+
+        for (size_t i = 0; i < numRequests && requests[i].we != -1; i++) {
+            size_t writebacks_L1 = caches.writebacks_L1;
+            size_t writebacks_L2 = caches.writebacks_L2;
+            int cycles = INT_MAX;
+            CacheStats s = caches.send_request(requests[i], cycles);
+
+            unsigned code = outcome(
+                requests[i].we, s.read_hits_L1 + s.write_hits_L1,
+                s.read_hits_L2 + s.read_misses_L2 + s.write_hits_L2 + s.write_misses_L2, s.read_hits_L2 + s.write_hits_L2,
+                caches.writebacks_L1 - writebacks_L1, caches.writebacks_L2 - writebacks_L2
+            );
+            codes.push_back(code);
+            counts[code]++;
+        }
+    }
+
+    /**
+     * @brief Outcome of a request: write, L1 hit, reached L2, L2 hit, L1 writebacks (0 or 1), L2 writebacks (0 to 2)
+     */
+    static unsigned outcome(bool we, bool hit_L1, bool l2_executes, bool hit_L2, unsigned writebacks_L1, unsigned writebacks_L2) {
+        return we | (hit_L1 << 1) | (l2_executes << 2) | (hit_L2 << 3) | (writebacks_L1 << 4) | (writebacks_L2 << 5);
+    }
+
+    /**
+     * @brief Cycles of every outcome with these latencies (same as FUNCTIONAL_L1_L2)
+     */
+    void outcome_cycles(unsigned l1CacheLatency, unsigned l2CacheLatency, unsigned memoryLatency, size_t* cycles) const {
+        for (unsigned code = 0; code < OUTCOME_CODES; code++) {
+            bool we = code & 1, hit_L1 = code & 2, hit_L2 = code & 8;
+            cycles[code] = FUNCTIONAL_L1_L2::outcome_cycles(l1CacheLatency, l2CacheLatency, memoryLatency,
+                we, hit_L1, hit_L2, writeBack, (code >> 4) & 1, code >> 5);
+        }
+    }
+
+    /**
+     * @brief CacheStats of `count[code]` requests of every outcome
+     */
+    static void add_outcomes(const size_t* cycles, const size_t* count, CacheStats* cacheStats) {
+        for (unsigned code = 0; code < OUTCOME_CODES; code++) {
+            if (count[code] == 0) continue;
+            bool we = code & 1, hit_L1 = code & 2, l2_executes = code & 4, hit_L2 = code & 8;
+            statsUpdater(cacheStats, request_stats(cycles[code], hit_L1, l2_executes, hit_L2, we), count[code]);
+            cacheStats->writebacks_L1 += ((code >> 4) & 1) * count[code];
+            cacheStats->writebacks_L2 += (code >> 5) * count[code];
+        }
+    }
+
+    /**
+     * @brief CacheStats of every latency triple
+     *
+     * @param numTriples The number of latency triples.
+     * @param l1CacheLatency The L1 latency of every triple.
+     * @param l2CacheLatency The L2 latency of every triple.
+     * @param memoryLatency The memory latency of every triple.
+     * @param cycles The number of cycles for the simulation.
+     * @param cacheStats The CacheStats of every triple (cycles = SIZE_MAX if the budget ran out).
+     * @note primitiveGateCount is not set
+     */
+    void retime(size_t numTriples, const unsigned* l1CacheLatency, const unsigned* l2CacheLatency,
+        const unsigned* memoryLatency, int cycles, CacheStats* cacheStats) const {
+
+        vector<size_t> cyclesOf(numTriples * OUTCOME_CODES);
+        vector<size_t> stopped;     // triples that run out of cycles
+
+        for (size_t t = 0; t < numTriples; t++) {
+            size_t* tripleCycles = &cyclesOf[t * OUTCOME_CODES];
+            outcome_cycles(l1CacheLatency[t], l2CacheLatency[t], memoryLatency[t], tripleCycles);
+
+            cacheStats[t] = {};
+            add_outcomes(tripleCycles, counts, &cacheStats[t]);
+            if (cacheStats[t].cycles > (size_t) cycles) {
+                stopped.push_back(t);
+            }
+        }
+        if (stopped.empty()) return;
+
+        // one pass over the trace for all triples that stop, each one counts until its budget runs out
+        vector<size_t> partial(stopped.size() * OUTCOME_CODES);
+        vector<int> budget(stopped.size(), cycles);
+        vector<uint8_t> last(stopped.size(), 0);
+        vector<uint8_t> running(stopped.size(), 1);
+        size_t numRunning = stopped.size();
+
+        for (size_t i = 0; i < codes.size() && numRunning > 0; i++) {
+            unsigned code = codes[i];
+            for (size_t j = 0; j < stopped.size(); j++) {
+                if (!running[j]) continue;
+
+                if (!FUNCTIONAL_L1_L2::charge_cycles(budget[j], cyclesOf[stopped[j] * OUTCOME_CODES + code])) {
+                    running[j] = 0;
+                    last[j] = code;
+                    numRunning--;
+                    continue;
+                }
+                partial[j * OUTCOME_CODES + code]++;
+            }
+        }
+
+        for (size_t j = 0; j < stopped.size(); j++) {
+            CacheStats* s = &cacheStats[stopped[j]];
+            *s = {};
+            add_outcomes(&cyclesOf[stopped[j] * OUTCOME_CODES], &partial[j * OUTCOME_CODES], s);
+
+            // the request that did not finish has already written its victims back
+            s->writebacks_L1 += (last[j] >> 4) & 1;
+            s->writebacks_L2 += last[j] >> 5;
+            s->cycles = SIZE_MAX;
+        }
+    }
+};
+
+#endif
@@ -6,81 +6,202 @@
 #include <vector>
 
 #include "../main/simulator.hpp" // the struct moved here - Leon
+#include "line_arena.hpp"
+#include "prefetcher.hpp"
 
-// using namespace directives won't get carried over. 
+// using namespace directives won't get carried over.
 using namespace sc_core;
 using namespace std;
 
 
 /**
-* @brief The prefetch buffer tries to increase read hits to reduce latency 
-* @details This module will read from the memory and will wait according to the memory latency, and therefore making it
-* slower.
-* 
+* @brief The prefetch buffer tries to increase read hits to reduce latency
+* @details The prefetches are pipelined memory reads that complete in the background:
+* after a read miss, memory starts the read of one predicted line per cycle (see issue()),
+* and every line arrives `latency` cycles after its read started. Neither memory nor L2 waits for them.
+* A read miss of L2 takes the issue slot of its cycle, the prefetches that have not started yet move back a cycle
+* (see defer()).
+*
+* L2 moves the lines that have arrived into the cache before every request (see pop()).
+* A read miss on a line that is still on its way waits for it instead of reading it again (see arrival()),
+* a write to such a line drops it, its data would be stale (see cancel()).
+*
+* The lines are not allocated per prefetch, they live in `capacity` ring slots (see STOREBACK):
+* memory fills payload() and then calls issue(), L2 gets a pointer to the slot from pop().
+*
+* Which lines memory prefetches comes from the PREFETCHER: L2 calls train() for every read,
+* and after a read miss memory prefetches `lines`, as many as there are free slots.
+*
 * @authors
 * Alexander Anthony Tang
 * Van Trang Nguyen
 */
 SC_MODULE(PREFETCH){
 
-    sc_fifo<char*> prefetch;
-    sc_fifo<uint32_t> address_prefetch;
+    /**
+     * @brief A line on its way from memory
+     */
+    struct Entry {
+        uint32_t address = 0;       // address of the line
+        sc_time issue;              // the cycle memory starts the read
+        sc_time ready;              // the cycle the line arrives (issue + latency)
+        bool cancelled = false;     // written after the read started, it is dropped
+    };
+
     unsigned capacity;
-    
-    SC_CTOR(PREFETCH);
-    PREFETCH(sc_module_name name, unsigned capacity) : sc_module(name), capacity(capacity), prefetch(capacity), address_prefetch(capacity) {
+    unsigned lineSize;          // size of a cache line
+    sc_time period;             // one cycle, memory starts one read per cycle
+
+    vector<Entry> entries;      // ring of the lines on their way (capacity)
+    LINE_ARENA payloads;        // ring slots of the lines (capacity, payloadSize bytes each)
+    size_t written = 0;         // lines issued so far, the next issue uses slot written % capacity
+    size_t read_count = 0;      // lines popped so far
+    sc_time last_issue;         // the cycle the last read started
+    size_t cancelled = 0;       // lines dropped by a write
 
+    PREFETCHER predictor;       // predicts the lines of the next prefetch
+    vector<uint32_t> lines;     // the lines memory prefetches after the current read miss of L2
+
+    /**
+     * @param name The name of the module.
+     * @param capacity The capacity of the buffer.
+     * @param payloadSize Bytes per line, 0 keeps no data.
+     * @param lineSize Size of a cache line.
+     * @param period The clock period.
+     * @param kind Which lines are prefetched (see PREFETCHER).
+     * @param degree Lines per prefetch, at most capacity (0 = capacity).
+     * @param distance Lines from the read to the first prefetched line (0 or 1 = the next line).
+     */
+    SC_CTOR(PREFETCH);
+    PREFETCH(sc_module_name name, unsigned capacity, unsigned payloadSize, unsigned lineSize, sc_time period,
+        Prefetcher kind = PREFETCHER_NEXTLINE, unsigned degree = 0, unsigned distance = 1) :
+        sc_module(name), capacity(capacity), lineSize(lineSize), period(period), entries(capacity),
+        predictor(kind, lineSize, (degree == 0 || degree > capacity) ? capacity : degree, (distance == 0) ? 1 : distance) {
+        if (payloadSize != 0) {
+            payloads.resize(capacity, payloadSize);
+        }
+        lines.reserve(capacity);
     };
 
+    /**
+     * @brief A read of L2 from L1: train the prefetcher, a miss then prefetches its prediction (see lines)
+     */
+    void train(uint32_t address) {
+        lines = predictor.train(address);
+    }
+
+    bool is_full() const {
+        return written - read_count >= capacity;
+    }
+
+    /**
+     * @brief The slot that the next issue() puts into the buffer, to be filled before (nullptr without data)
+     */
+    char* payload() {
+        return payloads[written % capacity];
+    }
+
+    /**
+     * @brief Memory starts the read of the line in payload(), in the cycle after `now` or after the last read
+     * @param address The address of the line
+     * @param now The cycle of the read miss
+     * @param latency The latency of memory in cycles
+     */
+    void issue(uint32_t address, sc_time now, unsigned latency) {
+        Entry& entry = entries[written % capacity];
+        entry.address = address;
+        entry.issue = max(now, last_issue) + period;
+        entry.ready = entry.issue + period * (double) latency;
+        entry.cancelled = false;
+        last_issue = entry.issue;
+        written++;
+    }
+
+    /**
+     * @brief A read miss of L2 starts at `now`, the prefetches that would start then or later move back a cycle
+     */
+    void defer(sc_time now) {
+        bool moved = false;
+        for (size_t k = read_count; k < written; k++) {
+            Entry& entry = entries[k % capacity];
+            if (entry.issue < now) continue;
+            entry.issue += period;
+            entry.ready += period;
+            moved = true;
+        }
+        if (moved) last_issue += period;
+    }
+
+    /**
+     * @brief The entry of a line that is on its way and has not been written since, nullptr if there is none
+     */
+    const Entry* find(uint32_t address) const {
+        for (size_t k = read_count; k < written; k++) {
+            const Entry& entry = entries[k % capacity];
+            if (!entry.cancelled && entry.address / lineSize == address / lineSize) return &entry;
+        }
+        return nullptr;
+    }
 
     /**
-     * @brief A write method from the buffer.
-     * 
-     * @param data A variable of a pointer which consists of an array of length cacheLineSize to be read from.
-     * @param address A variable of the address corresponding to the data
-     * 
-     * @return Returns true if a read is successful, false if the buffer is empty.
-     * If the buffer is empty then it does not change the state of the FIFO.
+     * @brief When the line of a read miss arrives, if it is on its way
+     * @return true and the cycle in `ready`, false if it has to be read from memory
+     */
+    bool arrival(uint32_t address, sc_time& ready) const {
+        const Entry* entry = find(address);
+        if (entry == nullptr) return false;
+        ready = entry->ready;
+        return true;
+    }
+
+    /**
+     * @brief A write to the line of `address`: the lines of it on their way are dropped
+     */
+    void cancel(uint32_t address) {
+        for (size_t k = read_count; k < written; k++) {
+            Entry& entry = entries[k % capacity];
+            if (!entry.cancelled && entry.address / lineSize == address / lineSize) {
+                entry.cancelled = true;
+                cancelled++;
+            }
+        }
+    }
+
+    /**
+     * @brief Take the oldest line that has arrived by `now`, the dropped ones are skipped
+     *
+     * @param data Set to the slot of the line, it stays valid until the next issue() into the slot.
+     * @param address Set to the address of the line
+     *
+     * @return Returns true if a line has arrived, false if the buffer is empty or its lines are still on their way.
      *
      * @authors
      * Alexander Anthony Tang
      * Van Trang Nguyen
-    */
-    bool write(char* data, uint32_t address) {
-        wait(SC_ZERO_TIME);
-        wait(SC_ZERO_TIME);
-        
-        if (prefetch.nb_write(data) && address_prefetch.nb_write(address)) {
-            return true;
-        } else {
-            return false;
+     */
+    bool pop(sc_time now, char*& data, uint32_t& address) {
+        while (read_count < written) {
+            const Entry& entry = entries[read_count % capacity];
+            if (entry.ready > now) return false;
+
+            data = payloads[read_count % capacity];
+            address = entry.address;
+            read_count++;
+            if (!entry.cancelled) return true;
         }
+        return false;
     }
 
     /**
-    * @brief A read method from the buffer.
-    * 
-    * @param data A variable of a pointer which consists of an array of length cacheLineSize to be written to.
-    * @param address A variable of the address to be written to
-    * 
-    * @return Returns true if a read is successful, false if the buffer is empty.
-    * If the buffer is empty then it does not change the state of the FIFO.
-    *
-    * @authors
-    * Alexander Anthony Tang
-    * Van Trang Nguyen
-    */
-    bool read(char*& data, uint32_t& address) {
-        wait(SC_ZERO_TIME);
-        bool data_avail = prefetch.nb_read(data);
-        bool address_avail = address_prefetch.nb_read(address);
-        
-        if (data_avail && address_avail) {
-            wait(SC_ZERO_TIME);
-            return true;
-        } else {
-            return false;
-        }
+     * @brief Drop the lines that have not been read between two runs (see CPU_L1_L2::reset())
+     */
+    void reset() {
+        written = 0;
+        read_count = 0;
+        last_issue = SC_ZERO_TIME;
+        cancelled = 0;
+        lines.clear();
+        predictor.reset();
     }
 
 };
@@ -0,0 +1,147 @@
+#ifndef PREFETCHER_HPP
+#define PREFETCHER_HPP
+
+#include <vector>
+#include <cstdint>
+#include <climits>
+
+#include "../main/simulator.hpp"
+
+using namespace std;
+
+#define PREFETCHER_TABLE_SIZE 64            // entries of the reference prediction table (stride and stream)
+#define PREFETCHER_REGION_BITS 12           // an entry covers a region of 4 KiB, the region of the address selects it
+#define PREFETCHER_CONFIDENCE_MAX 3         // saturating 2 bit confidence counters
+#define PREFETCHER_CONFIDENCE_THRESHOLD 2   // an entry prefetches from this confidence on
+#define PREFETCHER_STREAM_WINDOW 4          // stream: a read at most this many lines away continues the run
+
+/**
+ * @brief PREFETCHER decides which lines memory prefetches after a read miss of L2
+ *
+ * @details
+ * L2 calls train() for every read from L1, hits included, and it predicts the lines for the read.
+ * After a read miss, memory prefetches exactly these lines into the prefetch buffer (see MEMORY::update()).
+ * Only the misses go to memory, but a prefetcher that only saw the misses would see the stride
+ * between two prefetched runs instead of the stride of the reads, and would lose its confidence.
+ *
+ * 1. NEXTLINE: the `degree` lines after the line of the read, starting `distance` lines ahead (as before)
+ * 2. STRIDE: a reference prediction table. The reads have no PC, so an entry is selected by the region of the
+ *    address (PREFETCHER_REGION_BITS), and holds the last line read in it, the stride to the line before and a
+ *    confidence counter. A read with the same stride raises the confidence, any other stride lowers it, and
+ *    the stride is replaced once the confidence is 0. Once confident, it prefetches
+ *    line + stride * (distance + i) for i < degree, e.g. the column walks of jki and kji.
+ * 3. STREAM: the same table, but an entry follows a run of reads that go up (or down) by at most
+ *    PREFETCHER_STREAM_WINDOW lines, and prefetches the next lines of the run in its direction.
+ *    A jump out of the window or a turn starts a new run.
+ *
+ * The lines of a prediction are line addresses, those before 0 or after UINT_MAX are left out.
+ */
+struct PREFETCHER {
+
+    /**
+     * @brief An entry of the table: the last line read in a region and what it predicts
+     */
+    struct Entry {
+        uint32_t region = 0;        // region of the entry (address >> PREFETCHER_REGION_BITS)
+        int64_t last = 0;           // last line read in the region (address / lineSize)
+        int64_t stride = 0;         // stride: lines from the line before to `last`, stream: direction (+1 or -1)
+        unsigned confidence = 0;    // 0 .. PREFETCHER_CONFIDENCE_MAX
+        bool valid = false;
+    };
+
+    Prefetcher kind;            // which lines are predicted
+    unsigned lineSize;          // size of a cache line
+    unsigned degree;            // lines per prediction
+    unsigned distance;          // lines from the read to the first prefetched line (1 = the next one)
+    vector<Entry> table;        // stride and stream: the reference prediction table
+    vector<uint32_t> lines;     // the lines to prefetch for the last read (see train())
+
+    PREFETCHER(Prefetcher kind, unsigned lineSize, unsigned degree, unsigned distance) :
+        kind(kind), lineSize(lineSize), degree(degree), distance(distance) {
+        if (kind != PREFETCHER_NEXTLINE) table.resize(PREFETCHER_TABLE_SIZE);
+        lines.reserve(degree);
+    }
+
+    /**
+     * @brief A read from L1 at `address`: update the table and predict the lines to prefetch (see lines)
+     * @return The lines to prefetch if the read misses, empty if nothing is predicted
+     */
+    const vector<uint32_t>& train(uint32_t address) {
+        lines.clear();
+        int64_t line = address / lineSize;
+
+        if (kind == PREFETCHER_NEXTLINE) {
+            predict(line, 1);
+            return lines;
+        }
+
+        uint32_t region = address >> PREFETCHER_REGION_BITS;
+        Entry& entry = table[region % PREFETCHER_TABLE_SIZE];
+        if (!entry.valid || entry.region != region) {
+            entry = Entry();
+            entry.region = region;
+            entry.last = line;
+            entry.valid = true;
+            return lines;
+        }
+
+        // the same line again tells nothing about the next one
+        int64_t delta = line - entry.last;
+        if (delta == 0) return lines;
+        entry.last = line;
+
+        if (kind == PREFETCHER_STRIDE) {
+            if (delta == entry.stride) {
+                if (entry.confidence < PREFETCHER_CONFIDENCE_MAX) entry.confidence++;
+            }
+            else if (entry.confidence > 0) {
+                entry.confidence--;
+            }
+            else {
+                entry.stride = delta;
+            }
+        }
+        else {
+            int64_t direction = (delta > 0) ? 1 : -1;
+            if (delta * direction > PREFETCHER_STREAM_WINDOW) {
+                entry.confidence = 0;
+            }
+            else if (direction == entry.stride) {
+                if (entry.confidence < PREFETCHER_CONFIDENCE_MAX) entry.confidence++;
+            }
+            else {
+                entry.stride = direction;
+                entry.confidence = 1;
+            }
+        }
+
+        if (entry.confidence >= PREFETCHER_CONFIDENCE_THRESHOLD) {
+            predict(line, entry.stride);
+        }
+        return lines;
+    }
+
+    /**
+     * @brief Forget what has been learned between two runs (see CPU_L1_L2::reset())
+     */
+    void reset() {
+        lines.clear();
+        for (Entry& entry : table) {
+            entry = Entry();
+        }
+    }
+
+private:
+    /**
+     * @brief lines = line + stride * (distance + i) for i < degree, as addresses
+     */
+    void predict(int64_t line, int64_t stride) {
+        for (unsigned i = 0; i < degree; i++) {
+            int64_t address = (line + stride * (int64_t) (distance + i)) * lineSize;
+            if (address < 0 || address > (int64_t) UINT_MAX) continue;
+            lines.push_back((uint32_t) address);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef SEND_REQUESTS_HPP
+#define SEND_REQUESTS_HPP
+
+#include "../main/simulator.hpp"
+#include "modules.hpp"
+#include "cache_stats.hpp"
+
+// The request loop of every engine, shared by ./cache (simulator.cpp) and libcachesim (cachesim.cpp)
+
+/**
+ * @brief Sends every request to the caches and accumulates the CacheStats
+ * 
+ * @details
+ * Works with every engine that offers `send_request()` (CPU_L1_L2 and FUNCTIONAL_L1_L2)
+ * 
+ * @param caches The engine that simulates the memory hierarchy.
+ * @param numRequests The number of requests.
+ * @param requests A pointer to the array of Request structures.
+ * @param cycles Remaining cycle budget, becomes negative if exceeded.
+ * @param cacheStats The CacheStats to be updated.
+ * @return false if the simulator stopped due to exceeding the cycle limit
+ */
+template <typename Caches>
+bool send_requests(Caches& caches, size_t numRequests, struct Request* requests, int& cycles, CacheStats* cacheStats) {
+    // Process the request
+    for (size_t i = 0; i < numRequests; i++) {
+        struct Request req = requests[i];
+
+        // If req.we == -1, end simulation
+        if (req.we == -1) {
+            break;
+        }
+        
+        // Send request to cache
+        CacheStats tempResult = caches.send_request(req, cycles);
+
+        // break if cycles already exceeded the limit
+        if (cycles < 0) {
+            return false;
+        }
+
+        // update the cacheStats
+        statsUpdater(cacheStats, tempResult);
+    }
+    return true;
+}
+
+/**
+ * @brief CPU_L1_L2 with a CPU module streams the requests in a single sc_start()
+ */
+inline bool send_requests(CPU_L1_L2& caches, size_t numRequests, struct Request* requests, int& cycles, CacheStats* cacheStats) {
+    if (caches.cpu != nullptr) {
+        return caches.stream_requests(requests, numRequests, cycles, cacheStats);
+    }
+    return send_requests<CPU_L1_L2>(caches, numRequests, requests, cycles, cacheStats);
+}
+
+/**
+ * @brief Waits for the memory after the last request, unless the cycle limit has been exceeded
+ * 
+ * @param caches The engine that simulates the memory hierarchy (needs `finish_memory()`).
+ * @param simulatorForceTerminate true if the simulator stopped due to exceeding the cycle limit
+ * @param cycles Remaining cycle budget.
+ * @param cacheStats The CacheStats to be updated.
+ */
+template <typename Caches>
+void finish_requests(Caches& caches, bool simulatorForceTerminate, int cycles, CacheStats* cacheStats) {
+    // Finish up the simulation (wait for memory write) if the simulator is not forced to terminate
+    if (!simulatorForceTerminate) {
+        unsigned int memory_cycles = caches.finish_memory(cycles);
+        if (cycles < 0) {
+            cacheStats->cycles = SIZE_MAX; 
+        }
+        else {
+            cacheStats->cycles += memory_cycles;
+        }
+    }
+    else {
+        // if forced to stop, cycles need to be SIZE_MAX
+        cacheStats->cycles = SIZE_MAX;
+    }
+}
+
+#endif
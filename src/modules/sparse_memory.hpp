@@ -0,0 +1,143 @@
+#ifndef SPARSE_MEMORY_HPP
+#define SPARSE_MEMORY_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief SPARSE_MEMORY is the backing store of MEMORY, covering the whole 32 bit address space.
+ *
+ * @details
+ * Instead of reserving 4 GiB up front, the address space is split into 4 KiB pages
+ * that are only allocated the first time they are written to.
+ *
+ * Address layout (two-level page table):
+ * 1. Bits 31..22 (10 bits) select the entry in the directory
+ * 2. Bits 21..12 (10 bits) select the page in the table
+ * 3. Bits 11..0  (12 bits) are the offset inside of the page
+ *
+ * Reads from a page that was never written return bytes from a single shared zero page,
+ * so reading does not allocate anything.
+ *
+ * reset() keeps the pages of a run in a pool for the next one, so that a simulator that is reset
+ * (see CPU_L1_L2::reset()) does not allocate its memory again.
+ *
+ * @note The memory is zero-initialized, just like the old `char memory_blocks[4294967296]`
+ */
+struct SPARSE_MEMORY {
+    static const unsigned PAGE_BITS = 12;                   // 4 KiB pages
+    static const unsigned TABLE_BITS = 10;                  // 1024 pages per table
+    static const unsigned DIRECTORY_BITS = 32 - PAGE_BITS - TABLE_BITS;
+    static const uint32_t PAGE_SIZE = 1u << PAGE_BITS;
+
+    char** directory[1u << DIRECTORY_BITS];                 // first level, nullptr = no table yet
+    size_t pages = 0;                                       // number of pages allocated (materialized)
+    std::vector<char*> pool;                                // zeroed pages of earlier runs, see reset()
+
+    SPARSE_MEMORY() {
+        memset(directory, 0, sizeof(directory));
+    }
+
+    ~SPARSE_MEMORY() {
+        clear();
+    }
+
+    // the page tables are owned, copying them would double free
+    SPARSE_MEMORY(const SPARSE_MEMORY&) = delete;
+    SPARSE_MEMORY& operator=(const SPARSE_MEMORY&) = delete;
+
+    /**
+     * @brief The page every read of an unwritten address is served from
+     */
+    static const char* zero_page() {
+        static const char page[PAGE_SIZE] = {};
+        return page;
+    }
+
+    /**
+     * @brief Read one byte
+     * @param address The address to read from
+     * @return The byte at `address` (0 if it was never written)
+     */
+    char read(uint32_t address) const {
+        char** table = directory[address >> (PAGE_BITS + TABLE_BITS)];
+        if (table == nullptr) return 0;
+
+        const char* page = table[(address >> PAGE_BITS) & ((1u << TABLE_BITS) - 1)];
+        if (page == nullptr) page = zero_page();
+
+        return page[address & (PAGE_SIZE - 1)];
+    }
+
+    /**
+     * @brief Write one byte, allocating the page (and its table) on first write
+     * @param address The address to write to
+     * @param value The byte to write
+     */
+    void write(uint32_t address, char value) {
+        char**& table = directory[address >> (PAGE_BITS + TABLE_BITS)];
+        if (table == nullptr) {
+            table = new char*[1u << TABLE_BITS]();
+        }
+
+        char*& page = table[(address >> PAGE_BITS) & ((1u << TABLE_BITS) - 1)];
+        if (page == nullptr) {
+            if (pool.empty()) {
+                page = new char[PAGE_SIZE]();
+            }
+            else {
+                page = pool.back();
+                pool.pop_back();
+            }
+            pages++;
+        }
+
+        page[address & (PAGE_SIZE - 1)] = value;
+    }
+
+    /**
+     * @brief Number of 4 KiB pages that have been materialized so far
+     */
+    size_t materialized_pages() const {
+        return pages;
+    }
+
+    /**
+     * @brief The memory reads as all zeroes again, the pages are zeroed and kept in the pool
+     */
+    void reset() {
+        for (unsigned i = 0; i < (1u << DIRECTORY_BITS); i++) {
+            if (directory[i] == nullptr) continue;
+            for (unsigned j = 0; j < (1u << TABLE_BITS); j++) {
+                if (directory[i][j] == nullptr) continue;
+                memset(directory[i][j], 0, PAGE_SIZE);
+                pool.push_back(directory[i][j]);
+                directory[i][j] = nullptr;
+            }
+        }
+        pages = 0;
+    }
+
+    /**
+     * @brief Release every page, the memory reads as all zeroes again
+     */
+    void clear() {
+        for (unsigned i = 0; i < (1u << DIRECTORY_BITS); i++) {
+            if (directory[i] == nullptr) continue;
+            for (unsigned j = 0; j < (1u << TABLE_BITS); j++) {
+                delete[] directory[i][j];
+            }
+            delete[] directory[i];
+            directory[i] = nullptr;
+        }
+        for (char* page : pool) {
+            delete[] page;
+        }
+        pool.clear();
+        pages = 0;
+    }
+};
+
+#endif
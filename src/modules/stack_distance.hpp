@@ -0,0 +1,291 @@
+#ifndef STACK_DISTANCE_HPP
+#define STACK_DISTANCE_HPP
+
+#include <vector>
+#include <unordered_map>
+
+#include "../main/simulator.hpp"
+#include "gate_count.hpp"
+#include "cache_stats.hpp"
+
+using namespace std;
+
+/**
+ * @brief FENWICK is a binary indexed tree over access times.
+ *
+ * @details
+ * Position t holds 1 if the access at time t is the latest access of its cache line, 0 otherwise.
+ * The number of distinct lines used between two accesses is then a difference of two prefix sums.
+ * New times are appended at the end, so the tree grows with the accesses (see push()).
+ */
+struct FENWICK {
+    vector<int> tree;                   // tree[0] is unused, positions start at 1
+
+    FENWICK() : tree(1) {}
+
+    size_t size() const {
+        return tree.size() - 1;
+    }
+
+    /**
+     * @brief Append a new position with the given value
+     * @details tree[i] holds the sum of (i - lowbit(i), i], which is value + the sum of the positions before i in that range
+     */
+    void push(int value) {
+        size_t i = tree.size();
+        size_t lowbit = i & (~i + 1);
+        tree.push_back(value + prefix(i - 1) - prefix(i - lowbit));
+    }
+
+    void add(size_t i, int value) {
+        for (; i < tree.size(); i += i & (~i + 1)) {
+            tree[i] += value;
+        }
+    }
+
+    /**
+     * @brief Sum of the positions 1 .. i
+     */
+    int prefix(size_t i) const {
+        int sum = 0;
+        for (; i > 0; i -= i & (~i + 1)) {
+            sum += tree[i];
+        }
+        return sum;
+    }
+};
+
+/**
+ * @brief LRU_STACK_DISTANCE computes the LRU stack distances (Mattson et al.) of a fully-associative cache.
+ *
+ * @details
+ * The stack distance of an access is the number of distinct cache lines that have been used since the
+ * previous access to the line. A fully-associative LRU cache with n lines hits exactly if the distance
+ * is less than n, so one pass over the trace gives the hits of every cache size (for one line size).
+ *
+ * The distance is counted with a FENWICK over the access times, so it costs O(log n) instead of
+ * walking an LRU stack. Old times are dropped from time to time (see compact()), so the memory only
+ * grows with the number of distinct cache lines, not with the length of the trace.
+ */
+struct LRU_STACK_DISTANCE {
+    unsigned log2_cacheLineSize;        // log2(cacheLineSize)
+
+    FENWICK times;                      // 1 at the latest access time of each line
+    vector<uint32_t> lines;             // line number accessed at each time (lines[t - 1])
+    unordered_map<uint32_t, size_t> last_access; // line number -> time of its latest access
+
+    vector<size_t> histogram;           // histogram[d]: accesses with stack distance d (d < maxDistance)
+    size_t accesses = 0;                // all accesses, including cold misses and distances >= maxDistance
+
+    LRU_STACK_DISTANCE(unsigned cacheLineSize, unsigned maxDistance) : histogram(maxDistance) {
+        log2_cacheLineSize = log2_line_size(cacheLineSize);
+    }
+
+    void access(uint32_t address) {
+        uint32_t line = address >> log2_cacheLineSize;
+        accesses++;
+
+        // keep the tree at most twice as large as the number of distinct lines
+        if (times.size() >= 64 && times.size() >= 2 * last_access.size()) {
+            compact();
+        }
+
+        size_t now = times.size() + 1;
+        times.push(1);
+        lines.push_back(line);
+
+        auto last = last_access.find(line);
+        if (last == last_access.end()) {
+            last_access.emplace(line, now); // cold miss
+            return;
+        }
+
+        // distinct lines accessed after the previous access to this line
+        size_t distance = times.prefix(now - 1) - times.prefix(last->second);
+        times.add(last->second, -1);
+        last->second = now;
+
+        if (distance < histogram.size()) {
+            histogram[distance]++;
+        }
+    }
+
+    /**
+     * @brief Renumber the latest accesses to 1 .. n, keeping their order
+     */
+    void compact() {
+        vector<uint32_t> latest;
+        for (size_t t = 1; t <= lines.size(); t++) {
+            size_t& last = last_access[lines[t - 1]];
+            if (last == t) {
+                latest.push_back(lines[t - 1]);
+                last = latest.size();
+            }
+        }
+
+        times = FENWICK();
+        for (size_t t = 0; t < latest.size(); t++) {
+            times.push(1);
+        }
+        lines.swap(latest);
+    }
+
+    /**
+     * @brief Hits of a fully-associative LRU cache with this line size
+     */
+    size_t hits(unsigned cacheLines) const {
+        size_t sum = 0;
+        for (unsigned d = 0; d < cacheLines && d < histogram.size(); d++) {
+            sum += histogram[d];
+        }
+        return sum;
+    }
+};
+
+/**
+ * @brief LRU_SET_STACKS keeps the top `ways` entries of the LRU stack of every set of a set-associative cache.
+ *
+ * @details
+ * A set-associative LRU cache hits exactly if the stack distance within the set is less than `ways`.
+ * Deeper entries never matter for that, so every set only keeps its `ways` most recently used lines,
+ * which are exactly the lines the cache holds. The position of a line in its stack is its distance.
+ *
+ * The sets are selected like in TAG_STORE, including set counts that are not a power of two.
+ */
+struct LRU_SET_STACKS {
+    static const uint32_t EMPTY = UINT32_MAX; // no line (line numbers are at most 2^30)
+
+    unsigned log2_cacheLineSize;        // log2(cacheLineSize)
+    unsigned sets;                      // Number of sets
+    unsigned ways;                      // Number of lines per set
+    unsigned power_of_two;              // 2^log2(sets), rounded up
+
+    vector<uint32_t> stacks;            // most recently used first, stacks[set * ways + distance]
+    size_t accesses = 0;                // all accesses
+    size_t hits = 0;                    // accesses with a distance less than ways
+
+    LRU_SET_STACKS(unsigned cacheLineSize, unsigned sets, unsigned ways) :
+        sets(sets), ways(ways), stacks((size_t) sets * ways, (uint32_t) EMPTY) {
+        log2_cacheLineSize = log2_line_size(cacheLineSize);
+        power_of_two = 1u << log2_line_count(sets);
+    }
+
+    /**
+     * @brief set of a cache line number (same as TAG_STORE::set_of())
+     */
+    unsigned set_of(uint32_t line) const {
+        unsigned index = line & (power_of_two - 1);
+        return (power_of_two == sets) ? index : index % sets;
+    }
+
+    /**
+     * @brief Access an address and move its line to the top of the stack of its set
+     * @return true if the line has been in the top `ways` entries (a hit)
+     */
+    bool access(uint32_t address) {
+        uint32_t line = address >> log2_cacheLineSize;
+        uint32_t* stack = &stacks[(size_t) set_of(line) * ways];
+        accesses++;
+
+        unsigned distance = 0;
+        while (distance < ways - 1 && stack[distance] != line) {
+            distance++;
+        }
+        bool hit = stack[distance] == line;
+
+        // on a miss the last entry falls out of the stack (the LRU line is replaced)
+        for (; distance > 0; distance--) {
+            stack[distance] = stack[distance - 1];
+        }
+        stack[0] = line;
+
+        hits += hit;
+        return hit;
+    }
+};
+
+/**
+ * @brief STACK_DISTANCE_ENGINE computes miss-ratio curves for every power of two line size and cache size in one pass.
+ *
+ * @details
+ * For every line size in [MIN_LINE_SIZE, MAX_LINE_SIZE] and every cache size in [1, MAX_LINES] lines:
+ * 1. Fully-associative LRU: one LRU_STACK_DISTANCE per line size gives every cache size
+ * 2. Set-associative LRU with `ways` lines per set: one LRU_SET_STACKS per line size and number of sets
+ *
+ * The configured L1 (lines, ways, line size) is analysed as well, so that its hits and misses can be
+ * compared with the other engines (L1 of `--engine=functional --write-policy=back --replacement=lru`).
+ * Every access allocates its line (write-allocate).
+ *
+ * @note L2 only sees the L1 misses and writebacks, so it is not a stack algorithm over the trace and has no curve
+ */
+struct STACK_DISTANCE_ENGINE {
+    enum : unsigned {
+        MIN_LINE_SIZE = 4,                          // smallest line size of the curves
+        MAX_LINE_SIZE = 1024,                       // largest line size of the curves
+        MAX_LINES = 65536                           // largest cache of the curves (in lines)
+    };
+
+    unsigned ways;                                  // lines per set of the set-associative curves
+    vector<LRU_STACK_DISTANCE> fully_associative;   // one per line size
+    vector<vector<LRU_SET_STACKS>> set_associative; // per line size, one per number of sets (1, 2, 4, ...)
+    LRU_SET_STACKS l1;                              // the configured L1
+
+    STACK_DISTANCE_ENGINE(unsigned l1CacheLines, unsigned cacheLineSize, unsigned l1Ways) :
+        ways(l1Ways), l1(cacheLineSize, l1CacheLines / l1Ways, l1Ways) {
+        for (unsigned lineSize = MIN_LINE_SIZE; lineSize <= MAX_LINE_SIZE; lineSize <<= 1) {
+            fully_associative.emplace_back(lineSize, MAX_LINES);
+
+            set_associative.emplace_back();
+            for (unsigned sets = 1; sets * ways <= MAX_LINES; sets <<= 1) {
+                set_associative.back().emplace_back(lineSize, sets, ways);
+            }
+        }
+    }
+
+    /**
+     * @brief One pass over the requests (until numRequests or the `.we == -1` marker)
+     * @param cacheStats gets the hits and misses of the configured L1 (untimed, no cycles)
+     */
+    void run(size_t numRequests, struct Request* requests, CacheStats* cacheStats) {
+        for (size_t i = 0; i < numRequests && requests[i].we != -1; i++) {
+            uint32_t address = requests[i].addr;
+
+            for (size_t s = 0; s < fully_associative.size(); s++) {
+                fully_associative[s].access(address);
+                for (LRU_SET_STACKS& curve : set_associative[s]) {
+                    curve.access(address);
+                }
+            }
+
+            bool hit = l1.access(address);
+            statsUpdater(cacheStats, request_stats(0, hit, false, false, requests[i].we));
+        }
+    }
+
+    /**
+     * @brief The curves as points, ordered by line size and then cache size
+     * @note missesSetAssociative is SIZE_MAX if the cache lines can not be split into a power of two number of sets
+     */
+    vector<MissRatioPoint> points() const {
+        vector<MissRatioPoint> result;
+        for (size_t s = 0; s < fully_associative.size(); s++) {
+            for (unsigned lines = 1; lines <= MAX_LINES; lines <<= 1) {
+                MissRatioPoint point;
+                point.lineSize = MIN_LINE_SIZE << s;
+                point.cacheLines = lines;
+                point.accesses = fully_associative[s].accesses;
+                point.misses = point.accesses - fully_associative[s].hits(lines);
+
+                point.missesSetAssociative = SIZE_MAX;
+                if (lines % ways == 0 && ((lines / ways) & (lines / ways - 1)) == 0) {
+                    const LRU_SET_STACKS& curve = set_associative[s][log2_line_size(lines / ways)];
+                    point.missesSetAssociative = curve.accesses - curve.hits;
+                }
+                result.push_back(point);
+            }
+        }
+        return result;
+    }
+};
+
+#endif
@@ -4,8 +4,11 @@
 #ifdef __cplusplus // added #ifdef __cplusplus so that it works as a c header - anthony
 #include <systemc>
 #include <vector>
+#include <algorithm>
+#include <unordered_map>
 
 #include "../main/simulator.hpp" // the struct moved here - Leon
+#include "line_arena.hpp"
 
 // using namespace directives won't get carried over. 
 using namespace sc_core;
@@ -13,10 +16,30 @@ using namespace std;
 
 /**
 * @brief The storeback buffer is used so that L2 does not need for writes to end in memory.
-* @details This module implements an sc_fifo for both the data and the address. The read() is called by the memory,
+* @details This module implements an sc_fifo for the address. The read() is called by the memory,
 * while the write() by the L2 cache. An in_buffer() method denotes if a certain tag is currently in the buffer.
 * is_empty() denotes if the buffer is now empty.
 *
+* The data of the entries is not allocated per write, it lives in ring slots (see payload()):
+* L2 fills payload() and then calls write(), memory gets a pointer to the slot from read().
+* There are capacity + 2 slots, so that neither the slot that memory is still writing (read, maybe aborted)
+* nor the one that L2 fills before a write() can be one of the entries in the buffer.
+* The sc_fifo of the addresses still decides when an entry can be read and when there is room,
+* with its delta cycle semantics (an entry can be read in the delta cycle after the write).
+*
+* An entry stays in the buffer until memory has written it (see retire()), not only until memory has read it:
+* a read of its line would abort the write and read the old bytes from memory.
+*
+* With combining (a line size is given), an entry is a whole line with a byte mask instead of a single write.
+* A write to a line that already has an entry which memory has not written yet (see retire()) is merged into that entry
+* (the youngest one of the line), it does not take a place in the buffer and memory writes the line only once.
+* This includes the entry that memory is writing during its latency, its data is only written at the end.
+* Memory writes the bytes of the mask (see mask()), the address of an entry is the address of its line.
+*
+* The entries are indexed by their line (a hash table that models a CAM): for every line, the number of its youngest entry.
+* in_buffer() and the combining look up the line instead of scanning the buffer, and with a selective flush
+* (see pending()) L2 only waits until memory has written the entries of the line it reads, not the whole buffer.
+*
 * @note Using a Write Through with Conditional Flush Buffer may not be faster than a Write Through with Unconditional Flush Buffer.
 * As a read from L2 without any dependency will abort any ongoing write, which means the aborted write needs to start from the start
 * and cost more cycles. But if a read hit is generated from the block, then the lost cycles will be recovered.
@@ -25,15 +48,31 @@ using namespace std;
 */
 SC_MODULE(STOREBACK){
 
-    sc_fifo<char*> storeback;
     sc_fifo<uint32_t> address_storeback;
-    vector<uint32_t> tags_storeback;
-    unsigned head;
-    unsigned tail;
+    unsigned head = 0;
+    unsigned tail = 0;
     unsigned capacity;
 
+    LINE_ARENA payloads;        // ring slots of the data (capacity + 2, payloadSize bytes each)
+    size_t written = 0;         // entries written so far, the next write uses slot written % slots
+    size_t read_count = 0;      // entries read so far
+    size_t retired = 0;         // entries written to memory so far (see retire())
+
+    unsigned writeSize;         // bytes of a write (4, or a cache line with write-back)
+    unsigned payloadSize;       // bytes of data of a write (writeSize, 0 = no data)
+    unsigned lineSize;          // size of a cache line
+    bool combining;             // an entry is a line, the writes to it are merged (see push_combining())
+    bool forwarding;            // read misses take the bytes of their line from the buffer (see forward())
+    LINE_ARENA masks;           // combining: byte mask of every slot, 1 = the byte has been written (also without data)
+    vector<uint32_t> slot_tags; // tag of the entry in every slot
+    vector<uint32_t> slot_addresses; // address of the entry in every slot
+    vector<char> covered;       // forwarding: the bytes of a line that the entries hold (see covers())
+    unordered_map<uint32_t, size_t> youngest; // line index: tag -> number of the youngest entry of the line
+    size_t combined = 0;        // combining: writes merged into an entry
+
     bool empty = true;
     bool conditional = false;
+    bool selective = false;     // a read miss only waits for the entries of its line (see pending())
 
     /**
      * @brief Constructor for Store Back Buffer (Write Through w/ Unconditional/Conditional Flush Buffer) module.
@@ -43,32 +82,66 @@ SC_MODULE(STOREBACK){
      * @param conditional Sets if the buffer conditionally or unconditionally flushes in the case of a read. 
      * If it is conditional, then it will only flush if the tag exists inside the buffer. 
      * If it is not conditional, it will always flush
+     * @param writeSize Bytes of a write (4, or a cache line with write-back).
+     * @param lineSize Size of a cache line.
+     * @param combining Merge the writes to the same line into one entry of a line (see push_combining()).
+     * @param selective A read miss only waits until the entries of its line are written (conditional is not used).
+     * @param forwarding Read misses take the bytes of their line from the buffer instead of waiting (see forward()).
+     * @param timingOnly Keep no data, only the addresses (the timing is the same).
      *
      * @author
      * Alexander Anthony Tang
      */
     SC_CTOR(STOREBACK);
-    STOREBACK(sc_module_name name, unsigned capacity, bool conditional) : sc_module(name), capacity(capacity), storeback(capacity), address_storeback(capacity), conditional(conditional) {
-        tags_storeback.resize(capacity);
+    STOREBACK(sc_module_name name, unsigned capacity, bool conditional, unsigned writeSize = 4, unsigned lineSize = 64,
+        bool combining = false, bool selective = false, bool forwarding = false, bool timingOnly = false) :
+        sc_module(name), capacity(capacity), address_storeback(capacity), conditional(conditional), selective(selective),
+        writeSize(writeSize), payloadSize(timingOnly ? 0 : writeSize), lineSize(lineSize),
+        combining(combining), forwarding(forwarding) {
+        if (payloadSize != 0) {
+            payloads.resize(capacity + 2, combining ? lineSize : payloadSize);
+        }
+        if (combining) {
+            masks.resize(capacity + 2, lineSize);
+        }
+        slot_tags.resize(capacity + 2);
+        slot_addresses.resize(capacity + 2);
+        covered.resize(lineSize);
     };
 
+    /**
+    * @brief The slot that the next write() puts into the buffer, to be filled before (nullptr without data)
+    */
+    char* payload() {
+        return payloads[written % (capacity + 2)];
+    }
+
     /**
     * @brief A write method accessing the buffer.
     * 
-    * @param data A pointer which consists of an array of length 4.
-    * @param address The address which corresponds to the data
+    * @param address The address which corresponds to the data in payload()
     * @param tag The tag associated with the address and data 
     * 
     * @return Returns true if a write is successful, false if the buffer is full.
     * If the buffer is full then it does not change the state of the FIFO.
     */
-    bool write(char* data, uint32_t address, uint32_t tag) {
+    bool write(uint32_t address, uint32_t tag) {
         wait(SC_ZERO_TIME);
         wait(SC_ZERO_TIME);
         
-        if (storeback.nb_write(data) && address_storeback.nb_write(address)) {
-            
-            tags_storeback[tail] = tag;
+        return push(address, tag);
+    }
+
+    /**
+    * @brief The non-waiting part of write(), for callers that are SC_METHODs
+    * @note The caller has to wait for two delta cycles before, like write() does
+    */
+    bool push(uint32_t address, uint32_t tag) {
+        if (combining) return push_combining(address, tag);
+
+        if (address_storeback.nb_write(address)) {
+            index(address, tag);
+            written++;
             tail = (tail + 1) % capacity;
             empty = false;
             return true;
@@ -77,10 +150,154 @@ SC_MODULE(STOREBACK){
         }
     }
 
+    /**
+    * @brief push() with combining: merge into the youngest entry of the line that memory has not written, else a new entry
+    * @details The data of a write is at the start of payload(), it is moved to its offset in the line.
+    * A write that crosses the end of the line only keeps the bytes of the line.
+    */
+    bool push_combining(uint32_t address, uint32_t tag) {
+        uint32_t offset = address & (lineSize - 1);
+        unsigned size = min(writeSize, lineSize - offset);
+
+        auto entry = youngest.find(tag);
+        if (entry != youngest.end() && entry->second >= retired) {
+            unsigned slot = entry->second % (capacity + 2);
+            if (payloadSize != 0) {
+                memcpy(payloads[slot] + offset, payload(), size);
+            }
+            memset(masks[slot] + offset, 1, size);
+            combined++;
+            return true;
+        }
+
+        if (!address_storeback.nb_write(address - offset)) return false;
+
+        unsigned slot = written % (capacity + 2);
+        index(address - offset, tag);
+        if (payloadSize != 0) {
+            memmove(payloads[slot] + offset, payloads[slot], size);
+        }
+        memset(masks[slot], 0, lineSize);
+        memset(masks[slot] + offset, 1, size);
+        written++;
+        tail = (tail + 1) % capacity;
+        empty = false;
+        return true;
+    }
+
+    /**
+    * @brief Enter the next entry (number `written`) into the line index
+    */
+    void index(uint32_t address, uint32_t tag) {
+        slot_tags[written % (capacity + 2)] = tag;
+        slot_addresses[written % (capacity + 2)] = address;
+        youngest[tag] = written;
+    }
+
+    /**
+    * @brief Called by memory when it has written the entry it read last, it cannot be combined with anymore
+    * @details The line leaves the index when this was its youngest entry.
+    */
+    void retire() {
+        auto entry = youngest.find(slot_tags[retired % (capacity + 2)]);
+        if (entry != youngest.end() && entry->second == retired) {
+            youngest.erase(entry);
+        }
+        retired++;
+    }
+
+    /**
+    * @brief Whether memory still has to write an entry of the line, including the one it is writing (selective flush)
+    *
+    * @param tag The tag of the line
+    */
+    bool pending(uint32_t tag) const {
+        auto entry = youngest.find(tag);
+        return entry != youngest.end() && entry->second >= retired;
+    }
+
+    /**
+    * @brief What a selective flush waits for: the entries of the line, including the one memory is writing
+    * (not with forwarding, L2 takes their bytes)
+    * @details A write of another line that memory is doing is not waited for: the read aborts it,
+    * and memory writes it again from the start after the read (see MEMORY::write_from_buffer()).
+    */
+    bool flush_pending(uint32_t tag) const {
+        return !forwarding && pending(tag);
+    }
+
+    /**
+    * @brief Calls f(slot, first, count) for the bytes of the line that every entry of the line holds, oldest entry first
+    * @details Only the entries that memory has not written, including the one it is writing or has aborted.
+    * `first` is the offset in the line, a combining entry calls f for every written byte.
+    */
+    template <typename F>
+    void each_entry(uint32_t tag, uint32_t lineAddress, F f) const {
+        for (size_t k = retired; k < written; k++) {
+            unsigned slot = k % (capacity + 2);
+            if (slot_tags[slot] != tag) continue;
+
+            if (combining) {
+                for (unsigned i = 0; i < lineSize; i++) {
+                    if (masks[slot][i]) f(slot, i, 1u);
+                }
+                continue;
+            }
+            // a write may start before the line (write-back lines do not) or go past its end
+            uint64_t first = max((uint64_t) slot_addresses[slot], (uint64_t) lineAddress);
+            uint64_t end = min((uint64_t) slot_addresses[slot] + writeSize, (uint64_t) lineAddress + lineSize);
+            if (first < end) f(slot, (unsigned) (first - lineAddress), (unsigned) (end - first));
+        }
+    }
+
+    /**
+    * @brief Whether the entries of a line hold every byte of it (forwarding), then it needs no read from memory
+    *
+    * @param tag The tag of the line
+    * @param lineAddress The address of the first byte of the line
+    */
+    bool covers(uint32_t tag, uint32_t lineAddress) {
+        std::fill(covered.begin(), covered.end(), 0);
+        each_entry(tag, lineAddress, [&](unsigned, unsigned first, unsigned count) {
+            memset(covered.data() + first, 1, count);
+        });
+        return std::find(covered.begin(), covered.end(), 0) == covered.end();
+    }
+
+    /**
+    * @brief Store-to-load forwarding: write the bytes that the entries of a line hold over the line, oldest entry first
+    *
+    * @param tag The tag of the line
+    * @param lineAddress The address of the first byte of the line
+    * @param line The line, as read from memory (or anything if covers() is true), not used without data
+    *
+    * @return Whether an entry held bytes of the line (memory may have written them all while the line was read)
+    */
+    bool forward(uint32_t tag, uint32_t lineAddress, char* line) {
+        bool forwarded = false;
+        each_entry(tag, lineAddress, [&](unsigned slot, unsigned first, unsigned count) {
+            forwarded = true;
+            if (payloadSize == 0) return;
+            // a combining slot is the line, any other slot starts at the address of the write
+            unsigned start = combining ? first : first + lineAddress - slot_addresses[slot];
+            memcpy(line + first, payloads[slot] + start, count);
+        });
+        return forwarded;
+    }
+
+    /**
+    * @brief The byte mask of an entry that has been read (combining only), 1 = memory writes the byte
+    *
+    * @param data The slot of the entry, from read()
+    */
+    const char* mask(const char* data) const {
+        return masks[(data - payloads[0]) / payloads.lineSize];
+    }
+
     /**
     * @brief A read method from the buffer.
     * 
-    * @param data A variable of a pointer which consists of an array of length 4 to be written to.
+    * @param data Set to the slot of the entry, it stays valid until the next entry is read.
     * @param address A variable of the address to be written to
     * 
     * @return Returns true if a read is successful, false if the buffer is empty.
@@ -88,40 +305,71 @@ SC_MODULE(STOREBACK){
     */
     bool read(char*& data, uint32_t& address) {
         wait(SC_ZERO_TIME);
-        bool data_avail = storeback.nb_read(data);
-        bool address_avail = address_storeback.nb_read(address);
         
-        if (data_avail && address_avail) {
+        if (pop(data, address)) {
             wait(SC_ZERO_TIME);
-            head = (head + 1) % capacity;
-            if (head == tail) empty = true;
+            release();
             return true;
         } else {
             return false;
         }
     }
 
+    /**
+    * @brief The non-waiting parts of read(), for callers that are SC_METHODs
+    * @details read() = wait one delta cycle, pop(), and if successful wait one delta cycle, release()
+    */
+    bool pop(char*& data, uint32_t& address) {
+        if (!address_storeback.nb_read(address)) return false;
+
+        data = payloads[read_count % (capacity + 2)];
+        read_count++;
+        return true;
+    }
+
+    void release() {
+        head = (head + 1) % capacity;
+        if (head == tail) empty = true;
+    }
+
+    /**
+    * @brief Whether the buffer holds entries that memory has not read yet
+    */
+    bool queued() const {
+        return written > read_count;
+    }
+
     /**
     * @brief This method checks if a certain data with the tag exists in the buffer
     *
     * @param tag The tag to be searched for in the buffer.
     * 
     * @return Returns true if it exists in the buffer, false otherwise.
+    * The entry that memory is writing still counts: a read would abort its write and read the old bytes.
     */
 
     bool in_buffer(uint32_t tag) {
         if (conditional) {
-            for (unsigned i = 0; i < (tail - head + capacity) % capacity; i++) {
-                // std::cout << tag << " + " << tags_storeback[(i+head) % capacity] << std::endl;
-                if (tag == tags_storeback[(i+head) % capacity]) return true;
-            }
-            return false;
+            return pending(tag);
         } else {
-            if (empty) return false;
-            else return true;
+            return written > retired;
         }
     }
 
+    /**
+    * @brief Start again at the first slot between two runs (see CPU_L1_L2::reset()), the buffer must be empty
+    */
+    void reset() {
+        head = 0;
+        tail = 0;
+        written = 0;
+        read_count = 0;
+        retired = 0;
+        combined = 0;
+        youngest.clear();
+        empty = true;
+    }
+
     /**
     * @brief This method checks if the buffer is empty
     * 
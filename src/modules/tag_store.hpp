@@ -0,0 +1,237 @@
+#ifndef TAG_STORE_HPP
+#define TAG_STORE_HPP
+
+#include <vector>
+#include <algorithm>
+
+#include "../main/simulator.hpp"
+#include "gate_count.hpp"
+
+using namespace std;
+
+// Valid bit of a key of TAG_STORE, above the 32 bits of the tag
+#define TAG_STORE_VALID (1ull << 32)
+
+/**
+ * @brief TAG_STORE holds the tags, valid bits and replacement state of a set-associative cache.
+ *
+ * @details
+ * The cache lines are grouped into sets of `ways` lines; line = set * ways + way.
+ * With one way the cache is direct-mapped and everything is exactly as before:
+ * the set of an address is its old index, and there is nothing to replace.
+ *
+ * The set/tag extraction is the one of L1 and L2, with the number of sets instead of the number
+ * of lines, including the handling of set counts that are not a power of two.
+ *
+ * Replacement (only if every way of the set is valid, otherwise the first invalid way is filled):
+ * 1. LRU: the least recently used way (every hit and fill updates the age)
+ * 2. PLRU: tree pseudo-LRU, one bit per node of a binary tree over the ways (ways must be a power of two)
+ * 3. FIFO: the way that has been filled first
+ * 4. RANDOM: a pseudo-random way (xorshift, fixed seed, so that runs are reproducible)
+ *
+ * Used by L1, L2 and the functional engine, so that all of them replace the same lines.
+ *
+ * For write-back caches, every line has a dirty bit. The address of the line is kept next to the tag,
+ * so that an evicted line can be written back without rebuilding the address from the tag and the set.
+ *
+ * The tag and the valid bit of a line are packed into one key (see key_of()), so that a lookup reads a
+ * single array with one compare per way. The rest (dirty bits, addresses, stamps) is only used on fills
+ * and evictions and is kept apart, and the data of the lines is in a LINE_ARENA of L1 or L2.
+ */
+struct TAG_STORE {
+    vector<uint64_t> keys;              // tag and valid bit of each cache line (see key_of()), 0 = invalid
+    vector<char> dirty;                 // Vector indicating the lines that have to be written back
+    vector<uint32_t> line_addresses;    // Address of the first byte of each cache line
+
+    unsigned cacheLines;                // Number of cache lines
+    unsigned ways;                      // Number of lines per set
+    unsigned sets;                      // Number of sets (cacheLines / ways)
+    Replacement replacement;            // Replacement policy
+
+    unsigned log2_cacheLineSize;        // log2(cacheLineSize)
+    uint32_t line_mask;                 // clears the offset bits of an address
+    unsigned log2_sets;                 // log2(sets), rounded up
+    unsigned power_of_two;              // 2^log2_sets
+    unsigned tag_shift;                 // offset bits + index bits
+
+    vector<uint64_t> stamps;            // LRU: last use, FIFO: fill time (per line)
+    uint64_t now = 0;                   // counts the uses, for the stamps
+    vector<char> plru;                  // PLRU: tree nodes 1 .. ways - 1 of each set (ways entries per set)
+    uint32_t random_state = 0x9E3779B9; // RANDOM: xorshift state
+
+    TAG_STORE(unsigned cacheLineSize, unsigned cacheLines, unsigned ways = 1, Replacement replacement = REPLACEMENT_LRU) :
+        cacheLines(cacheLines), ways(ways), sets(cacheLines / ways), replacement(replacement) {
+        keys.resize(cacheLines);
+        dirty.resize(cacheLines);
+        line_addresses.resize(cacheLines);
+        stamps.resize(cacheLines);
+        if (replacement == REPLACEMENT_PLRU) plru.resize(cacheLines);
+
+        log2_cacheLineSize = log2_line_size(cacheLineSize);
+        line_mask = ~((1u << log2_cacheLineSize) - 1);
+        log2_sets = log2_line_count(sets);
+        power_of_two = 1u << log2_sets;
+        tag_shift = log2_cacheLineSize + log2_sets - (power_of_two != sets);
+    }
+
+    /**
+     * @brief set an address maps to
+     */
+    unsigned set_of(uint32_t address) const {
+        unsigned index = (address >> log2_cacheLineSize) & (power_of_two - 1);
+        return (power_of_two == sets) ? index : index % sets;
+    }
+
+    /**
+     * @brief tag of an address
+     */
+    uint32_t tag_of(uint32_t address) const {
+        return address >> tag_shift;
+    }
+
+    /**
+     * @brief key of a valid line holding the address: the tag with bit 32 set, never 0
+     */
+    uint64_t key_of(uint32_t address) const {
+        return (uint64_t) tag_of(address) | TAG_STORE_VALID;
+    }
+
+    /**
+     * @brief true if the cache line holds data
+     */
+    bool is_valid(unsigned line) const {
+        return keys[line] != 0;
+    }
+
+    /**
+     * @brief The cache line holding the address, -1 if it is not in the cache
+     */
+    int find(uint32_t address) const {
+        unsigned first = set_of(address) * ways;
+        uint64_t key = key_of(address);
+        for (unsigned line = first; line < first + ways; line++) {
+            if (keys[line] == key) return (int) line;
+        }
+        return -1;
+    }
+
+    /**
+     * @brief The cache line the address is loaded into on a miss
+     */
+    unsigned victim(uint32_t address) {
+        unsigned first = set_of(address) * ways;
+        if (ways == 1) return first;
+
+        for (unsigned line = first; line < first + ways; line++) {
+            if (!is_valid(line)) return line;
+        }
+
+        switch (replacement) {
+            case REPLACEMENT_PLRU: {
+                // follow the bits from the root, they point away from the recently used half
+                unsigned node = 1;
+                while (node < ways) {
+                    node = 2 * node + plru[first + node];
+                }
+                return first + (node - ways);
+            }
+            case REPLACEMENT_RANDOM:
+                random_state ^= random_state << 13;
+                random_state ^= random_state >> 17;
+                random_state ^= random_state << 5;
+                return first + random_state % ways;
+            default: {
+                // LRU and FIFO: the oldest stamp
+                unsigned oldest = first;
+                for (unsigned line = first + 1; line < first + ways; line++) {
+                    if (stamps[line] < stamps[oldest]) oldest = line;
+                }
+                return oldest;
+            }
+        }
+    }
+
+    /**
+     * @brief A hit on a cache line (read or write)
+     */
+    void touch(unsigned line) {
+        if (ways == 1) return;
+
+        if (replacement == REPLACEMENT_LRU) {
+            stamps[line] = ++now;
+        }
+        else if (replacement == REPLACEMENT_PLRU) {
+            // walk from the root to the leaf of the way, every node points to the other half
+            unsigned first = line - line % ways;
+            unsigned way = line % ways;
+            unsigned node = 1;
+            for (unsigned half = ways >> 1; half > 0; half >>= 1) {
+                unsigned right = (way & half) != 0;
+                plru[first + node] = !right;
+                node = 2 * node + right;
+            }
+        }
+    }
+
+    /**
+     * @brief Load the line holding the address into the cache line (see victim())
+     * @note The line is clean afterwards, unless it already held the address
+     */
+    void fill(unsigned line, uint32_t address) {
+        uint64_t key = key_of(address);
+        if (keys[line] != key) {
+            keys[line] = key;
+            dirty[line] = false;
+            line_addresses[line] = address & line_mask;
+            stamps[line] = ++now; // FIFO: fill time
+        }
+        touch(line);
+    }
+
+    /**
+     * @brief true if the cache line holds data that is not in the next level yet
+     */
+    bool is_dirty(unsigned line) const {
+        return is_valid(line) && dirty[line];
+    }
+
+    /**
+     * @brief mark a cache line as modified (write-back)
+     */
+    void mark_dirty(unsigned line) {
+        dirty[line] = true;
+    }
+
+    /**
+     * @brief address of the first byte of a valid cache line, where it is written back to
+     */
+    uint32_t line_address(unsigned line) const {
+        return line_addresses[line];
+    }
+
+    /**
+     * @brief Load the line holding the address into the cache, if it is not already there
+     * @return the cache line
+     */
+    unsigned insert(uint32_t address) {
+        int line = find(address);
+        unsigned target = (line >= 0) ? (unsigned) line : victim(address);
+        fill(target, address);
+        return target;
+    }
+
+    /**
+     * @brief Empty the cache, the same state as after the constructor (nothing is reallocated)
+     */
+    void reset() {
+        std::fill(keys.begin(), keys.end(), 0);
+        std::fill(dirty.begin(), dirty.end(), 0);
+        std::fill(line_addresses.begin(), line_addresses.end(), 0);
+        std::fill(stamps.begin(), stamps.end(), 0);
+        std::fill(plru.begin(), plru.end(), 0);
+        now = 0;
+        random_state = 0x9E3779B9;
+    }
+};
+
+#endif